@@ -0,0 +1,177 @@
+// Render throughput on the host: CPU time per operation of the real driver
+// code (the emulated transport is included but cheap), plus the bus traffic
+// each operation causes and the wire time that traffic needs on the panel.
+//
+//   ssd1306_render_bench [--quick]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "ssd1306.h"
+#include "ssd1306_chart.h"
+#include "ssd1306_widgets.h"
+#include "ssd1306_gray.h"
+#include "ssd1306_emu.h"
+
+static SSD1306_t dev;
+static int iterations = 20000;
+
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void panel_open(uint32_t i2c_hz)
+{
+	ssd1306_emu_reset();
+	memset(&dev, 0, sizeof(dev));
+	i2c_master_init(&dev, 4, 5, -1);
+	ssd1306_emu_set_i2c_hz(i2c_hz);
+	ssd1306_init(&dev, 128, 64);
+	ssd1306_clear_screen(&dev, false);
+}
+
+typedef void (*bench_fn_t)(int i);
+
+static void bench(const char * name, bench_fn_t fn, int count)
+{
+	panel_open(400000);
+	fn(-1);		// Warm-up / setup
+	ssd1306_emu_stats_reset();
+	int64_t start = now_ns();
+	for (int i = 0; i < count; i++) fn(i);
+	int64_t cpu_ns = now_ns() - start;
+	SSD1306_EmuStats_t s = ssd1306_emu.stats;
+
+	printf("%-24s %9.0f ns/op %8.1f bytes/op %6.2f txn/op %9.1f us bus/op @400kHz\n", name,
+		(double)cpu_ns / count, (double)s.bus_bytes / count, (double)s.transactions / count,
+		s.bus_ns / 1e3 / count);
+}
+
+static void op_text_line(int i)
+{
+	char line[17];
+	snprintf(line, sizeof(line), "Count %10d", i);
+	ssd1306_display_text(&dev, 3, line, 16, false);
+}
+
+static void op_text_screen(int i)
+{
+	char line[17];
+	for (int page = 0; page < 8; page++) {
+		snprintf(line, sizeof(line), "%02d:%13d", page, i * 8 + page);
+		ssd1306_display_text(&dev, page, line, 16, (i & 1) != 0);
+	}
+}
+
+static void op_full_frame(int i)
+{
+	(void)i;
+	ssd1306_invalidate(&dev);
+	ssd1306_show_buffer(&dev);
+}
+
+static uint8_t sprite[4 * 32];
+
+static void op_blit(int i)
+{
+	if (i < 0) {
+		for (size_t b = 0; b < sizeof(sprite); b++) sprite[b] = (uint8_t)(b * 37 + 11);
+		return;
+	}
+	ssd1306_blit(&dev, (i * 7) % 100, (i * 3) % 40, sprite, 32, 32, false, BLIT_XOR);
+}
+
+static void op_lines(int i)
+{
+	if (i < 0) return;
+	_ssd1306_line(&dev, i % 128, 0, 127 - i % 128, 63, (i & 1) != 0);
+}
+
+static void op_lines_shown(int i)
+{
+	op_lines(i);
+	if (i >= 0) ssd1306_show_buffer(&dev);
+}
+
+static SSD1306_Chart_t chart;
+
+static void op_chart(int i)
+{
+	if (i < 0) {
+		ssd1306_chart_init(&chart, &dev, 4, 4);
+		ssd1306_chart_set_range(&chart, -1.5f, 1.5f);
+		return;
+	}
+	ssd1306_chart_push(&chart, sinf(i * 0.1f));
+	ssd1306_flush(&dev);
+}
+
+static float widget_value;
+static SSD1306_Widget_t widget;
+
+static void op_widget(int i)
+{
+	if (i < 0) {
+		ssd1306_widget_number(&widget, 2, 0, 10, &widget_value, 1.0f, 1, " C");
+		widget.deadband = 0.05f;
+		return;
+	}
+	widget_value = 20.0f + (i % 100) * 0.01f;	// Mostly inside the deadband
+	ssd1306_widget_update(&dev, &widget);
+	ssd1306_flush(&dev);
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--quick") == 0) iterations = 500;
+
+	bench("text line", op_text_line, iterations);
+	bench("text screen (8 lines)", op_text_screen, iterations / 8);
+	bench("full frame", op_full_frame, iterations / 8);
+	bench("blit 32x32 xor", op_blit, iterations);
+	bench("line (buffer only)", op_lines, iterations);
+	bench("line + show", op_lines_shown, iterations / 8);
+	bench("chart sample", op_chart, iterations);
+	bench("widget update", op_widget, iterations);
+
+	// Frame rate the bus allows, on the modelled wire time
+	static const uint32_t speeds[] = { 100000, 400000, 1000000 };
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+		panel_open(speeds[i]);
+		printf("full frames @%7u Hz    %6.1f fps\n", (unsigned)speeds[i], ssd1306_measure_fps(&dev, 20));
+	}
+
+	// Temporal-dither grayscale: can the bus keep 150 subframes/s (50 gray Hz)?
+	static SSD1306_Gray_t gray;
+	static const struct { const char * name; bool spi; uint32_t hz; } buses[] = {
+		{ "i2c", false, 400000 }, { "i2c", false, 1000000 }, { "spi", true, 8000000 },
+	};
+	for (size_t i = 0; i < sizeof(buses) / sizeof(buses[0]); i++) {
+		SSD1306_GrayStats_t s;
+		if (buses[i].spi) {
+			ssd1306_emu_reset();
+			memset(&dev, 0, sizeof(dev));
+			ssd1306_emu_set_spi_dc(9);
+			spi_master_init(&dev, 11, 12, 10, 9, -1);
+			ssd1306_emu_set_spi_hz(buses[i].hz);
+			ssd1306_init(&dev, 128, 64);
+		} else {
+			panel_open(buses[i].hz);
+		}
+		ssd1306_gray_init(&gray, &dev);
+		for (int level = 0; level < SSD1306_GRAY_LEVELS; level++) {
+			ssd1306_gray_fill_rect(&gray, level * 32, 0, 32, 64, level);
+		}
+		ssd1306_gray_run(&gray, 150, 1000, &s);
+		printf("gray %s @%7u Hz       %6.1f subframes/s %5.1f gray Hz, jitter %6.0f us, late %3d, dropped %3d: %s\n",
+			buses[i].name, (unsigned)buses[i].hz, s.subframe_hz, s.gray_hz, s.jitter_us, s.late, s.dropped,
+			s.sustained ? "sustained" : "too slow");
+	}
+	return 0;
+}
@@ -0,0 +1,820 @@
+// Golden-image tests for the SSD1306 rendering layer. Every scene is drawn
+// through the real driver onto the emulated controller; the visible image is
+// compared with host/golden/<scene>.pbm.
+//
+//   ssd1306_render_test <golden dir> [--update] [--assets <pack>] [scene...]
+//
+// --update rewrites the goldens from the current renders. On a mismatch the
+// render is written next to the binary as <scene>.actual.pbm. --assets backs
+// the asset partition with a pack built by tools/asset_pack.py; without it
+// the asset scenes are skipped.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ssd1306.h"
+#include "ssd1306_chart.h"
+#include "ssd1306_effects.h"
+#include "ssd1306_widgets.h"
+#include "ssd1306_portrait.h"
+#include "ssd1306_gray.h"
+#include "ssd1306_console.h"
+#include "ssd1306_mirror.h"
+#include "ssd1306_layers.h"
+#include "ssd1306_assets.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_emu.h"
+
+#define SPI_DC_IO 9
+
+typedef enum {
+	PANEL_I2C,
+	PANEL_SPI
+} panel_bus_t;
+
+typedef struct {
+	const char * name;
+	const char * golden;	// Shared golden (NULL: same as name)
+	panel_bus_t bus;
+	int height;
+	bool flip;
+	void (*draw)(SSD1306_t * dev);
+	bool direct;	// Draws GDDRAM past the frame buffer: no buffer comparison
+	bool assets;	// Needs the asset pack (--assets)
+} scene_t;
+
+static const char * assets_path;
+
+static SSD1306_t dev;
+
+static void panel_open(panel_bus_t bus, int height, bool flip)
+{
+	ssd1306_emu_reset();
+	memset(&dev, 0, sizeof(dev));
+	if (bus == PANEL_SPI) {
+		ssd1306_emu_set_spi_dc(SPI_DC_IO);
+		spi_master_init(&dev, 11, 12, 10, SPI_DC_IO, -1);
+	} else {
+		i2c_master_init(&dev, 4, 5, -1);
+	}
+	dev._flip = flip;
+	ssd1306_init(&dev, 128, height);
+	ssd1306_clear_screen(&dev, false);
+}
+
+// ------ Scenes ------
+
+static void scene_text(SSD1306_t * d)
+{
+	ssd1306_display_text(d, 0, "Hello, world!", 13, false);
+	ssd1306_display_text(d, 2, "0123456789ABCDEF", 16, false);
+	ssd1306_display_text(d, 4, "  Inverted line ", 16, true);
+	if (d->_pages > 4) {
+		ssd1306_display_text(d, 6, "~!@#$%^&*()_+{}|", 16, false);
+		ssd1306_display_text(d, 7, "abcdefghijklmnop", 16, false);
+	}
+}
+
+static void scene_text_x3(SSD1306_t * d)
+{
+	ssd1306_display_text_x3(d, 0, "x3!", 3, false);
+	ssd1306_display_text_x3(d, 4, "Ok", 2, true);
+}
+
+static void scene_shapes(SSD1306_t * d)
+{
+	_ssd1306_line(d, 0, 0, 127, 63, false);
+	_ssd1306_line(d, 0, 63, 127, 0, false);
+	_ssd1306_line(d, 5, 50, 60, 45, false);
+	_ssd1306_rect(d, 10, 10, 40, 20, false);
+	_ssd1306_fill_rect(d, 80, 40, 30, 15, false);
+	_ssd1306_fill_rect(d, 85, 45, 10, 5, true);
+	_ssd1306_circle(d, 64, 32, 20, OLED_DRAW_ALL, false);
+	_ssd1306_disc(d, 100, 16, 10, OLED_DRAW_ALL, false);
+	_ssd1306_disc(d, 24, 48, 8, OLED_DRAW_UPPER_LEFT | OLED_DRAW_LOWER_RIGHT, false);
+	_ssd1306_pixel(d, 127, 63, false);
+	ssd1306_show_buffer(d);
+}
+
+static void scene_bitmap(SSD1306_t * d)
+{
+	// 24x20 arrow, row-major MSB first
+	uint8_t arrow[3 * 20];
+	for (int y = 0; y < 20; y++) {
+		int half = y < 10 ? y : 19 - y;
+		for (int x = 0; x < 24; x++) {
+			bool on = (x < 12) ? (y >= 6 && y < 14) : (x - 12 <= half);
+			if (on) arrow[y * 3 + x / 8] |= 0x80 >> (x % 8);
+			else arrow[y * 3 + x / 8] &= ~(0x80 >> (x % 8));
+		}
+	}
+	ssd1306_bitmaps(d, 3, 5, arrow, 24, 20, false);
+	ssd1306_bitmaps(d, 40, 21, arrow, 24, 20, true);
+	ssd1306_blit(d, 70, 3, arrow, 24, 20, false, BLIT_COPY);
+	ssd1306_blit(d, 78, 9, arrow, 24, 20, false, BLIT_XOR);
+	ssd1306_blit(d, 115, 50, arrow, 24, 20, false, BLIT_OR);	// Clipped right and bottom
+	ssd1306_show_buffer(d);
+}
+
+static void scene_chart(SSD1306_t * d)
+{
+	SSD1306_Chart_t chart;
+	ssd1306_display_text(d, 0, "Chart", 5, false);
+	ssd1306_chart_init(&chart, d, 2, 6);
+	for (int i = 0; i < 200; i++) {
+		ssd1306_chart_push(&chart, sinf(i * 0.15f) * 10.0f + i * 0.05f);
+		ssd1306_flush(d);
+	}
+}
+
+static void scene_widgets(SSD1306_t * d)
+{
+	static float temp, press, hum, gas, level, alarm;
+	static const uint8_t bell[8] = { 0x18, 0x3C, 0x3C, 0x3C, 0x7E, 0xFF, 0x00, 0x18 };
+	SSD1306_Widget_t w[9];
+	ssd1306_widget_label(&w[0], 0, 0, "Temp:");
+	ssd1306_widget_number(&w[1], 0, 6, 10, &temp, 1.0f, 1, " C");
+	ssd1306_widget_label(&w[2], 1, 0, "Press:");
+	ssd1306_widget_number(&w[3], 1, 7, 9, &press, 0.001f, 1, " kPa");
+	ssd1306_widget_label(&w[4], 2, 0, "Hum:");
+	ssd1306_widget_number(&w[5], 2, 5, 11, &hum, 1.0f, 1, "%");
+	ssd1306_widget_label(&w[6], 3, 0, "GasR:");
+	ssd1306_widget_number(&w[7], 3, 6, 10, &gas, 1.0f, 1, " kOhm");
+	w[7].placeholder = "warming up";
+	ssd1306_widget_bar(&w[8], 0, 40, 100, 10, &level, 0.0f, 100.0f);
+
+	SSD1306_Widget_t icon;
+	ssd1306_widget_icon(&icon, 112, 40, 8, 8, &alarm, bell, NULL);
+
+	temp = 21.5f; press = 100950.0f; hum = 45.25f; gas = NAN; level = 80.0f; alarm = 0.0f;
+	ssd1306_widgets_update(d, w, 9);
+	ssd1306_widget_update(d, &icon);
+	temp = -3.04f; hum = 100.0f; gas = 152.3f; level = 35.0f; alarm = 1.0f;
+	ssd1306_widgets_update(d, w, 9);
+	ssd1306_widget_update(d, &icon);
+	ssd1306_flush(d);
+}
+
+static void scene_content_scroll(SSD1306_t * d)
+{
+	ssd1306_display_text(d, 0, "Scrolled  16 col", 16, false);
+	ssd1306_display_text(d, 3, "Fixed", 5, false);
+	ssd1306_display_text(d, 5, "Scrolled  16 col", 16, false);
+	for (int i = 0; i < 16; i++) {
+		ssd1306_content_scroll_left(d, 0, 1);
+		ssd1306_content_scroll_left(d, 5, 7);
+	}
+	ssd1306_flush(d);
+}
+
+// Half-way through a wipe onto vertical stripes
+static void scene_effect_wipe(SSD1306_t * d)
+{
+	static uint8_t target[8][128];
+	static SSD1306_Effect_t fx;
+	for (int page = 0; page < 8; page++) {
+		for (int col = 0; col < 128; col++) {
+			target[page][col] = ((col / 8) & 1) ? 0xFF : 0x00;
+		}
+	}
+	scene_text(d);
+	ssd1306_effect_start(&fx, d, EFFECT_WIPE_LEFT, &target[0][0], 400);
+	ssd1306_emu_sleep_us(200000);
+	ssd1306_effect_step(&fx);
+}
+
+// Portrait text, a frame and a diagonal, drawn on the logical 64x128 canvas
+static void scene_portrait_draw(SSD1306_t * d, ssd1306_portrait_t rotation)
+{
+	static SSD1306_Portrait_t canvas;
+	ssd1306_portrait_init(&canvas, d, rotation);
+	ssd1306_portrait_text(&canvas, 0, "Portrait", 8, false);
+	ssd1306_portrait_text(&canvas, 2, "Temp", 4, false);
+	ssd1306_portrait_text(&canvas, 3, " 21.5 C", 7, true);
+	ssd1306_portrait_text(&canvas, 5, "Hum", 3, false);
+	ssd1306_portrait_text(&canvas, 6, " 45.2 %", 7, false);
+	for (int y = 64; y < 128; y++) {
+		_ssd1306_portrait_pixel(&canvas, 0, y, false);
+		_ssd1306_portrait_pixel(&canvas, canvas.width - 1, y, false);
+		_ssd1306_portrait_pixel(&canvas, (y - 64) * (canvas.width - 1) / 63, y, false);
+	}
+	ssd1306_portrait_show(&canvas);
+}
+
+static void scene_portrait_cw(SSD1306_t * d)
+{
+	scene_portrait_draw(d, PORTRAIT_CW);
+}
+
+static void scene_portrait_ccw(SSD1306_t * d)
+{
+	scene_portrait_draw(d, PORTRAIT_CCW);
+}
+
+// Eleven lines through the 8-page ring, so the start line has wrapped
+static SSD1306_Console_t console;
+
+static void scene_console(SSD1306_t * d)
+{
+	ssd1306_console_init(&console, d);
+	for (int i = 1; i <= 11; i++) {
+		if (i == 9) {
+			ssd1306_console_print(&console, "ALARM: gas high", 15, true);
+		} else {
+			ssd1306_console_printf(&console, "%02d event %d", i, i * 7);
+		}
+	}
+}
+
+static void scene_console_end(SSD1306_t * d)
+{
+	scene_console(d);
+	ssd1306_console_end(&console);
+}
+
+// A throwaway frame, then the text scene, both double buffered
+static void scene_double_buffer(SSD1306_t * d)
+{
+	ssd1306_double_buffer(d, true);
+	_ssd1306_line(d, 0, 0, 127, d->_pages * 8 - 1, false);
+	ssd1306_display_text(d, 1, "Frame 1", 7, true);
+	ssd1306_flush(d);
+	ssd1306_batch_begin(d);
+	ssd1306_clear_screen(d, false);
+	scene_text(d);
+	ssd1306_batch_end(d);
+}
+
+// Labels and a diagonal on the background, readings on the data layer and an
+// alarm banner on the overlay, hiding part of both
+static SSD1306_Layers_t layers;
+
+static void scene_layers(SSD1306_t * d)
+{
+	int rows = d->_pages * 8;
+	ssd1306_layers_init(&layers, d);
+	for (int x = 0; x < 128; x++) {
+		_ssd1306_layer_pixel(&layers, LAYER_BACKGROUND, x, x * (rows - 1) / 127, false);
+	}
+	_ssd1306_layer_fill_rect(&layers, LAYER_BACKGROUND, 0, rows - 1, 128, 1, false);
+	ssd1306_layer_text(&layers, LAYER_BACKGROUND, 0, 0, "Temp", 4, false);
+	ssd1306_layer_text(&layers, LAYER_BACKGROUND, 2, 0, "Hum", 3, false);
+	ssd1306_layer_text(&layers, LAYER_DATA, 0, 64, "21.5 C", 6, false);
+	ssd1306_layer_text(&layers, LAYER_DATA, 2, 64, "45.2 %", 6, false);
+
+	_ssd1306_layer_fill_rect(&layers, LAYER_OVERLAY, 8, 12, 112, 16, false);
+	_ssd1306_layer_fill_rect(&layers, LAYER_OVERLAY, 9, 13, 110, 14, true);
+	ssd1306_layer_text(&layers, LAYER_OVERLAY, 2, 44, "ALARM", 5, false);
+	ssd1306_layers_show(&layers);
+}
+
+// Hide, update underneath, restack and show again: the same image as scene_layers
+static void scene_layers_toggle(SSD1306_t * d)
+{
+	scene_layers(d);
+	ssd1306_layer_set_visible(&layers, LAYER_OVERLAY, false);
+	ssd1306_layers_show(&layers);
+	ssd1306_layer_text(&layers, LAYER_DATA, 2, 64, "99.9 %", 6, false);
+	ssd1306_layer_set_z(&layers, LAYER_BACKGROUND, 2);
+	ssd1306_layers_show(&layers);
+	ssd1306_layer_text(&layers, LAYER_DATA, 2, 64, "45.2 %", 6, false);
+	ssd1306_layer_set_z(&layers, LAYER_BACKGROUND, 0);
+	ssd1306_layer_set_visible(&layers, LAYER_OVERLAY, true);
+	ssd1306_layers_show(&layers);
+}
+
+// Readings in the pack's scaled digit fonts next to its icons, with a line
+// of proportional text; everything is read from the mapped pack
+static void scene_assets(SSD1306_t * d)
+{
+	static SSD1306_Assets_t pack;
+	SSD1306_Font_t text8, digits16, digits24;
+	SSD1306_Atlas_t icons;
+	ssd1306_assets_open(&pack, SSD1306_ASSETS_PARTITION);
+	ssd1306_assets_font(&pack, "text8", &text8);
+	ssd1306_assets_font(&pack, "digits16", &digits16);
+	ssd1306_assets_font(&pack, "digits24", &digits24);
+	ssd1306_assets_atlas(&pack, "icons16", &icons);
+
+	ssd1306_atlas_icon(d, &icons, 0, 0, 0, false);
+	int seg = ssd1306_font_text(d, &digits24, 0, 20, "21.5", 4, false);
+	ssd1306_font_text(d, &text8, 0, seg + 2, "C", 1, false);
+	ssd1306_atlas_icon(d, &icons, 3, 0, 1, false);
+	ssd1306_font_text(d, &digits16, 3, 20, "45.2%", 5, false);
+	ssd1306_atlas_icon(d, &icons, 5, 0, 3, false);
+	ssd1306_atlas_icon(d, &icons, 5, 112, 4, true);
+	ssd1306_font_text(d, &digits16, 5, 20, "12:05", 5, false);
+	ssd1306_font_text(d, &text8, 7, 0, " Proportional, 8px ", 19, true);
+	ssd1306_present(d);
+	ssd1306_assets_close(&pack);
+}
+
+static const scene_t scenes[] = {
+	{ .name = "text", .bus = PANEL_I2C, .height = 64, .draw = scene_text },
+	{ .name = "text_spi", .golden = "text", .bus = PANEL_SPI, .height = 64, .draw = scene_text },
+	{ .name = "text_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_text },
+	{ .name = "text_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_text },
+	{ .name = "text_x3", .bus = PANEL_I2C, .height = 64, .draw = scene_text_x3 },
+	{ .name = "shapes", .bus = PANEL_I2C, .height = 64, .draw = scene_shapes },
+	{ .name = "shapes_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_shapes },
+	{ .name = "bitmap", .bus = PANEL_I2C, .height = 64, .draw = scene_bitmap },
+	{ .name = "chart", .bus = PANEL_I2C, .height = 64, .draw = scene_chart },
+	{ .name = "chart_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_chart },
+	{ .name = "chart_spi", .golden = "chart", .bus = PANEL_SPI, .height = 64, .draw = scene_chart },
+	{ .name = "widgets", .bus = PANEL_I2C, .height = 64, .draw = scene_widgets },
+	{ .name = "content_scroll", .bus = PANEL_I2C, .height = 64, .draw = scene_content_scroll },
+	{ .name = "effect_wipe", .bus = PANEL_I2C, .height = 64, .draw = scene_effect_wipe },
+	{ .name = "portrait_cw", .bus = PANEL_I2C, .height = 64, .draw = scene_portrait_cw },
+	{ .name = "portrait_ccw", .bus = PANEL_I2C, .height = 64, .draw = scene_portrait_ccw },
+	{ .name = "portrait_flip", .golden = "portrait_ccw", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_portrait_cw },	// Upside down CW is CCW
+	{ .name = "portrait_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_portrait_cw },
+	{ .name = "double_128x32", .golden = "text_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_double_buffer },
+	{ .name = "double_128x32_spi", .golden = "text_128x32", .bus = PANEL_SPI, .height = 32, .draw = scene_double_buffer },
+	{ .name = "double_128x32_flip", .bus = PANEL_I2C, .height = 32, .flip = true, .draw = scene_double_buffer },
+	{ .name = "console", .bus = PANEL_I2C, .height = 64, .draw = scene_console, .direct = true },
+	{ .name = "console_spi", .golden = "console", .bus = PANEL_SPI, .height = 64, .draw = scene_console, .direct = true },
+	{ .name = "console_end", .golden = "console", .bus = PANEL_I2C, .height = 64, .draw = scene_console_end },	// Same image through the frame buffer
+	{ .name = "console_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_console, .direct = true },
+	{ .name = "console_flip_end", .golden = "console_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_console_end },
+	{ .name = "console_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_console, .direct = true },
+	{ .name = "console_128x32_end", .golden = "console_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_console_end },
+	{ .name = "layers", .bus = PANEL_I2C, .height = 64, .draw = scene_layers },
+	{ .name = "layers_spi", .golden = "layers", .bus = PANEL_SPI, .height = 64, .draw = scene_layers },
+	{ .name = "layers_toggle", .golden = "layers", .bus = PANEL_I2C, .height = 64, .draw = scene_layers_toggle },
+	{ .name = "layers_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_layers },
+	{ .name = "layers_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_layers },
+	{ .name = "assets", .bus = PANEL_I2C, .height = 64, .draw = scene_assets, .assets = true },
+	{ .name = "assets_spi", .golden = "assets", .bus = PANEL_SPI, .height = 64, .draw = scene_assets, .assets = true },
+	{ .name = "assets_flip", .bus = PANEL_I2C, .height = 64, .flip = true, .draw = scene_assets, .assets = true },
+	{ .name = "assets_128x32", .bus = PANEL_I2C, .height = 32, .draw = scene_assets, .assets = true },
+};
+
+// Unflipped, the panel must show exactly the driver's frame buffer
+static int compare_with_buffer(const uint8_t * pixels, int rows)
+{
+	int diff = 0;
+	for (int y = 0; y < rows; y++) {
+		for (int x = 0; x < 128; x++) {
+			bool want = (dev._page[y / 8]._segs[x] >> (y % 8)) & 1;
+			if (want != pixels[y * 128 + x]) diff++;
+		}
+	}
+	return diff;
+}
+
+static bool run_scene(const scene_t * s, const char * golden_dir, bool update)
+{
+	static uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	static uint8_t golden[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	char path[512];
+	bool ok = true;
+
+	if (s->assets && assets_path == NULL) {
+		printf("%-18s skipped (no --assets)\n", s->name);
+		return true;
+	}
+	panel_open(s->bus, s->height, s->flip);
+	ssd1306_emu_stats_reset();
+	s->draw(&dev);
+	SSD1306_EmuStats_t stats = ssd1306_emu.stats;
+
+	int rows = ssd1306_emu_rows();
+	ssd1306_emu_render(pixels);
+	snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, s->golden ? s->golden : s->name);
+
+	const char * verdict = "ok";
+	if (ssd1306_emu.unknown_commands) {
+		verdict = "unknown commands";
+		ok = false;
+	} else if (!s->flip && !s->direct && compare_with_buffer(pixels, rows)) {
+		verdict = "panel != buffer";
+		ok = false;
+	}
+
+	if (ok && update && s->golden == NULL) {
+		if (!ssd1306_emu_write_pbm(path)) {
+			verdict = "cannot write golden";
+			ok = false;
+		} else {
+			verdict = "updated";
+		}
+	} else if (ok) {
+		int width, height;
+		if (!ssd1306_emu_read_pbm(path, golden, &width, &height)) {
+			verdict = "missing golden";
+			ok = false;
+		} else if (height != rows || memcmp(golden, pixels, rows * 128) != 0) {
+			verdict = "golden mismatch";
+			ok = false;
+		}
+	}
+	if (!ok) {
+		snprintf(path, sizeof(path), "%s.actual.pbm", s->name);
+		ssd1306_emu_write_pbm(path);
+	}
+
+	printf("%-18s %-16s %4u txn %6u bytes %6u data %8.2f ms\n", s->name, verdict,
+		stats.transactions, stats.bus_bytes, stats.data_bytes, stats.bus_ns / 1e6);
+	return ok;
+}
+
+// ------ Traffic checks: retained state must keep redraws cheap ------
+
+static int run_double_buffer_checks(void);
+
+static bool check(const char * name, bool ok, uint32_t bytes)
+{
+	printf("%-33s %s (%u data bytes)\n", name, ok ? "ok" : "FAILED", bytes);
+	return ok;
+}
+
+static int run_traffic_checks(void)
+{
+	int failed = 0;
+
+	panel_open(PANEL_I2C, 64, false);
+	scene_text(&dev);
+	ssd1306_emu_stats_reset();
+	scene_text(&dev);
+	failed += !check("same text again", ssd1306_emu.stats.bus_bytes == 0, ssd1306_emu.stats.data_bytes);
+
+	ssd1306_emu_stats_reset();
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEx", 16, false);
+	failed += !check("one glyph changed", ssd1306_emu.stats.data_bytes > 0 && ssd1306_emu.stats.data_bytes <= 8, ssd1306_emu.stats.data_bytes);
+
+	// A NACKed transfer must not reach the shadow: the next flush resends it
+	static uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	ssd1306_emu.nack_transactions = 1;
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEz", 16, false);
+	ssd1306_emu_render(pixels);
+	bool lost = compare_with_buffer(pixels, 64) != 0;
+	ssd1306_emu_stats_reset();
+	ssd1306_flush(&dev);
+	ssd1306_emu_render(pixels);
+	failed += !check("failed span resent", lost && compare_with_buffer(pixels, 64) == 0
+		&& ssd1306_emu.stats.data_bytes <= 8, ssd1306_emu.stats.data_bytes);
+	ssd1306_emu.nack_transactions = 1;
+	ssd1306_clear_screen(&dev, true);
+	ssd1306_emu_render(pixels);
+	lost = compare_with_buffer(pixels, 64) != 0;
+	ssd1306_emu_stats_reset();
+	ssd1306_flush(&dev);
+	ssd1306_emu_render(pixels);
+	failed += !check("failed frame resent", lost && compare_with_buffer(pixels, 64) == 0, ssd1306_emu.stats.data_bytes);
+	scene_text(&dev);
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEx", 16, false);
+
+	static float value = 12.3f;
+	SSD1306_Widget_t w;
+	ssd1306_widget_number(&w, 5, 0, 8, &value, 1.0f, 1, " C");
+	w.deadband = 0.05f;
+	ssd1306_widget_update(&dev, &w);
+	ssd1306_flush(&dev);
+	ssd1306_emu_stats_reset();
+	value = 12.32f;
+	ssd1306_widget_update(&dev, &w);
+	ssd1306_flush(&dev);
+	failed += !check("widget inside deadband", ssd1306_emu.stats.bus_bytes == 0, ssd1306_emu.stats.data_bytes);
+	value = 12.4f;
+	ssd1306_widget_update(&dev, &w);
+	ssd1306_flush(&dev);
+	failed += !check("widget last digit", ssd1306_emu.stats.data_bytes > 0 && ssd1306_emu.stats.data_bytes <= 8, ssd1306_emu.stats.data_bytes);
+
+	SSD1306_Chart_t chart;
+	ssd1306_chart_init(&chart, &dev, 6, 2);
+	ssd1306_chart_set_range(&chart, 0.0f, 100.0f);
+	ssd1306_chart_push(&chart, 50.0f);
+	ssd1306_flush(&dev);
+	ssd1306_emu_stats_reset();
+	ssd1306_chart_push(&chart, 51.0f);
+	ssd1306_flush(&dev);
+	failed += !check("chart sample (no full redraw)", ssd1306_emu.stats.data_bytes <= 2 * 8, ssd1306_emu.stats.data_bytes);
+	ssd1306_emu_sleep_us(SSD1306_CONTENT_SCROLL_GAP_US);
+	int64_t t0 = ssd1306_emu_time_us();
+	ssd1306_chart_push(&chart, 52.0f);
+	ssd1306_chart_push(&chart, 53.0f);
+	failed += !check("chart scrolls 2 frames apart", ssd1306_emu_time_us() - t0 >= SSD1306_CONTENT_SCROLL_GAP_US, 0);
+
+	static SSD1306_Portrait_t canvas;
+	ssd1306_clear_screen(&dev, false);
+	ssd1306_portrait_init(&canvas, &dev, PORTRAIT_CW);
+	ssd1306_portrait_text(&canvas, 4, "12345678", 8, false);
+	ssd1306_portrait_show(&canvas);
+	ssd1306_emu_stats_reset();
+	ssd1306_portrait_text(&canvas, 4, "12345679", 8, false);
+	ssd1306_portrait_show(&canvas);
+	failed += !check("portrait glyph (one tile)", ssd1306_emu.stats.data_bytes > 0 && ssd1306_emu.stats.data_bytes <= 8, ssd1306_emu.stats.data_bytes);
+
+	ssd1306_console_init(&console, &dev);
+	ssd1306_console_print(&console, "first", 5, false);
+	ssd1306_emu_stats_reset();
+	ssd1306_console_print(&console, "second", 6, false);
+	failed += !check("console line (one page + 0x40)", ssd1306_emu.stats.data_bytes == 128 && ssd1306_emu.stats.command_bytes <= 6 + 1,
+		ssd1306_emu.stats.data_bytes);
+
+	// The banner spans pages 1-3, columns 8-119: 28 words and 112 bytes per page
+	uint8_t frame[8][128];
+	panel_open(PANEL_I2C, 64, false);
+	scene_layers(&dev);
+	ssd1306_get_buffer(&dev, &frame[0][0]);
+	ssd1306_emu_stats_reset();
+	ssd1306_layer_set_visible(&layers, LAYER_OVERLAY, false);
+	ssd1306_layers_show(&layers);
+	failed += !check("overlay hidden (its area only)", layers.composed == 3 * 28 && ssd1306_emu.stats.data_bytes > 0
+		&& ssd1306_emu.stats.data_bytes <= 3 * 112, ssd1306_emu.stats.data_bytes);
+	ssd1306_emu_stats_reset();
+	ssd1306_layer_set_visible(&layers, LAYER_OVERLAY, true);
+	ssd1306_layers_show(&layers);
+	uint8_t again[8][128];
+	ssd1306_get_buffer(&dev, &again[0][0]);
+	failed += !check("overlay shown again", memcmp(frame, again, sizeof(frame)) == 0
+		&& ssd1306_emu.stats.data_bytes <= 3 * 112, ssd1306_emu.stats.data_bytes);
+	ssd1306_emu_stats_reset();
+	ssd1306_layer_text(&layers, LAYER_DATA, 2, 64, "99.9 %", 6, false);
+	ssd1306_layers_show(&layers);
+	failed += !check("data under overlay (nothing sent)", layers.composed == 12 && ssd1306_emu.stats.bus_bytes == 0,
+		ssd1306_emu.stats.data_bytes);
+
+	// Flush task: the scroll is queued ahead of the frame, and two charts on
+	// adjacent pages share one command (8 bytes) ahead of their columns
+	SSD1306_Chart_t upper, lower;
+	panel_open(PANEL_I2C, 64, false);
+	ssd1306_start_flush_task(&dev, 1);
+	ssd1306_chart_init(&upper, &dev, 4, 2);
+	ssd1306_chart_init(&lower, &dev, 6, 2);
+	ssd1306_chart_set_range(&upper, 0.0f, 100.0f);
+	ssd1306_chart_set_range(&lower, 0.0f, 100.0f);
+	for (int i = 0; i < 4; i++) {
+		ssd1306_chart_push(&upper, 20.0f + i * 10.0f);
+		ssd1306_chart_push(&lower, 80.0f - i * 10.0f);
+		ssd1306_present(&dev);
+		_ssd1306_flush_drain(&dev);
+	}
+	ssd1306_chart_push(&upper, 55.0f);
+	ssd1306_chart_push(&lower, 45.0f);
+	ssd1306_present(&dev);
+	ssd1306_emu_stats_reset();
+	_ssd1306_flush_drain(&dev);
+	ssd1306_emu_render(pixels);
+	failed += !check("chart samples, flush task", compare_with_buffer(pixels, 64) == 0 && ssd1306_emu.stats.data_bytes <= 4 * 2
+		&& ssd1306_emu.stats.command_bytes <= 8 + 4 * 6, ssd1306_emu.stats.data_bytes);
+
+	return failed + run_double_buffer_checks();
+}
+
+// A double-buffered flush may only write the hidden GDDRAM half, then flip to it
+static int run_double_buffer_checks(void)
+{
+	static uint8_t ram[SSD1306_EMU_PAGES][SSD1306_EMU_COLUMNS];
+	static uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	int failed = 0;
+
+	panel_open(PANEL_I2C, 64, false);
+	failed += !check("double buffer refused on 128x64", ssd1306_double_buffer(&dev, true) == ESP_ERR_NOT_SUPPORTED, 0);
+
+	panel_open(PANEL_I2C, 32, false);
+	ssd1306_double_buffer(&dev, true);
+	scene_text(&dev);
+	ssd1306_flush(&dev);
+	for (int frame = 0; frame < 3; frame++) {
+		char line[17];
+		snprintf(line, sizeof(line), "Frame %d", frame);
+		ssd1306_display_text(&dev, frame % 4, line, 16, (frame & 1) != 0);
+		int shown = ssd1306_emu.start_line / 8;
+		memcpy(ram, ssd1306_emu.ram, sizeof(ram));
+		ssd1306_emu_render(pixels);
+		bool held = compare_with_buffer(pixels, 32) != 0;	// Not drawn before the flush
+		ssd1306_emu_stats_reset();
+		ssd1306_flush(&dev);
+		held = held && memcmp(&ram[shown], &ssd1306_emu.ram[shown], 4 * SSD1306_EMU_COLUMNS) == 0;
+		ssd1306_emu_render(pixels);
+		bool ok = held && ssd1306_emu.start_line / 8 != shown && compare_with_buffer(pixels, 32) == 0;
+		char name[40];
+		snprintf(name, sizeof(name), "double buffer frame %d", frame);
+		failed += !check(name, ok, ssd1306_emu.stats.data_bytes);
+	}
+
+	ssd1306_double_buffer(&dev, false);
+	ssd1306_display_text(&dev, 3, "Single again", 12, false);
+	ssd1306_emu_render(pixels);
+	failed += !check("double buffer off", ssd1306_emu.start_line == 0 && compare_with_buffer(pixels, 32) == 0, 0);
+	return failed;
+}
+
+// With a flush task, a fade's contrast changes must not overtake its frames:
+// the blank frame goes out first, then the contrast restore
+static int run_fade_check(void)
+{
+	static SSD1306_Effect_t fx;
+	static uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	int failed = 0;
+
+	panel_open(PANEL_I2C, 64, false);
+	scene_text(&dev);
+	int full = ssd1306_emu.contrast;
+	ssd1306_start_flush_task(&dev, 1);
+	ssd1306_effect_start(&fx, &dev, EFFECT_FADE_OUT, NULL, 100);
+	ssd1306_emu_sleep_us(50000);
+	ssd1306_effect_step(&fx);
+	_ssd1306_flush_drain(&dev);
+	int dimmed = ssd1306_emu.contrast;
+
+	ssd1306_emu_sleep_us(60000);
+	ssd1306_effect_step(&fx);
+	bool held = ssd1306_emu.contrast == dimmed && dimmed < full;	// Both still queued
+	ssd1306_emu_stats_reset();
+	_ssd1306_flush_drain(&dev);
+	ssd1306_emu_render(pixels);
+	failed += !check("fade out: blank frame, then contrast", held && compare_with_buffer(pixels, 64) == 0 && ssd1306_emu.contrast == full
+		&& ssd1306_emu.stats.data_bytes > 0 && ssd1306_emu.stats.contrast_at == ssd1306_emu.stats.data_bytes,
+		ssd1306_emu.stats.data_bytes);
+
+	// Fade in: contrast 0 goes out ahead of the target frame
+	static uint8_t target[8][128];
+	scene_text(&dev);
+	ssd1306_get_buffer(&dev, &target[0][0]);
+	ssd1306_effect_start(&fx, &dev, EFFECT_FADE_IN, &target[0][0], 100);
+	ssd1306_effect_step(&fx);
+	ssd1306_emu_stats_reset();
+	_ssd1306_flush_drain(&dev);
+	failed += !check("fade in: contrast 0, then frame", ssd1306_emu.contrast == 0 && ssd1306_emu.stats.data_bytes > 0
+		&& ssd1306_emu.stats.contrast_at == 0, ssd1306_emu.stats.data_bytes);
+	return failed;
+}
+
+// Over one gray cycle every pixel must be lit in exactly `level` subframes
+static int run_gray_check(bool flip)
+{
+	static SSD1306_Gray_t gray;
+	static uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	static uint8_t lit[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	static uint8_t want[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+
+	panel_open(PANEL_I2C, 64, flip);
+	ssd1306_gray_init(&gray, &dev);
+	ssd1306_gray_clear(&gray, 1);
+	for (int level = 0; level < SSD1306_GRAY_LEVELS; level++) {
+		ssd1306_gray_fill_rect(&gray, level * 32, 21, 32, 30, level);
+	}
+	ssd1306_gray_text(&gray, 0, 0, "Gray 3", 6, 3);
+	ssd1306_gray_pixel(&gray, 127, 63, 2);
+
+	// Expected levels, drawn the same way without the driver
+	memset(want, 1, sizeof(want));
+	for (int y = 21; y < 51; y++) {
+		for (int x = 0; x < 128; x++) want[y * 128 + x] = x / 32;
+	}
+	for (int i = 0; i < 6; i++) {
+		const uint8_t * glyph = ssd1306_glyph((uint8_t)"Gray 3"[i], false);
+		for (int c = 0; c < 8; c++) {
+			for (int y = 0; y < 8; y++) want[y * 128 + i * 8 + c] = ((glyph[c] >> y) & 1) ? 3 : 0;
+		}
+	}
+	want[63 * 128 + 127] = 2;
+
+	memset(lit, 0, sizeof(lit));
+	ssd1306_emu_stats_reset();
+	for (int i = 0; i < SSD1306_GRAY_SUBFRAMES; i++) {
+		ssd1306_gray_step(&gray);
+		ssd1306_emu_render(pixels);
+		for (int p = 0; p < 64 * 128; p++) {
+			// Flipped panels show the image rotated 180 degrees
+			lit[flip ? 64 * 128 - 1 - p : p] += pixels[p];
+		}
+	}
+	int diff = 0;
+	for (int p = 0; p < 64 * 128; p++) diff += (lit[p] != want[p]);
+	return !check(flip ? "gray levels (flip)" : "gray levels", diff == 0 && ssd1306_emu.stats.transactions == SSD1306_GRAY_SUBFRAMES,
+		ssd1306_emu.stats.data_bytes);
+}
+
+// ------ Mirror stream: captured to mirror_capture.txt for tools/oled_mirror.py ------
+
+typedef struct {
+	FILE * f;
+	size_t last_len;
+} mirror_capture_t;
+
+static void mirror_capture(const char * line, size_t len, void * ctx)
+{
+	mirror_capture_t * cap = ctx;
+	fwrite(line, 1, len, cap->f);
+	cap->last_len = len;
+}
+
+// Ends on the text scene, so the viewer's last frame must equal text.pbm.
+// A corrupt line and a lost packet on the way force it to resync on a keyframe.
+static int run_mirror_check(void)
+{
+	static SSD1306_Mirror_t mirror;
+	mirror_capture_t cap = { fopen("mirror_capture.txt", "w"), 0 };
+	if (cap.f == NULL) return !check("mirror capture file", false, 0);
+	int failed = 0;
+
+	panel_open(PANEL_I2C, 64, false);
+	ssd1306_mirror_init(&mirror, &dev, mirror_capture, &cap);
+	ssd1306_mirror_update(&mirror);
+	failed += !check("mirror keyframe (blank)", cap.last_len < 24, cap.last_len);
+	failed += !check("mirror unchanged (no packet)", !ssd1306_mirror_update(&mirror), 0);
+
+	scene_text(&dev);
+	ssd1306_mirror_update(&mirror);
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEx", 16, false);
+	ssd1306_mirror_update(&mirror);
+	failed += !check("mirror one glyph", cap.last_len <= 40, cap.last_len);
+
+	fputs("I (1234) main: ordinary log line\n", cap.f);
+	fputs(SSD1306_MIRROR_PREFIX "RAAAA=garbage\n", cap.f);
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEy", 16, false);
+	FILE * f = cap.f;
+	cap.f = fopen("/dev/null", "w");	// This delta is lost
+	ssd1306_mirror_update(&mirror);
+	fclose(cap.f);
+	cap.f = f;
+	ssd1306_display_text(&dev, 2, "0123456789ABCDEF", 16, false);
+	ssd1306_mirror_update(&mirror);	// Delta the viewer must ignore
+	ssd1306_mirror_keyframe(&mirror);
+	ssd1306_mirror_update(&mirror);
+	failed += !check("mirror keyframe (text)", cap.last_len <= SSD1306_MIRROR_MAX_LINE, cap.last_len);
+
+	fclose(cap.f);
+	return failed;
+}
+
+// The pack must be read in place, and a missing or damaged one refused
+static int run_assets_check(void)
+{
+	static SSD1306_Assets_t pack;
+	static uint8_t data[0x40000];
+	SSD1306_Font_t font;
+	int failed = 0;
+
+	failed += !check("assets: no partition", ssd1306_assets_open(&pack, "missing") == ESP_ERR_NOT_FOUND, 0);
+
+	esp_err_t ret = ssd1306_assets_open(&pack, SSD1306_ASSETS_PARTITION);
+	bool in_place = ret == ESP_OK && ssd1306_assets_font(&pack, "digits16", &font) == ESP_OK
+		&& (const uint8_t *)font.header > pack.base && font.columns[1] < pack.base + pack.header->size;
+	failed += !check("assets: font read in place", in_place, 0);
+	failed += !check("assets: wrong type refused", ret == ESP_OK && ssd1306_assets_font(&pack, "icons16", &font) == ESP_ERR_NOT_FOUND, 0);
+	ssd1306_assets_close(&pack);
+
+	// The same pack with one bit of glyph data changed
+	FILE * f = fopen(assets_path, "rb");
+	size_t size = f ? fread(data, 1, sizeof(data), f) : 0;
+	if (f) fclose(f);
+	if (size) data[size - 1] ^= 0x01;
+	f = fopen("assets_corrupt.bin", "wb");
+	if (f) {
+		fwrite(data, 1, size, f);
+		fclose(f);
+	}
+	host_partition_file("corrupt", "assets_corrupt.bin");
+	failed += !check("assets: corrupt pack refused", size && ssd1306_assets_open(&pack, "corrupt") == ESP_ERR_INVALID_CRC, 0);
+	return failed;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <golden dir> [--update] [--assets <pack>] [scene...]\n", argv[0]);
+		return 2;
+	}
+	const char * golden_dir = argv[1];
+	bool update = false;
+	int first_scene = 2;
+	while (first_scene < argc && strncmp(argv[first_scene], "--", 2) == 0) {
+		if (strcmp(argv[first_scene], "--update") == 0) {
+			update = true;
+		} else if (strcmp(argv[first_scene], "--assets") == 0 && first_scene + 1 < argc) {
+			assets_path = argv[++first_scene];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[first_scene]);
+			return 2;
+		}
+		first_scene++;
+	}
+	if (assets_path) host_partition_file(SSD1306_ASSETS_PARTITION, assets_path);
+
+	int failed = 0;
+	int count = sizeof(scenes) / sizeof(scenes[0]);
+	for (int i = 0; i < count; i++) {
+		bool selected = (first_scene >= argc);
+		for (int a = first_scene; a < argc; a++) {
+			if (strcmp(argv[a], scenes[i].name) == 0) selected = true;
+		}
+		if (selected && !run_scene(&scenes[i], golden_dir, update)) failed++;
+	}
+	if (first_scene >= argc) {
+		failed += run_traffic_checks();
+		failed += run_fade_check();
+		failed += run_gray_check(false);
+		failed += run_gray_check(true);
+		failed += run_mirror_check();
+		if (assets_path) failed += run_assets_check();
+	}
+
+	if (failed) printf("%d failed\n", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+// Host build: GPIO levels are recorded so the SPI transport can read the D/C pin
+#ifndef HOST_GPIO_H_
+#define HOST_GPIO_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+	GPIO_MODE_INPUT = 1,
+	GPIO_MODE_OUTPUT = 2,
+} gpio_mode_t;
+
+typedef enum {
+	GPIO_PULLUP_DISABLE = 0,
+	GPIO_PULLUP_ENABLE = 1,
+} gpio_pullup_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t gpio_reset_pin(gpio_num_t pin);
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+int gpio_get_level(gpio_num_t pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_GPIO_H_ */
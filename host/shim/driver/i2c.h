@@ -0,0 +1,57 @@
+// Host build: legacy I2C command links are recorded and played into the emulator
+#ifndef HOST_I2C_H_
+#define HOST_I2C_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+#define I2C_NUM_1 1
+
+typedef enum { I2C_MODE_SLAVE = 0, I2C_MODE_MASTER } i2c_mode_t;
+typedef enum { I2C_MASTER_WRITE = 0, I2C_MASTER_READ } i2c_rw_t;
+typedef enum { I2C_MASTER_ACK = 0, I2C_MASTER_NACK = 1, I2C_MASTER_LAST_NACK = 2 } i2c_ack_type_t;
+
+typedef struct {
+	i2c_mode_t mode;
+	int sda_io_num;
+	int scl_io_num;
+	bool sda_pullup_en;
+	bool scl_pullup_en;
+	union {
+		struct {
+			uint32_t clk_speed;
+		} master;
+	};
+	uint32_t clk_flags;
+} i2c_config_t;
+
+typedef struct host_i2c_cmd * i2c_cmd_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t * conf);
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf, size_t tx_buf, int flags);
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t * data, size_t len, bool ack_en);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t * data, i2c_ack_type_t ack);
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_I2C_H_ */
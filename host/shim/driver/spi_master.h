@@ -0,0 +1,77 @@
+// Host build: SPI transactions go to the emulator, D/C taken from the GPIO level
+#ifndef HOST_SPI_MASTER_H_
+#define HOST_SPI_MASTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int spi_host_device_t;
+#define SPI1_HOST 0
+#define SPI2_HOST 1
+#define SPI3_HOST 2
+#define SPI_DMA_CH_AUTO 3
+
+typedef struct {
+	int mosi_io_num;
+	int miso_io_num;
+	int sclk_io_num;
+	int quadwp_io_num;
+	int quadhd_io_num;
+	int max_transfer_sz;
+	uint32_t flags;
+} spi_bus_config_t;
+
+typedef struct spi_transaction_t spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t * trans);
+
+typedef struct {
+	uint8_t mode;
+	int clock_speed_hz;
+	int spics_io_num;
+	uint32_t flags;
+	int queue_size;
+	transaction_cb_t pre_cb;
+	transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+
+struct spi_transaction_t {
+	uint32_t flags;
+	uint16_t cmd;
+	uint64_t addr;
+	size_t length;		// Bits
+	size_t rxlength;
+	void * user;
+	union {
+		const void * tx_buffer;
+		uint8_t tx_data[4];
+	};
+	union {
+		void * rx_buffer;
+		uint8_t rx_data[4];
+	};
+};
+
+typedef struct host_spi_device * spi_device_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t * config, int dma);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t * config, spi_device_handle_t * handle);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t * trans);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t * trans, TickType_t ticks);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t ** trans, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SPI_MASTER_H_ */
@@ -0,0 +1,7 @@
+// Host build: no IRAM placement
+#ifndef HOST_ESP_ATTR_H_
+#define HOST_ESP_ATTR_H_
+
+#define IRAM_ATTR
+
+#endif /* HOST_ESP_ATTR_H_ */
@@ -0,0 +1,8 @@
+// Host build: pretend to be the IDF release the firmware targets (legacy I2C driver)
+#ifndef HOST_ESP_IDF_VERSION_H_
+#define HOST_ESP_IDF_VERSION_H_
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 1, 0)
+
+#endif /* HOST_ESP_IDF_VERSION_H_ */
@@ -0,0 +1,17 @@
+// Host build: the ROM CRC-32 used to check asset packs
+#ifndef HOST_ESP_ROM_CRC_H_
+#define HOST_ESP_ROM_CRC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t * buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_ESP_ROM_CRC_H_ */
@@ -0,0 +1,17 @@
+// Host build: busy-wait delays advance the emulator's virtual clock
+#ifndef HOST_ESP_ROM_SYS_H_
+#define HOST_ESP_ROM_SYS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_rom_delay_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_ESP_ROM_SYS_H_ */
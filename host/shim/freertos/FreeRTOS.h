@@ -0,0 +1,25 @@
+// Host build: FreeRTOS types for a single-threaded run with a 100 Hz virtual tick
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_idf_version.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ   100
+#define portTICK_PERIOD_MS   (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+#endif /* HOST_FREERTOS_H_ */
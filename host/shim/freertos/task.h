@@ -0,0 +1,29 @@
+// Host build: delays advance the virtual clock; task creation fails, so the
+// driver stays in its synchronous (no flush task) mode
+#ifndef HOST_TASK_H_
+#define HOST_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task * TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t * previous, TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char * name, uint32_t stack, void * arg, UBaseType_t priority, TaskHandle_t * handle);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskDelete(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_TASK_H_ */
@@ -0,0 +1,476 @@
+// Host stand-ins for the ESP-IDF / FreeRTOS calls made by the SSD1306 driver.
+// Bus traffic is handed to the controller model in ssd1306_emu.c; time is the
+// emulator's virtual clock, so delays cost nothing and results are repeatable.
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/spi_master.h"
+#include "i2c_bus.h"
+
+#include "ssd1306_emu.h"
+
+int host_log_verbose = 0;
+
+const char * esp_err_to_name(esp_err_t code)
+{
+	switch (code) {
+	case ESP_OK: return "ESP_OK";
+	case ESP_FAIL: return "ESP_FAIL";
+	case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+	case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+	case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+	}
+	return "UNKNOWN ERROR";
+}
+
+int64_t esp_timer_get_time(void)
+{
+	return ssd1306_emu_time_us();
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+	ssd1306_emu_sleep_us(us);
+}
+
+// ------ GPIO ------
+
+#define HOST_GPIO_COUNT 64
+
+static uint8_t gpio_levels[HOST_GPIO_COUNT];
+
+esp_err_t gpio_reset_pin(gpio_num_t pin)
+{
+	if (pin < 0 || pin >= HOST_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+	gpio_levels[pin] = 0;
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode)
+{
+	(void)mode;
+	if (pin < 0 || pin >= HOST_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+	if (pin < 0 || pin >= HOST_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+	gpio_levels[pin] = level ? 1 : 0;
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+	if (pin < 0 || pin >= HOST_GPIO_COUNT) return 0;
+	return gpio_levels[pin];
+}
+
+// ------ FreeRTOS ------
+
+struct host_semaphore {
+	int taken;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	return calloc(1, sizeof(struct host_semaphore));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	(void)ticks;
+	if (sem->taken) return pdFALSE;	// Would deadlock: nobody else can give it back
+	sem->taken = 1;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	if (!sem->taken) return pdFALSE;
+	sem->taken = 0;
+	return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	free(sem);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	ssd1306_emu_sleep_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(ssd1306_emu_time_us() / (portTICK_PERIOD_MS * 1000));
+}
+
+void vTaskDelayUntil(TickType_t * previous, TickType_t ticks)
+{
+	TickType_t wake = *previous + ticks;
+	TickType_t now = xTaskGetTickCount();
+	if ((int32_t)(wake - now) > 0) vTaskDelay(wake - now);
+	*previous = wake;
+}
+
+// No scheduler: callers that can run without a task (the flush task) fall
+// back to their synchronous path.
+// Tasks are created but never run: tests do a task's work by hand, e.g. a
+// flush task wake with _ssd1306_flush_drain
+BaseType_t xTaskCreate(TaskFunction_t fn, const char * name, uint32_t stack, void * arg, UBaseType_t priority, TaskHandle_t * handle)
+{
+	(void)fn; (void)name; (void)stack; (void)arg; (void)priority;
+	if (handle) *handle = NULL;
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	(void)clear; (void)ticks;
+	return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	(void)task;
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	(void)task;
+}
+
+// ------ Legacy I2C driver: command links are recorded, then replayed ------
+
+typedef enum {
+	HOST_I2C_START,
+	HOST_I2C_WRITE,
+	HOST_I2C_READ,
+	HOST_I2C_STOP
+} host_i2c_op_t;
+
+typedef struct {
+	host_i2c_op_t op;
+	uint8_t byte;
+	uint8_t * dest;
+} host_i2c_step_t;
+
+struct host_i2c_cmd {
+	host_i2c_step_t * steps;
+	size_t count;
+	size_t size;
+};
+
+static esp_err_t i2c_push(i2c_cmd_handle_t cmd, host_i2c_op_t op, uint8_t byte, uint8_t * dest)
+{
+	if (cmd->count == cmd->size) {
+		size_t size = cmd->size ? cmd->size * 2 : 64;
+		host_i2c_step_t * steps = realloc(cmd->steps, size * sizeof(host_i2c_step_t));
+		if (steps == NULL) return ESP_ERR_NO_MEM;
+		cmd->steps = steps;
+		cmd->size = size;
+	}
+	cmd->steps[cmd->count++] = (host_i2c_step_t){ op, byte, dest };
+	return ESP_OK;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t * conf)
+{
+	(void)port;
+	ssd1306_emu_set_i2c_hz(conf->master.clk_speed);
+	return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf, size_t tx_buf, int flags)
+{
+	(void)port; (void)mode; (void)rx_buf; (void)tx_buf; (void)flags;
+	return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+	return calloc(1, sizeof(struct host_i2c_cmd));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+	if (cmd == NULL) return;
+	free(cmd->steps);
+	free(cmd);
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd)
+{
+	return i2c_push(cmd, HOST_I2C_START, 0, NULL);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd)
+{
+	return i2c_push(cmd, HOST_I2C_STOP, 0, NULL);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en)
+{
+	(void)ack_en;
+	return i2c_push(cmd, HOST_I2C_WRITE, data, NULL);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t * data, size_t len, bool ack_en)
+{
+	(void)ack_en;
+	for (size_t i = 0; i < len; i++) {
+		esp_err_t err = i2c_push(cmd, HOST_I2C_WRITE, data[i], NULL);
+		if (err != ESP_OK) return err;
+	}
+	return ESP_OK;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t * data, i2c_ack_type_t ack)
+{
+	(void)ack;
+	return i2c_push(cmd, HOST_I2C_READ, 0, data);
+}
+
+// Each START opens a segment; its bytes go to the emulator as one write
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks)
+{
+	(void)port; (void)ticks;
+	uint8_t * segment = malloc(cmd->count ? cmd->count : 1);
+	if (segment == NULL) return ESP_ERR_NO_MEM;
+	size_t len = 0;
+	bool acked = true;
+
+	ssd1306_emu_i2c_transaction();
+	if (ssd1306_emu.nack_transactions > 0) {
+		ssd1306_emu.nack_transactions--;
+		acked = false;
+	}
+	for (size_t i = 0; i < cmd->count && acked; i++) {
+		host_i2c_step_t * step = &cmd->steps[i];
+		switch (step->op) {
+		case HOST_I2C_START:
+		case HOST_I2C_STOP:
+			if (len) acked = ssd1306_emu_i2c_write(segment, len);
+			len = 0;
+			break;
+		case HOST_I2C_WRITE:
+			segment[len++] = step->byte;
+			break;
+		case HOST_I2C_READ:
+			if (len) acked = ssd1306_emu_i2c_write(segment, len);
+			len = 0;
+			if (acked) *step->dest = ssd1306_emu_i2c_read();
+			break;
+		}
+	}
+	if (acked && len) acked = ssd1306_emu_i2c_write(segment, len);
+	free(segment);
+	return acked ? ESP_OK : ESP_FAIL;
+}
+
+// i2c_bus.c drives real pins; on the host the bus lock has nothing to do
+esp_err_t I2C_BUS_Begin(i2c_port_t port, uint8_t address, TickType_t ticks)
+{
+	(void)port; (void)address; (void)ticks;
+	return ESP_OK;
+}
+
+void I2C_BUS_End(i2c_port_t port)
+{
+	(void)port;
+}
+
+// ------ SPI master ------
+
+#define HOST_SPI_QUEUE 64
+
+// Queued transactions are sent at once (the emulated bus never stalls) and
+// handed back in order by spi_device_get_trans_result()
+struct host_spi_device {
+	int clock_speed_hz;
+	int queue_size;
+	transaction_cb_t pre_cb;
+	spi_transaction_t * done[HOST_SPI_QUEUE];
+	int head;
+	int count;
+};
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t * config, int dma)
+{
+	(void)host; (void)config; (void)dma;
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t * config, spi_device_handle_t * handle)
+{
+	(void)host;
+	if (config->queue_size > HOST_SPI_QUEUE) return ESP_ERR_INVALID_ARG;
+	spi_device_handle_t device = calloc(1, sizeof(struct host_spi_device));
+	if (device == NULL) return ESP_ERR_NO_MEM;
+	device->clock_speed_hz = config->clock_speed_hz;
+	device->queue_size = config->queue_size;
+	device->pre_cb = config->pre_cb;
+	ssd1306_emu_set_spi_hz(config->clock_speed_hz);
+	*handle = device;
+	return ESP_OK;
+}
+
+// D/C is whatever level is on the pin set with ssd1306_emu_set_spi_dc() once
+// the pre-transmit callback has run
+static void spi_send(spi_device_handle_t handle, spi_transaction_t * trans)
+{
+	if (handle->pre_cb) handle->pre_cb(trans);
+	const uint8_t * bytes = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : trans->tx_buffer;
+	bool data = ssd1306_emu.spi_dc >= 0 && gpio_get_level(ssd1306_emu.spi_dc);
+	ssd1306_emu_spi_transaction(bytes, trans->length / 8, data);
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t * trans)
+{
+	if (handle->count) return ESP_ERR_INVALID_STATE;	// IDF: results still pending
+	spi_send(handle, trans);
+	return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t * trans, TickType_t ticks)
+{
+	(void)ticks;
+	// The IDF would block until a result is collected; with no task to do that, it is a bug here
+	if (handle->count >= handle->queue_size) return ESP_ERR_TIMEOUT;
+	spi_send(handle, trans);
+	handle->done[(handle->head + handle->count) % HOST_SPI_QUEUE] = trans;
+	handle->count++;
+	return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t ** trans, TickType_t ticks)
+{
+	(void)ticks;
+	if (handle->count == 0) return ESP_ERR_TIMEOUT;
+	*trans = handle->done[handle->head];
+	handle->head = (handle->head + 1) % HOST_SPI_QUEUE;
+	handle->count--;
+	return ESP_OK;
+}
+
+// ------ Flash partitions: files registered with host_partition_file ------
+
+#define HOST_PARTITIONS 4
+#define HOST_MAPPINGS 8
+
+static struct {
+	esp_partition_t part;
+	char path[256];
+} host_partitions[HOST_PARTITIONS];
+
+static struct {
+	void * ptr;
+	size_t size;
+} host_mappings[HOST_MAPPINGS];
+
+void host_partition_file(const char * label, const char * path)
+{
+	int free_slot = -1;
+	for (int i = 0; i < HOST_PARTITIONS; i++) {
+		if (host_partitions[i].path[0] && strcmp(host_partitions[i].part.label, label) == 0) {
+			host_partitions[i].path[0] = '\0';
+		}
+		if (free_slot < 0 && host_partitions[i].path[0] == '\0') free_slot = i;
+	}
+	if (path == NULL || free_slot < 0) return;
+	esp_partition_t * part = &host_partitions[free_slot].part;
+	memset(part, 0, sizeof(esp_partition_t));
+	part->type = ESP_PARTITION_TYPE_DATA;
+	part->subtype = (esp_partition_subtype_t)0x40;
+	strncpy(part->label, label, sizeof(part->label) - 1);
+	strncpy(host_partitions[free_slot].path, path, sizeof(host_partitions[free_slot].path) - 1);
+}
+
+// The partition is as large as its file at the time of the lookup
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char * label)
+{
+	for (int i = 0; i < HOST_PARTITIONS; i++) {
+		esp_partition_t * part = &host_partitions[i].part;
+		if (host_partitions[i].path[0] == '\0') continue;
+		if (type != ESP_PARTITION_TYPE_ANY && part->type != type) continue;
+		if (subtype != ESP_PARTITION_SUBTYPE_ANY && part->subtype != subtype) continue;
+		if (label && strcmp(part->label, label) != 0) continue;
+		struct stat st;
+		if (stat(host_partitions[i].path, &st) != 0) return NULL;
+		part->size = (uint32_t)st.st_size;
+		return part;
+	}
+	return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t * partition, size_t offset, size_t size,
+	esp_partition_mmap_memory_t memory, const void ** out_ptr, esp_partition_mmap_handle_t * out_handle)
+{
+	(void)memory;
+	if (offset + size > partition->size || size == 0) return ESP_ERR_INVALID_ARG;
+	int slot = 0;
+	while (slot < HOST_MAPPINGS && host_mappings[slot].ptr) slot++;
+	if (slot == HOST_MAPPINGS) return ESP_ERR_NO_MEM;
+
+	const char * path = NULL;
+	for (int i = 0; i < HOST_PARTITIONS; i++) {
+		if (partition == &host_partitions[i].part) path = host_partitions[i].path;
+	}
+	int fd = path ? open(path, O_RDONLY) : -1;
+	if (fd < 0) return ESP_ERR_NOT_FOUND;
+	void * ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+	close(fd);
+	if (ptr == MAP_FAILED) return ESP_ERR_NO_MEM;
+
+	host_mappings[slot].ptr = ptr;
+	host_mappings[slot].size = size;
+	*out_ptr = ptr;
+	*out_handle = slot;
+	return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+	if (handle >= HOST_MAPPINGS || host_mappings[handle].ptr == NULL) return;
+	munmap(host_mappings[handle].ptr, host_mappings[handle].size);
+	host_mappings[handle].ptr = NULL;
+}
+
+// Same result as the ROM routine: crc32_le(0, ...) is the zlib CRC-32
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t * buf, uint32_t len)
+{
+	crc = ~crc;
+	for (uint32_t i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		}
+	}
+	return ~crc;
+}
@@ -0,0 +1,467 @@
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "ssd1306_emu.h"
+
+// Panel frame period with the driver's settings (D5=80, D9=22, 64 MUX):
+// ~370 kHz / (54 DCLKs * 64 rows) = ~107 Hz
+#define EMU_FRAME_NS 9346000LL
+
+// I2C: every byte is 8 bits + ACK; START and STOP cost about one bit each
+#define EMU_I2C_BYTE_BITS 9
+#define EMU_I2C_START_STOP_BITS 2
+
+SSD1306_Emu_t ssd1306_emu;
+
+// GDDRAM is not cleared at power-up; a fixed pattern makes any page the
+// driver forgets to write show up in a render.
+static void emu_fill_noise(void)
+{
+	uint32_t seed = 0x1306;
+	for (int page = 0; page < SSD1306_EMU_PAGES; page++) {
+		for (int col = 0; col < SSD1306_EMU_COLUMNS; col++) {
+			seed = seed * 1103515245u + 12345u;
+			ssd1306_emu.ram[page][col] = seed >> 24;
+		}
+	}
+}
+
+void ssd1306_emu_reset(void)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	memset(e, 0, sizeof(SSD1306_Emu_t));
+	emu_fill_noise();
+
+	// Datasheet reset values
+	e->mode = EMU_ADDR_PAGE;
+	e->col_end = SSD1306_EMU_COLUMNS - 1;
+	e->page_end = SSD1306_EMU_PAGES - 1;
+	e->mux = SSD1306_EMU_ROWS - 1;
+	e->contrast = 0x7F;
+
+	e->address = 0x3C;
+	e->spi_dc = -1;
+	e->i2c_hz = 400000;
+	e->spi_hz = 1000000;
+}
+
+// Rotate pages [start, end] by one column. Directions are as seen on the
+// panel (see ssd1306_emu_render): with remap (A1) left moves RAM columns
+// down, without it the column address runs right to left.
+static void emu_shift_columns(int start, int end, int col_start, int col_end, bool right)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	bool toward_lower = (right != e->seg_remap);
+	if (col_end >= SSD1306_EMU_COLUMNS) col_end = SSD1306_EMU_COLUMNS - 1;
+	if (col_start > col_end) return;
+	int len = col_end - col_start;
+
+	for (int page = start; page <= end && page < SSD1306_EMU_PAGES; page++) {
+		uint8_t * row = &e->ram[page][col_start];
+		if (toward_lower) {
+			uint8_t first = row[0];
+			memmove(row, row + 1, len);
+			row[len] = first;
+		} else {
+			uint8_t last = row[len];
+			memmove(row + 1, row, len);
+			row[0] = last;
+		}
+	}
+}
+
+static void emu_scroll_step(void)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	bool right = (e->scroll_cmd == 0x26 || e->scroll_cmd == 0x29);
+	if (e->scroll_cmd == 0x26 || e->scroll_cmd == 0x27) {
+		emu_shift_columns(e->scroll_start, e->scroll_end, 0, SSD1306_EMU_COLUMNS - 1, right);
+	} else {
+		// 29/2A: horizontal and vertical move together on each step
+		emu_shift_columns(e->scroll_start, e->scroll_end, 0, SSD1306_EMU_COLUMNS - 1, right);
+		e->scroll_shift = (e->scroll_shift + e->scroll_vertical) % SSD1306_EMU_ROWS;
+	}
+}
+
+void ssd1306_emu_advance_frames(int frames)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	if (!e->scrolling || e->scroll_interval <= 0) return;
+	e->scroll_frames += frames;
+	while (e->scroll_frames >= e->scroll_interval) {
+		e->scroll_frames -= e->scroll_interval;
+		emu_scroll_step();
+	}
+}
+
+static void emu_advance_ns(int64_t ns)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->time_ns += ns;
+	e->frame_ns += ns;
+	if (e->frame_ns >= EMU_FRAME_NS) {
+		int frames = e->frame_ns / EMU_FRAME_NS;
+		e->frame_ns -= (int64_t)frames * EMU_FRAME_NS;
+		ssd1306_emu_advance_frames(frames);
+	}
+}
+
+int64_t ssd1306_emu_time_us(void)
+{
+	return ssd1306_emu.time_ns / 1000;
+}
+
+void ssd1306_emu_sleep_us(int64_t us)
+{
+	if (us > 0) emu_advance_ns(us * 1000);
+}
+
+static void emu_bus_time(int64_t bits, uint32_t hz)
+{
+	if (hz == 0) return;
+	int64_t ns = bits * 1000000000LL / hz;
+	ssd1306_emu.stats.bus_ns += ns;
+	emu_advance_ns(ns);
+}
+
+// Number of argument bytes following a command byte
+static int emu_command_args(uint8_t cmd)
+{
+	switch (cmd) {
+	case 0x81:	// Contrast
+	case 0x8D:	// Charge pump
+	case 0x20:	// Memory addressing mode
+	case 0xA8:	// MUX ratio
+	case 0xD3:	// Display offset
+	case 0xD5:	// Clock divide
+	case 0xD9:	// Pre-charge period
+	case 0xDA:	// COM pins
+	case 0xDB:	// VCOMH
+	case 0x23:	// Fade out / blink
+	case 0xD6:	// Zoom in
+		return 1;
+	case 0x21:	// Column range
+	case 0x22:	// Page range
+	case 0xA3:	// Vertical scroll area
+		return 2;
+	case 0x29:	// Vertical and right scroll
+	case 0x2A:	// Vertical and left scroll
+		return 5;
+	case 0x26:	// Right scroll
+	case 0x27:	// Left scroll
+	case 0x2C:	// One column right (content scroll)
+	case 0x2D:	// One column left
+		return 6;
+	}
+	return 0;
+}
+
+static void emu_execute(const uint8_t * c)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	uint8_t cmd = c[0];
+
+	if (cmd <= 0x0F) {	// Lower column nibble (page mode)
+		e->col = (e->col & 0xF0) | cmd;
+		return;
+	}
+	if (cmd >= 0x10 && cmd <= 0x1F) {	// Upper column nibble (page mode)
+		e->col = ((cmd & 0x0F) << 4) | (e->col & 0x0F);
+		return;
+	}
+	if (cmd >= 0x40 && cmd <= 0x7F) {
+		e->start_line = cmd & 0x3F;
+		return;
+	}
+	if (cmd >= 0xB0 && cmd <= 0xB7) {	// Page start (page mode)
+		e->page = cmd & 0x07;
+		return;
+	}
+
+	switch (cmd) {
+	case 0x81:
+		e->contrast = c[1];
+		e->stats.contrast_at = e->stats.data_bytes;
+		break;
+	case 0x8D: e->charge_pump = (c[1] & 0x04) != 0; break;
+	case 0x20:
+		e->mode = (ssd1306_emu_addr_mode_t)(c[1] & 0x03);
+		if (e->mode > EMU_ADDR_PAGE) e->mode = EMU_ADDR_PAGE;
+		break;
+	case 0x21:
+		e->col_start = c[1] & 0x7F;
+		e->col_end = c[2] & 0x7F;
+		e->col = e->col_start;
+		break;
+	case 0x22:
+		e->page_start = c[1] & 0x07;
+		e->page_end = c[2] & 0x07;
+		e->page = e->page_start;
+		break;
+	case 0xA8: e->mux = (c[1] & 0x3F) < 15 ? e->mux : (c[1] & 0x3F); break;
+	case 0xD3: e->offset = c[1] & 0x3F; break;
+	case 0xA0: e->seg_remap = false; break;
+	case 0xA1: e->seg_remap = true; break;
+	case 0xC0: e->com_reverse = false; break;
+	case 0xC8: e->com_reverse = true; break;
+	case 0xA4: e->entire_on = false; break;
+	case 0xA5: e->entire_on = true; break;
+	case 0xA6: e->inverse = false; break;
+	case 0xA7: e->inverse = true; break;
+	case 0xAE: e->on = false; break;
+	case 0xAF: e->on = true; break;
+	case 0x26:
+	case 0x27:
+	case 0x29:
+	case 0x2A: {
+		// Frame intervals for codes 0-7
+		static const int interval[8] = { 5, 64, 128, 256, 3, 4, 25, 2 };
+		e->scroll_cmd = cmd;
+		e->scroll_start = c[2] & 0x07;
+		e->scroll_interval = interval[c[3] & 0x07];
+		e->scroll_end = c[4] & 0x07;
+		e->scroll_vertical = (cmd == 0x29 || cmd == 0x2A) ? (c[5] & 0x3F) : 0;
+		break;
+	}
+	case 0x2C:
+	case 0x2D:
+		// Ignored while a continuous scroll is active, like the controller
+		if (!e->scrolling) {
+			emu_shift_columns(c[2] & 0x07, c[4] & 0x07, c[5] & 0x7F, c[6] & 0x7F, cmd == 0x2C);
+		}
+		break;
+	case 0x2E:
+		e->scrolling = false;
+		e->scroll_shift = 0;
+		break;
+	case 0x2F:
+		e->scrolling = true;
+		e->scroll_frames = 0;
+		break;
+	case 0xA3:	// Scroll area: whole panel assumed
+	case 0xD5:
+	case 0xD9:
+	case 0xDA:
+	case 0xDB:
+	case 0x23:
+	case 0xD6:
+	case 0xE3:
+		break;
+	default:
+		e->unknown_commands++;
+		break;
+	}
+}
+
+void ssd1306_emu_command(uint8_t byte)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->stats.command_bytes++;
+
+	if (e->cmd_len == 0) {
+		e->cmd_need = emu_command_args(byte);
+	}
+	e->cmd[e->cmd_len++] = byte;
+	if (e->cmd_len > e->cmd_need) {
+		emu_execute(e->cmd);
+		e->cmd_len = 0;
+	}
+}
+
+void ssd1306_emu_data(uint8_t byte)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->stats.data_bytes++;
+	if (e->col < SSD1306_EMU_COLUMNS && e->page < SSD1306_EMU_PAGES) {
+		e->ram[e->page][e->col] = byte;
+	}
+
+	switch (e->mode) {
+	case EMU_ADDR_HORIZONTAL:
+		if (++e->col > e->col_end) {
+			e->col = e->col_start;
+			if (++e->page > e->page_end) e->page = e->page_start;
+		}
+		break;
+	case EMU_ADDR_VERTICAL:
+		if (++e->page > e->page_end) {
+			e->page = e->page_start;
+			if (++e->col > e->col_end) e->col = e->col_start;
+		}
+		break;
+	case EMU_ADDR_PAGE:
+		if (++e->col > e->col_end) e->col = e->col_start;
+		break;
+	}
+}
+
+void ssd1306_emu_i2c_transaction(void)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->stats.transactions++;
+	emu_bus_time(EMU_I2C_START_STOP_BITS, e->i2c_hz);
+}
+
+// One START segment. Control bytes: bit 7 (Co) = only one byte follows,
+// bit 6 (D/C#) = data. With Co clear the rest of the segment is a stream.
+bool ssd1306_emu_i2c_write(const uint8_t * bytes, size_t len)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	if (len == 0) return false;
+	e->stats.bus_bytes += len;
+	emu_bus_time((int64_t)len * EMU_I2C_BYTE_BITS, e->i2c_hz);
+	if ((bytes[0] >> 1) != e->address) return false;	// NACK
+	if (bytes[0] & 1) return true;	// Read: bytes come from ssd1306_emu_i2c_read()
+
+	size_t i = 1;
+	while (i < len) {
+		uint8_t control = bytes[i++];
+		bool data = (control & 0x40) != 0;
+		if (control & 0x80) {
+			if (i >= len) break;
+			if (data) ssd1306_emu_data(bytes[i++]);
+			else ssd1306_emu_command(bytes[i++]);
+			continue;
+		}
+		for (; i < len; i++) {
+			if (data) ssd1306_emu_data(bytes[i]);
+			else ssd1306_emu_command(bytes[i]);
+		}
+	}
+	return true;
+}
+
+// Status register: D6 set while the display is off
+uint8_t ssd1306_emu_i2c_read(void)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->stats.bus_bytes++;
+	emu_bus_time(EMU_I2C_BYTE_BITS, e->i2c_hz);
+	return e->on ? 0x00 : 0x40;
+}
+
+void ssd1306_emu_spi_transaction(const uint8_t * bytes, size_t len, bool data)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	e->stats.transactions++;
+	e->stats.bus_bytes += len;
+	emu_bus_time((int64_t)len * 8, e->spi_hz);
+	for (size_t i = 0; i < len; i++) {
+		if (data) ssd1306_emu_data(bytes[i]);
+		else ssd1306_emu_command(bytes[i]);
+	}
+}
+
+void ssd1306_emu_set_i2c_hz(uint32_t hz)
+{
+	ssd1306_emu.i2c_hz = hz;
+}
+
+void ssd1306_emu_set_spi_hz(uint32_t hz)
+{
+	ssd1306_emu.spi_hz = hz;
+}
+
+void ssd1306_emu_set_spi_dc(int pin)
+{
+	ssd1306_emu.spi_dc = pin;
+}
+
+void ssd1306_emu_stats_reset(void)
+{
+	memset(&ssd1306_emu.stats, 0, sizeof(SSD1306_EmuStats_t));
+}
+
+int ssd1306_emu_rows(void)
+{
+	return ssd1306_emu.mux + 1;
+}
+
+// What the viewer sees. The modules this driver targets are mounted so that
+// A1 + C8 (the driver's non-flipped setup) shows column 0 / row 0 top left.
+void ssd1306_emu_render(uint8_t * pixels)
+{
+	SSD1306_Emu_t * e = &ssd1306_emu;
+	int rows = ssd1306_emu_rows();
+
+	for (int y = 0; y < rows; y++) {
+		int com = e->com_reverse ? y : (rows - 1 - y);
+		int line = (com + e->start_line + e->offset + e->scroll_shift) % SSD1306_EMU_ROWS;
+		for (int x = 0; x < SSD1306_EMU_COLUMNS; x++) {
+			int col = e->seg_remap ? x : (SSD1306_EMU_COLUMNS - 1 - x);
+			bool lit = (e->ram[line / 8][col] >> (line % 8)) & 1;
+			if (e->inverse) lit = !lit;
+			if (e->entire_on) lit = true;
+			if (!e->on) lit = false;
+			pixels[y * SSD1306_EMU_COLUMNS + x] = lit;
+		}
+	}
+}
+
+// Binary PBM. Lit pixels are written white (0) so files look like the panel.
+bool ssd1306_emu_write_pbm(const char * path)
+{
+	uint8_t pixels[SSD1306_EMU_ROWS * SSD1306_EMU_COLUMNS];
+	int rows = ssd1306_emu_rows();
+	ssd1306_emu_render(pixels);
+
+	FILE * f = fopen(path, "wb");
+	if (f == NULL) return false;
+	fprintf(f, "P4\n%d %d\n", SSD1306_EMU_COLUMNS, rows);
+	for (int y = 0; y < rows; y++) {
+		uint8_t line[SSD1306_EMU_COLUMNS / 8] = { 0 };
+		for (int x = 0; x < SSD1306_EMU_COLUMNS; x++) {
+			if (!pixels[y * SSD1306_EMU_COLUMNS + x]) line[x / 8] |= 0x80 >> (x % 8);
+		}
+		fwrite(line, 1, sizeof(line), f);
+	}
+	return fclose(f) == 0;
+}
+
+static int pbm_number(FILE * f)
+{
+	int ch = fgetc(f);
+	while (ch != EOF && (isspace(ch) || ch == '#')) {
+		if (ch == '#') {
+			while (ch != EOF && ch != '\n') ch = fgetc(f);
+		}
+		ch = fgetc(f);
+	}
+	int value = 0;
+	while (ch != EOF && isdigit(ch)) {
+		value = value * 10 + (ch - '0');
+		ch = fgetc(f);
+	}
+	return value;
+}
+
+// Reads a P4 file written by ssd1306_emu_write_pbm into 0/1 lit pixels
+bool ssd1306_emu_read_pbm(const char * path, uint8_t * pixels, int * width, int * height)
+{
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) return false;
+	char magic[2];
+	if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || magic[1] != '4') {
+		fclose(f);
+		return false;
+	}
+	*width = pbm_number(f);
+	*height = pbm_number(f);
+	if (*width != SSD1306_EMU_COLUMNS || *height <= 0 || *height > SSD1306_EMU_ROWS) {
+		fclose(f);
+		return false;
+	}
+	for (int y = 0; y < *height; y++) {
+		uint8_t line[SSD1306_EMU_COLUMNS / 8];
+		if (fread(line, 1, sizeof(line), f) != sizeof(line)) {
+			fclose(f);
+			return false;
+		}
+		for (int x = 0; x < SSD1306_EMU_COLUMNS; x++) {
+			pixels[y * SSD1306_EMU_COLUMNS + x] = !(line[x / 8] & (0x80 >> (x % 8)));
+		}
+	}
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,122 @@
+#ifndef HOST_SSD1306_EMU_H_
+#define HOST_SSD1306_EMU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// SSD1306 controller model for host builds. The IDF shims feed it the exact
+// byte streams the driver puts on the wire (I2C control bytes, SPI D/C), it
+// decodes them like the controller does and keeps GDDRAM plus the display
+// state, so frames can be rendered as the panel would show them.
+
+#define SSD1306_EMU_COLUMNS 128
+#define SSD1306_EMU_PAGES 8
+#define SSD1306_EMU_ROWS (SSD1306_EMU_PAGES * 8)
+
+typedef enum {
+	EMU_ADDR_HORIZONTAL = 0,
+	EMU_ADDR_VERTICAL = 1,
+	EMU_ADDR_PAGE = 2
+} ssd1306_emu_addr_mode_t;
+
+// Bus traffic since the last ssd1306_emu_stats_reset()
+typedef struct {
+	uint32_t transactions;	// I2C START..STOP or SPI transactions
+	uint32_t bus_bytes;		// Everything clocked out, I2C address and control bytes included
+	uint32_t data_bytes;	// GDDRAM writes
+	uint32_t command_bytes;	// Commands and their arguments
+	uint32_t contrast_at;	// data_bytes when the last contrast command arrived
+	int64_t bus_ns;		// Modelled wire time at the configured clock
+} SSD1306_EmuStats_t;
+
+typedef struct {
+	uint8_t ram[SSD1306_EMU_PAGES][SSD1306_EMU_COLUMNS];
+
+	// Addressing
+	ssd1306_emu_addr_mode_t mode;
+	int col, page;		// Write pointer
+	int col_start, col_end;
+	int page_start, page_end;
+
+	// Display configuration
+	bool on;
+	bool inverse;		// A7
+	bool entire_on;		// A5
+	bool seg_remap;		// A1: column 0 drives SEG127
+	bool com_reverse;	// C8: scan from COM[N-1] to COM0
+	int start_line;		// 40-7F
+	int offset;			// D3
+	int mux;			// A8, rows - 1
+	int contrast;		// 81
+	bool charge_pump;	// 8D 14
+
+	// Continuous scroll (26/27/29/2A + 2F)
+	bool scrolling;
+	int scroll_cmd;
+	int scroll_start, scroll_end;
+	int scroll_interval;	// Frames per step
+	int scroll_vertical;	// Rows per step
+	int scroll_shift;		// Rows moved so far by a vertical scroll
+	int scroll_frames;		// Frames elapsed since the last step
+
+	// Transports
+	uint8_t address;	// 7-bit I2C address the controller answers to
+	int spi_dc;			// GPIO read as D/C for SPI transactions (-1: all commands)
+	uint32_t i2c_hz;
+	uint32_t spi_hz;
+	int64_t time_ns;	// Virtual clock
+	int64_t frame_ns;	// Time left over towards the next panel frame
+
+	// Command parser
+	uint8_t cmd[8];
+	int cmd_len;
+	int cmd_need;
+
+	uint32_t unknown_commands;
+	int nack_transactions;	// Fault injection: I2C transactions left to fail at the address byte
+	SSD1306_EmuStats_t stats;
+} SSD1306_Emu_t;
+
+extern SSD1306_Emu_t ssd1306_emu;
+
+void ssd1306_emu_reset(void);
+void ssd1306_emu_command(uint8_t byte);
+void ssd1306_emu_data(uint8_t byte);
+void ssd1306_emu_advance_frames(int frames);
+
+// Transports (called by the IDF shims). An I2C transaction is one
+// i2c_master_cmd_begin(); each START inside it is one write or read segment
+// whose first byte is the address byte.
+void ssd1306_emu_i2c_transaction(void);
+bool ssd1306_emu_i2c_write(const uint8_t * bytes, size_t len);
+uint8_t ssd1306_emu_i2c_read(void);
+void ssd1306_emu_spi_transaction(const uint8_t * bytes, size_t len, bool data);
+
+// Bus clocks used for the wire time model (defaults 400 kHz and 1 MHz)
+void ssd1306_emu_set_i2c_hz(uint32_t hz);
+void ssd1306_emu_set_spi_hz(uint32_t hz);
+void ssd1306_emu_set_spi_dc(int pin);
+
+// Virtual clock behind esp_timer_get_time() and the FreeRTOS tick
+int64_t ssd1306_emu_time_us(void);
+void ssd1306_emu_sleep_us(int64_t us);
+
+void ssd1306_emu_stats_reset(void);
+
+// Visible image, 1 byte per pixel (0/1), rows * SSD1306_EMU_COLUMNS
+int ssd1306_emu_rows(void);
+void ssd1306_emu_render(uint8_t * pixels);
+bool ssd1306_emu_write_pbm(const char * path);
+bool ssd1306_emu_read_pbm(const char * path, uint8_t * pixels, int * width, int * height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SSD1306_EMU_H_ */
@@ -0,0 +1,102 @@
+// Convergence checks for the gas sensor warm-up detector (src/gas_warmup.c).
+// Readings carry MOX-like noise of about 1 % between reads; a burn-in decay
+// must be called stable once it has flattened out, never while it is still
+// falling, and a sensor that keeps drifting only by the settle time limit.
+//
+//   warmup_test
+
+#include <stdio.h>
+#include <math.h>
+
+#include "gas_warmup.h"
+
+#define SEEDS 20
+#define R_INF_OHM 50000.0
+
+static uint32_t rng;
+
+// Roughly normal, sigma 1 (Irwin-Hall sum of 12 uniforms)
+static double noise(void)
+{
+	double sum = 0.0;
+	for (int i = 0; i < 12; i++) {
+		rng = rng * 1664525u + 1013904223u;
+		sum += (rng >> 8) / 16777216.0;
+	}
+	return sum - 6.0;
+}
+
+typedef double (*model_t)(double minutes);
+
+// Burn-in: 50 % above the final resistance, falling with a 4 min time constant
+static double decay(double minutes)
+{
+	return R_INF_OHM * (1.0 + 0.5 * exp(-minutes / 4.0));
+}
+
+static double flat(double minutes)
+{
+	(void)minutes;
+	return R_INF_OHM;
+}
+
+// Still falling 2 %/min: never converges
+static double drifting(double minutes)
+{
+	return R_INF_OHM * exp(-0.02 * minutes);
+}
+
+// Run pre-conditioning, then settle on the model with noise_rel reading noise.
+// Returns the settling minutes until stable, or -1 if not within 60 min.
+static double settle(WARMUP * w, model_t model, double noise_rel, uint32_t seed)
+{
+	rng = seed;
+	int64_t now_ms = 0;
+	WARMUP_Init(w, 320, 60000, now_ms);
+	while (w->phase == WARMUP_PRECONDITION) {
+		now_ms += WARMUP_GasPeriod(w);
+		WARMUP_Update(w, 20000, now_ms);
+	}
+	int64_t settle_ms = now_ms;
+	while (!w->stable && now_ms - settle_ms < 60 * 60000) {
+		now_ms += WARMUP_GasPeriod(w);
+		double minutes = (now_ms - settle_ms) / 60000.0;
+		WARMUP_Update(w, (uint32_t)(model(minutes) * (1.0 + noise_rel * noise())), now_ms);
+	}
+	return w->stable ? (now_ms - settle_ms) / 60000.0 : -1.0;
+}
+
+static bool check(const char * name, bool ok, double minutes)
+{
+	printf("%-38s %s (%.1f min)\n", name, ok ? "ok" : "FAILED", minutes);
+	return ok;
+}
+
+int main(void)
+{
+	static WARMUP w;
+	int failed = 0;
+
+	// The true drift falls under 0.005/min after ~12.9 min of settling
+	double earliest = 1e9, latest = 0.0;
+	bool converged = true;
+	for (uint32_t seed = 1; seed <= SEEDS; seed++) {
+		double minutes = settle(&w, decay, 0.01, seed);
+		converged = converged && minutes > 0.0 && !w.settle_timeout;
+		if (minutes < earliest) earliest = minutes;
+		if (minutes > latest) latest = minutes;
+	}
+	failed += !check("noisy decay converges", converged && latest <= 25.0, latest);
+	failed += !check("noisy decay not stable while falling", earliest >= 12.0, earliest);
+
+	double minutes = settle(&w, flat, 0.01, 7);
+	failed += !check("noisy flat sensor: one window + 12 fits",
+		w.stable && !w.settle_timeout && minutes <= (WARMUP_SLOPE_WINDOW_MS + 13 * WARMUP_SETTLE_PERIOD_MS) / 60000.0, minutes);
+
+	minutes = settle(&w, drifting, 0.01, 7);
+	failed += !check("drifting sensor: settle time limit", w.stable && w.settle_timeout
+		&& fabs(minutes - WARMUP_SETTLE_MAX_MS / 60000.0) < 0.1, minutes);
+
+	if (failed) printf("%d failed\n", failed);
+	return failed ? 1 : 0;
+}
@@ -1,3 +1,6 @@
+#ifndef MAIN_BME688_H_
+#define MAIN_BME688_H_
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,11 +11,13 @@ extern "C" {
 // Written by Dorian Yeh
 
 #define BME688_I2C_ADDR 0x76                            // SDO -> GND = 0x76, SDO -> VDDIO = 0x77
+#define BME688_I2C_TIMEOUT_MS 10                        // Per-transfer timeout (register access takes < 1 ms)
 
 // ------ BME688 Datasheet ------ || Pg. 36
 #define BME688_DEVICE_ID                    0x01
 #define BME688_VARIANT_ID                   0XF0        // value should be 0x01 (hex)
 #define BME688_CHIP_ID                      0XD0        //
+#define BME688_CHIP_ID_VALUE                0x61        // Expected contents of BME688_CHIP_ID
 
 #define BME688_CTRL_HUM                     0x72
 #define BME688_CTRL_MEAS                    0x74
@@ -101,12 +106,24 @@ extern "C" {
 #define BME688_GAS_R_LSB_1                  0x3E        // 7:6 contains data for gas res.
 #define BME688_GAS_R_LSB_2                  0x4F        // 3:0 contains ADC range of measured gas res.
 
+#define BME688_GAS_VALID_MSK                0x20        // gas_valid_r (bit 5 of GAS_R_LSB_x)
+#define BME688_HEAT_STAB_MSK                0x10        // heat_stab_r (bit 4 of GAS_R_LSB_x)
+
+// ------ Heater defaults ------
+#define BME688_HEATER_TEMP_DEFAULT          250         // Degrees C
+#define BME688_HEATER_WAIT_DEFAULT_MS       200         // gas_wait = 0b01110010 (4x, 50)
+#define BME688_HEATER_WAIT_MAX_MS           4032        // 63 * 64, largest encodable gas_wait
+
 // ------ Status Registers ------ || Pg. 43
 // Measuring Status
 #define BME688_MEAS_STATUS_0                0x1D
 #define BME688_MEAS_STATUS_1                0x2E
 #define BME688_MEAS_STATUS_2                0x3F
 
+#define BME688_NEW_DATA_MSK                 0x80        // new_data_0
+#define BME688_GAS_MEASURING_MSK            0x40        // gas_measuring
+#define BME688_MEASURING_MSK                0x20        // measuring
+
 // Sub Measurement Index
 #define BME688_SUB_MEAS_INDEX_0             0x1E 
 #define BME688_SUB_MEAS_INDEX_1             0x2F 
@@ -162,15 +179,35 @@ typedef struct {
     i2c_port_t i2c_port;
     uint8_t address;
 
+    // Bus timing budget
+    uint32_t timeout_ms;        // Per-transfer timeout, BME688_I2C_TIMEOUT_MS by default
+    int64_t deadline_us;        // esp_timer deadline for the current sample, 0 = none
+
+    // Fault counters
+    uint32_t err_timeout;       // Transfers that timed out
+    uint32_t err_nack;          // Transfers NACKed / failed
+    uint32_t err_budget;        // Transfers refused because the sample budget ran out
+
     float temp_c;               // Degrees C
-    float pressure;             // Pascals
+    float pressure_pa;          // Pascals
     float humidity;             // %Humidity
-    int32_t gas_res;            // ohms
+    uint32_t gas_res_ohm;       // ohms
 
 
     int32_t t_fine;             // Store this value from temperature for pressure/humidity compensation
 
-    // Add gas calculations later
+    // Measurement timing
+    uint32_t meas_dur_ms;       // TPH conversion time for the configured oversampling
+    uint8_t gas_wait;           // Last value written to gas_wait_0
+    bool run_gas;               // run_gas bit currently set in ctrl_gas_1
+
+    // Heater profile used by BME688_WriteGas
+    uint16_t heat_temp_c;       // Target heater temperature
+    uint16_t heat_wait_ms;      // Programmed heater duration
+
+    // Gas result status (from last BME688_ReadGas)
+    bool gas_valid;             // gas_valid_r
+    bool heat_stab;             // heat_stab_r: heater reached target temperature
 
 
     // ------ Calibration parameters ------
@@ -224,6 +261,16 @@ esp_err_t BME688_ReadHumidity(BME688 *dev);
 
 esp_err_t BME688_WriteGas(BME688 *dev);
 esp_err_t BME688_ReadGas(BME688 *dev);
+esp_err_t BME688_SetGasEnabled(BME688 *dev, bool enable);
+void BME688_SetHeaterProfile(BME688 *dev, uint16_t target_temp_c, uint16_t wait_ms);
+uint8_t BME688_EncodeGasWait(uint16_t wait_ms);
+uint32_t BME688_DecodeGasWait(uint8_t gas_wait);
+esp_err_t BME688_WaitForMeasurement(BME688 *dev, uint32_t timeout_ms);
+
+// ------ Bus Timing ------
+void BME688_SetDeadline(BME688 *dev, uint32_t budget_ms);
+void BME688_ClearDeadline(BME688 *dev);
+esp_err_t BME688_VerifyBus(BME688 *dev);
 
 // ------ Low Level Functions ------
 esp_err_t BME688_ReadRegister(
@@ -240,4 +287,6 @@ esp_err_t BME688_WriteRegister(
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
+
+#endif /* MAIN_BME688_H_ */
@@ -38,7 +38,14 @@
 	}
 */
 
-static uint8_t font8x8_basic_tr[128][8] = {
+// constexpr under C++ so the glyph variants in ssd1306_glyphs.cpp can be
+// derived from it at compile time
+#ifdef __cplusplus
+static constexpr uint8_t font8x8_basic_tr[128][8]
+#else
+static const uint8_t font8x8_basic_tr[128][8]
+#endif
+= {
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // U+0000 (nul)
     { 0x00, 0x04, 0x02, 0xFF, 0x02, 0x04, 0x00, 0x00 },   // U+0001 (Up Allow)
     { 0x00, 0x20, 0x40, 0xFF, 0x40, 0x20, 0x00, 0x00 },   // U+0002 (Down Allow)
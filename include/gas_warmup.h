@@ -0,0 +1,68 @@
+#ifndef MAIN_GAS_WARMUP_H_
+#define MAIN_GAS_WARMUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ------ MOX gas sensor warm-up / burn-in tracking ------
+// PRECONDITION: hot, fast heater cycles right after boot to burn off adsorbed species.
+// SETTLING:     normal heater temperature at a fast rate while a convergence
+//               detector watches the drift of ln(gas resistance): the
+//               least-squares slope over the last few minutes of samples, so
+//               reading noise averages out instead of being differenced.
+// STABLE:       drift stayed below threshold long enough, or settling hit
+//               its time limit (settle_timeout), normal gas period.
+
+#define WARMUP_PRECOND_TEMP_C               350         // Pre-conditioning heater target
+#define WARMUP_PRECOND_PERIOD_MS            2000
+#define WARMUP_PRECOND_DURATION_MS          (5 * 60 * 1000)
+#define WARMUP_SETTLE_PERIOD_MS             5000
+#define WARMUP_SLOPE_WINDOW_MS              (5 * 60 * 1000)     // Span of the drift fit
+#define WARMUP_SLOPE_SAMPLES                (WARMUP_SLOPE_WINDOW_MS / WARMUP_SETTLE_PERIOD_MS)
+#define WARMUP_DRIFT_THRESHOLD              0.005f      // |d ln(R)/dt| below 0.5 %/min
+#define WARMUP_STABLE_SAMPLES               12          // Consecutive fits under threshold
+#define WARMUP_SETTLE_MAX_MS                (30 * 60 * 1000)    // Stable by timeout after this long
+
+typedef enum {
+    WARMUP_PRECONDITION = 0,
+    WARMUP_SETTLING,
+    WARMUP_STABLE,
+} WARMUP_Phase;
+
+typedef struct {
+    WARMUP_Phase phase;
+    int64_t boot_ms;
+    int64_t phase_start_ms;
+
+    // Convergence detector: ring of the last ln(R) samples
+    float ln_r[WARMUP_SLOPE_SAMPLES];
+    int32_t t_ms[WARMUP_SLOPE_SAMPLES];     // Since phase_start_ms
+    uint16_t count;
+    uint16_t head;              // Next slot to write
+    bool have_drift;            // Window full, drift_per_min valid
+    float drift_per_min;        // Least-squares d ln(R)/dt over the window, 1/min
+    uint16_t below_count;
+
+    // Published state
+    bool stable;
+    bool settle_timeout;        // Stable because settling ran out of time, not by convergence
+    int64_t time_to_stable_ms;  // -1 until stable
+
+    uint16_t heater_temp_c;     // Measurement heater temperature once pre-conditioned
+    uint32_t gas_period_ms;     // Gas period once stable
+} WARMUP;
+
+void WARMUP_Init(WARMUP *w, uint16_t heater_temp_c, uint32_t gas_period_ms, int64_t now_ms);
+uint16_t WARMUP_HeaterTemp(const WARMUP *w);
+uint32_t WARMUP_GasPeriod(const WARMUP *w);
+bool WARMUP_Update(WARMUP *w, uint32_t gas_res_ohm, int64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_GAS_WARMUP_H_ */
@@ -0,0 +1,53 @@
+#ifndef MAIN_HEATER_TUNER_H_
+#define MAIN_HEATER_TUNER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bme688.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ------ Adaptive heater duration ------
+// Shrinks the programmed heater duration while heat_stab_r keeps reporting a
+// stable heater, backs off on the first unstable result and keeps the learned
+// minimum per target temperature.
+
+#define HEATER_TUNER_MAX_PROFILES           4           // Distinct target temperatures tracked
+#define HEATER_TUNER_MIN_MS                 5           // Never program less than this
+#define HEATER_TUNER_SHRINK_DIV             8           // Shrink by wait/8 per stable result
+#define HEATER_TUNER_MARGIN_DIV             8           // Back off by last_stable/8
+#define HEATER_TUNER_MIN_STEP_MS            2
+
+typedef enum {
+    HEATER_TUNE_SEARCH = 0,     // Shrinking towards the stability limit
+    HEATER_TUNE_LOCKED,         // Learned minimum in use
+} HEATER_TuneState;
+
+typedef struct {
+    uint16_t target_temp_c;
+    uint16_t wait_ms;           // Duration programmed for the next gas cycle
+    uint16_t last_stable_ms;    // Shortest duration that reached heat_stab
+    HEATER_TuneState state;
+    uint16_t unstable_count;    // Unstable results seen (search + locked)
+} HEATER_Profile;
+
+typedef struct {
+    HEATER_Profile profile[HEATER_TUNER_MAX_PROFILES];
+    uint8_t count;
+    uint16_t start_ms;          // Initial duration for a new target temperature
+    HEATER_Profile *active;     // Profile applied to the last gas cycle
+} HEATER_Tuner;
+
+void HEATER_TunerInit(HEATER_Tuner *tuner, uint16_t start_ms);
+void HEATER_TunerApply(HEATER_Tuner *tuner, BME688 *dev, uint16_t target_temp_c);
+void HEATER_TunerUpdate(HEATER_Tuner *tuner, const BME688 *dev);
+const HEATER_Profile *HEATER_TunerGetProfile(const HEATER_Tuner *tuner, uint16_t target_temp_c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_HEATER_TUNER_H_ */
@@ -0,0 +1,88 @@
+#ifndef MAIN_I2C_BUS_H_
+#define MAIN_I2C_BUS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ------ Shared I2C bus: setup, per-device clock, lock-up recovery and fault counters ------
+
+#define I2C_BUS_RECOVERY_CLOCKS             9           // Enough to finish any byte a slave is stuck in
+#define I2C_BUS_RECOVERY_HALF_PERIOD_US     5           // ~100 kHz bit-banged SCL
+
+#define I2C_BUS_MAX_DEVICES                 4           // Devices with their own SCL speed per bus
+#define I2C_BUS_PROBE_REPEATS               16          // Checks that must all pass at a speed
+
+#define I2C_BUS_BACKOFF_BASE_MS             100         // First re-init retry delay
+#define I2C_BUS_BACKOFF_MAX_MS              30000       // Retry delay cap
+
+typedef struct {
+    uint32_t recoveries;        // 9-clock + STOP sequences issued
+    uint32_t sda_stuck;         // SDA still held low after a recovery sequence
+    uint32_t driver_reinstalls; // i2c driver deleted and installed again
+    uint32_t reinstall_failures;
+    uint32_t device_reinits;    // Device re-initializations attempted after recovery
+    uint32_t reinit_failures;
+} I2C_BUS_Stats;
+
+typedef struct {
+    uint8_t address;
+    uint32_t clk_hz;
+} I2C_BUS_Device;
+
+typedef struct {
+    i2c_port_t port;
+    int sda_io;
+    int scl_io;
+    uint32_t clk_hz;            // Default speed for devices without an entry
+    uint32_t active_hz;         // Speed the controller is currently programmed for
+    bool installed;
+    SemaphoreHandle_t lock;
+
+    I2C_BUS_Device device[I2C_BUS_MAX_DEVICES];
+    uint8_t num_devices;
+
+    I2C_BUS_Stats stats;
+} I2C_BUS;
+
+// Returns ESP_OK when one verification round against the device succeeded
+typedef esp_err_t (*I2C_BUS_ProbeCheck)(void *ctx);
+
+// Capped exponential backoff for re-initializing a device after a fault
+typedef struct {
+    uint32_t delay_ms;          // 0 = no failure pending
+    int64_t next_attempt_ms;
+} I2C_BUS_Backoff;
+
+esp_err_t I2C_BUS_Init(I2C_BUS *bus, i2c_port_t port, int sda_io, int scl_io, uint32_t clk_hz);
+esp_err_t I2C_BUS_Recover(I2C_BUS *bus);
+void I2C_BUS_PrintStats(const I2C_BUS *bus);
+
+// Per-device SCL speed; drivers bracket each transfer with Begin/End. Begin
+// waits at most ticks for the bus and returns ESP_ERR_TIMEOUT without locking
+// it; End is only called after a successful Begin.
+esp_err_t I2C_BUS_SetDeviceSpeed(I2C_BUS *bus, uint8_t address, uint32_t clk_hz);
+uint32_t I2C_BUS_GetDeviceSpeed(const I2C_BUS *bus, uint8_t address);
+esp_err_t I2C_BUS_Begin(i2c_port_t port, uint8_t address, TickType_t ticks);
+void I2C_BUS_End(i2c_port_t port);
+uint32_t I2C_BUS_ProbeSpeed(I2C_BUS *bus, uint8_t address, I2C_BUS_ProbeCheck check, void *ctx);
+
+bool I2C_BUS_BackoffReady(const I2C_BUS_Backoff *backoff, int64_t now_ms);
+void I2C_BUS_BackoffFail(I2C_BUS_Backoff *backoff, int64_t now_ms);
+void I2C_BUS_BackoffReset(I2C_BUS_Backoff *backoff);
+
+// Convert a millisecond timeout into ticks, never rounding down to a shorter wait
+TickType_t I2C_BUS_TimeoutTicks(uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_I2C_BUS_H_ */
@@ -0,0 +1,60 @@
+#ifndef MAIN_SAMPLER_H_
+#define MAIN_SAMPLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bme688.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ------ Multi-rate acquisition scheduler ------
+// Each channel has its own period. A gas cycle also yields a TPH sample
+// (the forced measurement converts both), so it satisfies the TPH channel.
+
+#define SAMPLER_CH_TPH                      0x01        // Temperature, pressure, humidity
+#define SAMPLER_CH_GAS                      0x02        // Gas resistance
+
+#define SAMPLER_FLAG_GAS_STABLE             0x01        // Gas sensor finished warm-up
+#define SAMPLER_FLAG_GAS_SETTLE_TIMEOUT     0x02        // ... by the settle time limit, not by convergence
+
+#define SAMPLER_NUM_CHANNELS                2
+#define SAMPLER_MEAS_TIMEOUT_MS             1000        // Upper bound for one forced measurement
+
+typedef struct {
+    uint8_t mask;               // SAMPLER_CH_* bit
+    uint32_t period_ms;         // 0 = channel disabled
+    int64_t next_due_ms;
+} SAMPLER_Channel;
+
+typedef struct {
+    SAMPLER_Channel channel[SAMPLER_NUM_CHANNELS];
+} SAMPLER;
+
+// One output record, stamped with the channels it actually contains
+typedef struct {
+    int64_t timestamp_ms;
+    uint8_t channels;           // SAMPLER_CH_* bits
+    uint8_t flags;              // SAMPLER_FLAG_* bits
+
+    float temp_c;
+    float pressure_pa;
+    float humidity;
+    uint32_t gas_res_ohm;       // Valid only when channels & SAMPLER_CH_GAS
+} SAMPLER_Record;
+
+void SAMPLER_Init(SAMPLER *sched, uint32_t tph_period_ms, uint32_t gas_period_ms, int64_t now_ms);
+uint8_t SAMPLER_Due(const SAMPLER *sched, int64_t now_ms);
+void SAMPLER_Complete(SAMPLER *sched, uint8_t channels, int64_t now_ms);
+uint32_t SAMPLER_MsUntilNext(const SAMPLER *sched, int64_t now_ms);
+void SAMPLER_SetPeriod(SAMPLER *sched, uint8_t channel, uint32_t period_ms, int64_t now_ms);
+
+esp_err_t SAMPLER_Acquire(BME688 *dev, uint8_t channels, int64_t now_ms, SAMPLER_Record *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SAMPLER_H_ */
@@ -1,6 +1,9 @@
 #ifndef MAIN_SSD1306_H_
 #define MAIN_SSD1306_H_
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "driver/spi_master.h"
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0))
 #include "driver/i2c_master.h"
@@ -72,6 +75,10 @@ Usage:
 #define OLED_CMD_DEACTIVE_SCROLL        0x2E
 #define OLED_CMD_ACTIVE_SCROLL          0x2F
 #define OLED_CMD_VERTICAL               0xA3
+#define OLED_CMD_CONTENT_SCROLL_RIGHT   0x2C    // one column, follow with 00, start page, 01, end page, start col, end col
+#define OLED_CMD_CONTENT_SCROLL_LEFT    0x2D
+
+#define SSD1306_GDDRAM_PAGES 8 // Controller RAM is 128x64 whatever the panel height
 
 #define I2C_ADDRESS 0x3C
 #define SPI_ADDRESS 0xFF
@@ -92,12 +99,58 @@ typedef enum {
 	SCROLL_STOP = 7
 } ssd1306_scroll_type_t;
 
+// How ssd1306_blit combines source pixels with the frame buffer
+typedef enum {
+	BLIT_COPY = 0,		// dst = src
+	BLIT_OR = 1,		// dst |= src
+	BLIT_XOR = 2,		// dst ^= src
+	BLIT_AND_NOT = 3	// dst &= ~src (erase where src is set)
+} ssd1306_blit_mode_t;
+
+// Flush merges two changed runs of a page when fewer than this many unchanged
+// bytes separate them (cheaper than a new address window).
+#define SSD1306_FLUSH_MERGE_GAP 6
+// Above this many changed bytes, ssd1306_flush sends the full frame in one transaction
+#define SSD1306_FRAME_FLUSH_THRESHOLD 512
+// Content scroll commands need 2 frame periods between them (~107 Hz frames
+// at the D5 0x80 clock set by i2c_init/spi_init)
+#define SSD1306_CONTENT_SCROLL_GAP_US 20000
+
 typedef struct {
-	bool _valid; // Not using it anymore
+	bool _valid; // Dirty: _segs may differ from _shadow in [_dirtyStart, _dirtyEnd]
 	int _segLen; // Not using it anymore
+	int _dirtyStart;
+	int _dirtyEnd;
 	uint8_t _segs[128];
+	uint8_t _shadow[128]; // What the panel GDDRAM currently holds
 } PAGE_t;
 
+#define SSD1306_FLUSH_TASK_STACK 4096
+
+// Front buffer and flush task state (see ssd1306_start_flush_task)
+typedef struct {
+	SemaphoreHandle_t _lock; // Guards _front/_start/_end
+	SemaphoreHandle_t _ioLock; // Serializes panel I/O between the flush task and callers
+	TaskHandle_t _task;
+	int _start[8]; // Presented but not yet drained column range per page, -1 if none
+	int _end[8];
+	uint8_t _front[8][128]; // Last presented frame
+	uint8_t _tx[8][128]; // Frame being transmitted by the flush task
+	int _contrastBefore; // Contrast queued ahead of the presented pages, -1 if none
+	int _contrastAfter; // Contrast queued behind the presented pages, -1 if none
+	uint8_t _shift[8]; // Content scrolls queued per page, sent ahead of the presented pages
+} SSD1306_Async_t;
+
+#define SSD1306_SPI_QUEUE 8 // SPI transactions that can be in flight at once
+
+// Pre-built SPI transactions, reused round-robin. DC is set from each
+// transaction's user field by the pre-transmit callback.
+typedef struct {
+	spi_transaction_t _trans[SSD1306_SPI_QUEUE];
+	int _next; // Slot for the next queued segment
+	int _pending; // Queued segments whose result has not been collected
+} SSD1306_Spi_t;
+
 typedef struct {
 	int _address;
 	int _width;
@@ -110,8 +163,15 @@ typedef struct {
 	int _scDirection;
 	PAGE_t _page[8];
 	bool _flip;
-	i2c_port_t _i2c_num;
+	i2c_port_t _i2c_num; // I2C controller the panel is attached to
 	spi_device_handle_t _spi_device_handle;
+	SSD1306_Spi_t * _spi; // Transaction pool (SPI panels)
+	SSD1306_Async_t * _async; // NULL: drawing calls transmit synchronously
+	int _batch; // Nesting depth of ssd1306_batch_begin
+	int _contrast; // Last contrast sent
+	bool _double; // GDDRAM double buffering (see ssd1306_double_buffer)
+	int _ramBase; // GDDRAM page that frame buffer page 0 is written to
+	int64_t _scrollUs; // When the last content scroll command went out, 0 if none
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0))
 	i2c_master_bus_handle_t _i2c_bus_handle;
 	i2c_master_dev_handle_t _i2c_dev_handle;
@@ -128,6 +188,18 @@ int ssd1306_get_width(SSD1306_t * dev);
 int ssd1306_get_height(SSD1306_t * dev);
 int ssd1306_get_pages(SSD1306_t * dev);
 void ssd1306_show_buffer(SSD1306_t * dev);
+void ssd1306_mark_dirty(SSD1306_t * dev, int page, int seg, int width);
+void ssd1306_invalidate(SSD1306_t * dev);
+void ssd1306_flush(SSD1306_t * dev);
+void ssd1306_display_frame(SSD1306_t * dev);
+void ssd1306_display_pages(SSD1306_t * dev, const uint8_t * const pages[]);
+float ssd1306_measure_fps(SSD1306_t * dev, int frames);
+esp_err_t ssd1306_start_flush_task(SSD1306_t * dev, UBaseType_t priority);
+void _ssd1306_flush_drain(SSD1306_t * dev);
+void ssd1306_present(SSD1306_t * dev);
+void ssd1306_batch_begin(SSD1306_t * dev);
+void ssd1306_batch_end(SSD1306_t * dev);
+esp_err_t ssd1306_double_buffer(SSD1306_t * dev, bool enable);
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer);
 void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer);
 void ssd1306_set_page(SSD1306_t * dev, int page, const uint8_t * buffer);
@@ -144,10 +216,19 @@ void ssd1306_software_scroll(SSD1306_t * dev, int start, int end);
 void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool invert);
 void ssd1306_scroll_clear(SSD1306_t * dev);
 void ssd1306_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
+void ssd1306_content_scroll_left(SSD1306_t * dev, int start, int end);
+void ssd1306_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width);
+void ssd1306_start_line(SSD1306_t * dev, int line);
 void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int start, int end, int8_t delay);
 void _ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert);
 void ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert);
+void ssd1306_blit(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert, ssd1306_blit_mode_t mode);
+void ssd1306_bench_bitmaps(SSD1306_t * dev, int iterations);
 void _ssd1306_pixel(SSD1306_t * dev, int xpos, int ypos, bool invert);
+void _ssd1306_hline(SSD1306_t * dev, int x1, int x2, int y, bool invert);
+void _ssd1306_vline(SSD1306_t * dev, int x, int y1, int y2, bool invert);
+void _ssd1306_fill_rect(SSD1306_t * dev, int xpos, int ypos, int width, int height, bool invert);
+void _ssd1306_rect(SSD1306_t * dev, int xpos, int ypos, int width, int height, bool invert);
 void _ssd1306_line(SSD1306_t * dev, int x1, int y1, int x2, int y2,  bool invert);
 void _ssd1306_circle(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, bool invert);
 void _ssd1306_disc(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, bool invert);
@@ -165,9 +246,14 @@ void ssd1306_dump_page(SSD1306_t * dev, int page, int seg);
 void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset);
 void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address);
 void i2c_init(SSD1306_t * dev, int width, int height);
-void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool i2c_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width);
+bool i2c_display_frame(SSD1306_t * dev, const uint8_t * const pages[]);
 void i2c_contrast(SSD1306_t * dev, int contrast);
 void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
+void i2c_content_scroll(SSD1306_t * dev, int start, int end, bool left);
+void i2c_start_line(SSD1306_t * dev, int line);
+esp_err_t i2c_verify(SSD1306_t * dev);
 
 void spi_clock_speed(int speed);
 void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, int16_t dc, int16_t reset);
@@ -177,9 +263,13 @@ bool spi_master_write_commands(SSD1306_t * dev, const uint8_t * Commands, size_t
 bool spi_master_write_command(SSD1306_t * dev, uint8_t Command );
 bool spi_master_write_data(SSD1306_t * dev, const uint8_t* Data, size_t DataLength );
 void spi_init(SSD1306_t * dev, int width, int height);
-void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
+bool spi_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width);
+bool spi_display_frame(SSD1306_t * dev, const uint8_t * const pages[]);
 void spi_contrast(SSD1306_t * dev, int contrast);
 void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
+void spi_content_scroll(SSD1306_t * dev, int start, int end, bool left);
+void spi_start_line(SSD1306_t * dev, int line);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,124 @@
+#ifndef MAIN_SSD1306_ASSETS_H_
+#define MAIN_SSD1306_ASSETS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Fonts and icons kept in their own flash partition ("assets" in
+// partitions.csv) instead of the app image, so they can be flashed and
+// updated without touching the firmware. The partition is memory-mapped and
+// every asset is read in place: fonts and atlases are views into flash and
+// glyph columns go straight from there into the frame buffer. On the host
+// build the partition is a file, mapped with mmap.
+//
+// tools/asset_pack.py builds a pack from assets/pack.json.
+//
+// Pack layout, little-endian, every asset 4-byte aligned:
+//   SSD1306_AssetsHeader_t
+//   SSD1306_AssetEntry_t[count]
+//   assets
+//
+// Font asset: SSD1306_FontHeader_t, SSD1306_FontGlyph_t[count], then the
+// column bytes of every glyph (width * pages, page by page, _segs layout),
+// then the same columns bit-reversed for flipped panels if flags says so.
+//
+// Atlas asset: SSD1306_AtlasHeader_t, then count icons of width * pages
+// column bytes each, then the flipped copies if flags says so.
+
+#define SSD1306_ASSETS_PARTITION "assets"
+#define SSD1306_ASSETS_MAGIC 0x50414C4F // "OLAP"
+#define SSD1306_ASSETS_VERSION 1
+#define SSD1306_ASSET_NAME_LEN 12
+#define SSD1306_ASSET_FLIPPED 0x01 // Flags: a bit-reversed copy follows for dev->_flip
+
+typedef enum {
+	ASSET_FONT = 1,
+	ASSET_ATLAS = 2
+} ssd1306_asset_type_t;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;		// Directory entries
+	uint32_t size;		// Pack bytes, this header included
+	uint32_t crc;		// CRC-32 of the bytes after this header
+} SSD1306_AssetsHeader_t;
+
+typedef struct {
+	char name[SSD1306_ASSET_NAME_LEN];	// NUL padded, not terminated at full length
+	uint8_t type;		// ssd1306_asset_type_t
+	uint8_t reserved[3];
+	uint32_t offset;	// From the start of the pack
+	uint32_t size;
+} SSD1306_AssetEntry_t;
+
+typedef struct {
+	uint8_t pages;		// Glyph height in pages
+	uint8_t first;		// First character
+	uint8_t count;		// Characters from first
+	uint8_t flags;
+	uint8_t spacing;	// Blank columns after each glyph
+	uint8_t missing;	// Drawn for characters outside the font or of width 0
+	uint8_t reserved[2];
+	uint32_t columns;	// Column bytes per variant
+} SSD1306_FontHeader_t;
+
+typedef struct {
+	uint16_t offset;	// Into the column bytes
+	uint8_t width;		// Columns; 0: not in the font
+	uint8_t reserved;
+} SSD1306_FontGlyph_t;
+
+typedef struct {
+	uint8_t width;		// Icon columns
+	uint8_t pages;		// Icon height in pages
+	uint8_t flags;
+	uint8_t reserved;
+	uint16_t count;
+	uint16_t reserved2;
+} SSD1306_AtlasHeader_t;
+
+// A mapped pack
+typedef struct {
+	const uint8_t * base;
+	const SSD1306_AssetsHeader_t * header;
+	const SSD1306_AssetEntry_t * dir;
+	esp_partition_mmap_handle_t handle;
+	bool mapped;
+} SSD1306_Assets_t;
+
+// Views into a mapped pack; valid until ssd1306_assets_close
+typedef struct {
+	const SSD1306_FontHeader_t * header;
+	const SSD1306_FontGlyph_t * glyphs;
+	const uint8_t * columns[2];	// [0] as drawn, [1] flipped (NULL: reversed while drawing)
+} SSD1306_Font_t;
+
+typedef struct {
+	const SSD1306_AtlasHeader_t * header;
+	const uint8_t * icons[2];	// [0] as drawn, [1] flipped (NULL: reversed while drawing)
+} SSD1306_Atlas_t;
+
+esp_err_t ssd1306_assets_open(SSD1306_Assets_t * pack, const char * label);
+void ssd1306_assets_close(SSD1306_Assets_t * pack);
+esp_err_t ssd1306_assets_font(SSD1306_Assets_t * pack, const char * name, SSD1306_Font_t * font);
+esp_err_t ssd1306_assets_atlas(SSD1306_Assets_t * pack, const char * name, SSD1306_Atlas_t * atlas);
+int ssd1306_font_width(const SSD1306_Font_t * font, const char * text, int text_len);
+int ssd1306_font_text(SSD1306_t * dev, const SSD1306_Font_t * font, int page, int seg, const char * text, int text_len, bool invert);
+void ssd1306_atlas_icon(SSD1306_t * dev, const SSD1306_Atlas_t * atlas, int page, int seg, int index, bool invert);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_ASSETS_H_ */
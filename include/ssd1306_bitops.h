@@ -0,0 +1,64 @@
+#ifndef MAIN_SSD1306_BITOPS_H_
+#define MAIN_SSD1306_BITOPS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Bit kernels shared by the renderers. All are branch-free swaps on whole
+// bytes or words (SWAR), so flipping or rotating costs a few ALU operations
+// per 8 pixels instead of a loop per bit.
+
+// 0x12 --> 0x48 (bit i <-> bit 7-i)
+static inline uint8_t ssd1306_reverse8(uint8_t b)
+{
+	b = (uint8_t)((b >> 4) | (b << 4));
+	b = (uint8_t)(((b & 0xCC) >> 2) | ((b & 0x33) << 2));
+	b = (uint8_t)(((b & 0xAA) >> 1) | ((b & 0x55) << 1));
+	return b;
+}
+
+// ssd1306_reverse8 on each of the four bytes of a word (byte order kept)
+static inline uint32_t ssd1306_reverse8x4(uint32_t w)
+{
+	w = ((w & 0xF0F0F0F0) >> 4) | ((w & 0x0F0F0F0F) << 4);
+	w = ((w & 0xCCCCCCCC) >> 2) | ((w & 0x33333333) << 2);
+	w = ((w & 0xAAAAAAAA) >> 1) | ((w & 0x55555555) << 1);
+	return w;
+}
+
+// Whole word: bit i <-> bit 31-i
+static inline uint32_t ssd1306_reverse32(uint32_t w)
+{
+	w = ssd1306_reverse8x4(w);
+	return (w >> 24) | ((w >> 8) & 0x0000FF00) | ((w << 8) & 0x00FF0000) | (w << 24);
+}
+
+// 8x8 bit matrix transpose: out[i] bit j = in[j] bit i.
+// in and out may be the same array.
+static inline void ssd1306_transpose8(const uint8_t in[8], uint8_t out[8])
+{
+	// Row j is byte j, so element (j, i) is bit 8j+i and moves to bit 8i+j
+	uint64_t x = 0;
+	for (int j = 7; j >= 0; j--) x = (x << 8) | in[j];
+
+	// Delta swaps: single bits, then 2x2 blocks, then 4x4 quadrants
+	uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x ^= t ^ (t << 28);
+
+	for (int i = 0; i < 8; i++, x >>= 8) out[i] = (uint8_t)x;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_BITOPS_H_ */
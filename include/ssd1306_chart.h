@@ -0,0 +1,43 @@
+#ifndef MAIN_SSD1306_CHART_H_
+#define MAIN_SSD1306_CHART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Rolling sparkline over whole pages, newest sample in the rightmost column.
+// While the y-axis range holds, a sample costs one content-scroll command
+// plus one column of data; a range change redraws the chart once.
+
+#define SSD1306_CHART_HEADROOM 0.25f // Auto range pads the data span by this fraction on each side
+
+typedef struct {
+	SSD1306_t * dev;
+	int page;		// First page of the chart
+	int pages;		// Height in pages
+	float history[128];	// Ring of the last samples, one per column
+	int count;
+	int head;		// Index of the oldest sample once the ring is full
+	bool autorange;
+	bool ranged;		// lo/hi valid
+	float lo;
+	float hi;
+	uint32_t redraws;	// Full redraws caused by range changes
+} SSD1306_Chart_t;
+
+void ssd1306_chart_init(SSD1306_Chart_t * chart, SSD1306_t * dev, int page, int pages);
+void ssd1306_chart_set_range(SSD1306_Chart_t * chart, float lo, float hi);
+void ssd1306_chart_push(SSD1306_Chart_t * chart, float value);
+void ssd1306_chart_redraw(SSD1306_Chart_t * chart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_CHART_H_ */
@@ -0,0 +1,40 @@
+#ifndef MAIN_SSD1306_CONSOLE_H_
+#define MAIN_SSD1306_CONSOLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Full-screen log console, newest line at the bottom. GDDRAM is used as a
+// ring of 8 text lines: a new line is written into the page that is about to
+// scroll into view, then the display start line moves by 8 rows. Each line
+// costs one page of data plus one start-line command, whatever the panel
+// height. While the console is open it owns the panel; ssd1306_console_end
+// hands it back to the frame buffer with the visible lines drawn there.
+
+#define SSD1306_CONSOLE_COLUMNS 16
+
+typedef struct {
+	SSD1306_t * dev;
+	int start;		// Display start line last sent (0-63)
+	char text[SSD1306_GDDRAM_PAGES][SSD1306_CONSOLE_COLUMNS + 1];	// Line held by each GDDRAM page
+	bool invert[SSD1306_GDDRAM_PAGES];
+	uint32_t lines;		// Lines printed
+} SSD1306_Console_t;
+
+void ssd1306_console_init(SSD1306_Console_t * con, SSD1306_t * dev);
+void ssd1306_console_print(SSD1306_Console_t * con, const char * text, int text_len, bool invert);
+void ssd1306_console_printf(SSD1306_Console_t * con, const char * format, ...) __attribute__((format(printf, 2, 3)));
+void ssd1306_console_end(SSD1306_Console_t * con);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_CONSOLE_H_ */
@@ -0,0 +1,58 @@
+#ifndef MAIN_SSD1306_EFFECTS_H_
+#define MAIN_SSD1306_EFFECTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Time-based screen effects. Each frame is computed on the framebuffer from
+// the elapsed fraction of the requested duration and pushed with one batched
+// flush, so an effect ends on time whatever the bus speed (slow buses drop
+// frames instead of stretching the effect).
+
+#define SSD1306_EFFECT_FRAME_MS 20	// Frame interval of ssd1306_effect_run
+#define SSD1306_FADEOUT_MS 500		// Duration used by ssd1306_fadeout
+
+typedef enum {
+	EFFECT_NONE = 0,
+	EFFECT_FADE_OUT,	// Contrast ramp to 0, then the target (blank) is shown at the original contrast
+	EFFECT_FADE_IN,		// Target shown at contrast 0, ramped up to the original contrast
+	EFFECT_WIPE_LEFT,	// Target revealed from the right edge towards the left
+	EFFECT_WIPE_RIGHT,
+	EFFECT_WIPE_UP,
+	EFFECT_WIPE_DOWN,
+	EFFECT_WRAP_LEFT,	// Current screen rotated one full turn with wrap-around
+	EFFECT_WRAP_RIGHT,
+	EFFECT_WRAP_UP,
+	EFFECT_WRAP_DOWN,
+	EFFECT_INVERT		// Two inverted flashes, ends on the normal screen
+} ssd1306_effect_type_t;
+
+typedef struct {
+	SSD1306_t * dev;
+	ssd1306_effect_type_t type;
+	bool running;
+	int64_t start_us;
+	uint32_t duration_ms;
+	int contrast;		// Contrast to return to
+	int last_contrast;	// Last value sent during a ramp
+	uint32_t frames;	// Frames presented
+	uint8_t from[8][128];	// Screen when the effect started
+	uint8_t to[8][128];	// Screen when it ends
+} SSD1306_Effect_t;
+
+void ssd1306_effect_start(SSD1306_Effect_t * fx, SSD1306_t * dev, ssd1306_effect_type_t type, const uint8_t * target, uint32_t duration_ms);
+bool ssd1306_effect_step(SSD1306_Effect_t * fx);
+void ssd1306_effect_run(SSD1306_t * dev, ssd1306_effect_type_t type, const uint8_t * target, uint32_t duration_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_EFFECTS_H_ */
@@ -0,0 +1,47 @@
+#ifndef MAIN_SSD1306_GLYPHS_H_
+#define MAIN_SSD1306_GLYPHS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Glyph variants of font8x8_basic_tr, generated at compile time (ssd1306_glyphs.cpp)
+// and kept in flash. Each glyph is 8 column bytes, ready for _segs.
+typedef struct {
+	uint8_t g[128][8];
+} SSD1306_GlyphTable_t;
+
+extern const SSD1306_GlyphTable_t ssd1306_glyphs;             // As stored in the font
+extern const SSD1306_GlyphTable_t ssd1306_glyphs_flip;        // Vertically flipped (dev->_flip)
+extern const SSD1306_GlyphTable_t ssd1306_glyphs_rotate;      // Rotated 90 degrees
+extern const SSD1306_GlyphTable_t ssd1306_glyphs_rotate_flip; // Rotated 90 degrees, flipped
+
+static inline const uint8_t * ssd1306_glyph(uint8_t ch, bool flip)
+{
+	return flip ? ssd1306_glyphs_flip.g[ch & 0x7F] : ssd1306_glyphs.g[ch & 0x7F];
+}
+
+static inline const uint8_t * ssd1306_glyph_rotated(uint8_t ch, bool flip)
+{
+	return flip ? ssd1306_glyphs_rotate_flip.g[ch & 0x7F] : ssd1306_glyphs_rotate.g[ch & 0x7F];
+}
+
+// Copy one glyph to dst, inverting on the way (one 64-bit XOR)
+static inline void ssd1306_blit_glyph(uint8_t * dst, const uint8_t * glyph, bool invert)
+{
+	uint64_t wk;
+	memcpy(&wk, glyph, 8);
+	if (invert) wk = ~wk;
+	memcpy(dst, &wk, 8);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_GLYPHS_H_ */
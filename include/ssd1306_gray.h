@@ -0,0 +1,60 @@
+#ifndef MAIN_SSD1306_GRAY_H_
+#define MAIN_SSD1306_GRAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Four gray levels by temporal dithering. The canvas holds two bitplanes
+// (2 bits per pixel); the panel is sent a sequence of 1-bit subframes in
+// which the high plane appears twice and the low plane once, so a pixel of
+// level L is lit in L of every 3 subframes. Each subframe is one full-frame
+// transaction taken straight from a plane, bypassing the frame buffer.
+//
+// The illusion needs roughly 50 gray cycles per second or more, i.e. 150
+// subframes per second: SPI manages it, fast I2C does not. ssd1306_gray_run
+// reports the rate and jitter actually achieved on the panel's bus.
+
+#define SSD1306_GRAY_LEVELS 4
+#define SSD1306_GRAY_SUBFRAMES 3 // Subframes per gray cycle: high, low, high
+#define SSD1306_GRAY_LATE_PCT 25 // Subframe counts as late when this much of a period behind its slot
+
+typedef struct {
+	SSD1306_t * dev;
+	uint8_t planes[2][8][128];	// [0]: weight 1, [1]: weight 2, in _segs layout
+	int phase;			// Next subframe in the cycle
+} SSD1306_Gray_t;
+
+typedef struct {
+	int subframes;		// Sent during the run
+	int late;		// Started more than SSD1306_GRAY_LATE_PCT of a period after their slot
+	int dropped;		// Slots skipped to catch up after falling a whole period behind
+	float subframe_hz;	// Achieved subframe rate
+	float gray_hz;		// Achieved gray cycles per second
+	float jitter_us;	// Standard deviation of the subframe interval
+	int64_t interval_min_us;
+	int64_t interval_max_us;
+	int64_t send_max_us;	// Longest single subframe transfer
+	bool sustained;		// Every subframe on time and every transfer shorter than a period
+} SSD1306_GrayStats_t;
+
+void ssd1306_gray_init(SSD1306_Gray_t * gray, SSD1306_t * dev);
+void ssd1306_gray_clear(SSD1306_Gray_t * gray, int level);
+void ssd1306_gray_pixel(SSD1306_Gray_t * gray, int xpos, int ypos, int level);
+void ssd1306_gray_fill_rect(SSD1306_Gray_t * gray, int xpos, int ypos, int width, int height, int level);
+void ssd1306_gray_text(SSD1306_Gray_t * gray, int page, int seg, const char * text, int text_len, int level);
+void ssd1306_gray_step(SSD1306_Gray_t * gray);
+void ssd1306_gray_run(SSD1306_Gray_t * gray, int subframe_hz, int duration_ms, SSD1306_GrayStats_t * stats);
+void ssd1306_gray_end(SSD1306_Gray_t * gray);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_GRAY_H_ */
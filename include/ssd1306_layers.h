@@ -0,0 +1,71 @@
+#ifndef MAIN_SSD1306_LAYERS_H_
+#define MAIN_SSD1306_LAYERS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Off-screen layers composited into the frame buffer. Each layer holds ink
+// (lit pixels) and a cover mask (pixels it owns, lit or dark) in the _segs
+// layout; covered pixels hide whatever the layers below have there. Layers
+// are stacked bottom to top and combined 32 bits at a time:
+//
+//   out = (out & ~cover) | ink
+//
+// Every layer keeps a dirty mask with one bit per 4-column word of each page.
+// _ssd1306_layers_compose rebuilds only the dirty words and marks the frame
+// buffer dirty where the result changed, so hiding an overlay recomposites
+// the area it covered and nothing else.
+
+#define SSD1306_LAYERS 3
+#define SSD1306_LAYER_WORDS (128 / 4) // 32-bit words per page: one dirty bit each
+
+typedef enum {
+	LAYER_BACKGROUND = 0,	// Frames, labels: drawn once
+	LAYER_DATA = 1,		// Readings, charts
+	LAYER_OVERLAY = 2	// Alarm banners, cursors: shown and hidden
+} ssd1306_layer_t;
+
+typedef union {
+	uint8_t segs[8][128];
+	uint32_t words[8][SSD1306_LAYER_WORDS];
+} SSD1306_LayerPlane_t;
+
+typedef struct {
+	SSD1306_LayerPlane_t ink;	// Lit pixels, always inside cover
+	SSD1306_LayerPlane_t cover;	// Opaque pixels
+	uint32_t dirty[8];	// Bit w of a page: word w changed since the last compose
+	uint32_t used[8];	// Bit w of a page: word w drawn since the layer was cleared
+	bool visible;
+} SSD1306_Layer_t;
+
+typedef struct {
+	SSD1306_t * dev;
+	SSD1306_Layer_t layer[SSD1306_LAYERS];
+	uint8_t order[SSD1306_LAYERS];	// Layer ids, bottom first
+	int composed;		// Words rebuilt by the last compose
+} SSD1306_Layers_t;
+
+void ssd1306_layers_init(SSD1306_Layers_t * layers, SSD1306_t * dev);
+void ssd1306_layer_set_visible(SSD1306_Layers_t * layers, ssd1306_layer_t id, bool visible);
+void ssd1306_layer_set_z(SSD1306_Layers_t * layers, ssd1306_layer_t id, int z);
+void ssd1306_layer_clear(SSD1306_Layers_t * layers, ssd1306_layer_t id);
+void ssd1306_layer_erase(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, int width, int height);
+void ssd1306_layer_text(SSD1306_Layers_t * layers, ssd1306_layer_t id, int page, int seg, const char * text, int text_len, bool invert);
+void ssd1306_layer_image(SSD1306_Layers_t * layers, ssd1306_layer_t id, int page, int seg, const uint8_t * images, int width);
+void _ssd1306_layer_pixel(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, bool invert);
+void _ssd1306_layer_fill_rect(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, int width, int height, bool invert);
+int _ssd1306_layers_compose(SSD1306_Layers_t * layers);
+void ssd1306_layers_show(SSD1306_Layers_t * layers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_LAYERS_H_ */
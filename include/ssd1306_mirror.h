@@ -0,0 +1,65 @@
+#ifndef MAIN_SSD1306_MIRROR_H_
+#define MAIN_SSD1306_MIRROR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Remote view of the frame buffer over the serial console. Each update XORs
+// the buffer with the last frame sent and run-length encodes the result, so
+// an unchanged screen sends nothing and one changed glyph costs ~30 bytes.
+// Packets are single text lines, so they interleave with ordinary logging:
+//
+//   OLED:<base64 packet>\n
+//
+// Packet (before base64), multi-byte fields little-endian:
+//   type      'K' keyframe (payload is the frame) or 'D' delta (payload is
+//             the XOR with the previous packet's frame)
+//   seq       uint16, +1 per packet; a viewer that misses one waits for a keyframe
+//   pages     uint8, 4 or 8; 128 columns per page
+//   flags     uint8, bit 0: rows stored bit-reversed (dev->_flip)
+//   payload   RLE tokens over pages * 128 bytes in _segs order, trailing zeros omitted:
+//               0x00-0x7F    t+1 literal bytes follow
+//               0x80-0xBF    run of (t & 0x3F) + 1 zero bytes
+//               0xC0-0xFF n  run of ((t & 0x3F) | n << 6) + 1 zero bytes
+//   crc       uint16 CRC-16/CCITT-FALSE over everything before it
+//
+// tools/oled_mirror.py decodes the stream and shows the screen.
+
+#define SSD1306_MIRROR_PREFIX "OLED:"
+#define SSD1306_MIRROR_KEYFRAME_INTERVAL 50 // Packets between keyframes
+#define SSD1306_MIRROR_MAX_PACKET (5 + 1024 + 16 + 2) // Header, worst-case RLE of a frame, CRC
+#define SSD1306_MIRROR_MAX_LINE (sizeof(SSD1306_MIRROR_PREFIX) + (SSD1306_MIRROR_MAX_PACKET + 2) / 3 * 4 + 2)
+
+// Receives each complete line, newline included
+typedef void (*ssd1306_mirror_write_t)(const char * line, size_t len, void * ctx);
+
+typedef struct {
+	SSD1306_t * dev;
+	ssd1306_mirror_write_t write;
+	void * ctx;
+	uint8_t last[8][128];	// Frame as of the last packet
+	uint16_t seq;		// Sequence number of the next packet
+	int keyframe_interval;
+	int since_key;		// Packets since the last keyframe; < 0 forces one
+	uint32_t packets;
+	uint32_t bytes;		// Line bytes written
+} SSD1306_Mirror_t;
+
+void ssd1306_mirror_init(SSD1306_Mirror_t * mirror, SSD1306_t * dev, ssd1306_mirror_write_t write, void * ctx);
+void ssd1306_mirror_keyframe(SSD1306_Mirror_t * mirror);
+bool ssd1306_mirror_update(SSD1306_Mirror_t * mirror);
+void ssd1306_mirror_stdout(const char * line, size_t len, void * ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_MIRROR_H_ */
@@ -0,0 +1,48 @@
+#ifndef MAIN_SSD1306_PORTRAIT_H_
+#define MAIN_SSD1306_PORTRAIT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Portrait canvas: the panel turned on its side, 64 (or 32) pixels wide and
+// 128 tall. Drawing goes to a logical buffer in the usual page/column layout,
+// so the normal glyph table and images work unchanged. ssd1306_portrait_show
+// rotates only the 8x8 tiles that changed into the frame buffer, one bit
+// matrix transpose per tile, and flushes.
+
+#define SSD1306_PORTRAIT_HEIGHT 128
+#define SSD1306_PORTRAIT_PAGES (SSD1306_PORTRAIT_HEIGHT / 8)
+
+typedef enum {
+	PORTRAIT_CW = 0,	// Panel turned 90 degrees clockwise: logical top is the panel's left edge
+	PORTRAIT_CCW = 1	// Panel turned 90 degrees counter-clockwise: logical top is its right edge
+} ssd1306_portrait_t;
+
+typedef struct {
+	SSD1306_t * dev;
+	ssd1306_portrait_t rotation;
+	int width;		// Logical width: the panel height
+	uint8_t segs[SSD1306_PORTRAIT_PAGES][64];	// Logical pages, bit k of column x = row 8*page+k
+	uint8_t dirty[SSD1306_PORTRAIT_PAGES];	// Bit b: tile at columns 8b..8b+7 changed since show
+} SSD1306_Portrait_t;
+
+void ssd1306_portrait_init(SSD1306_Portrait_t * canvas, SSD1306_t * dev, ssd1306_portrait_t rotation);
+void ssd1306_portrait_set_rotation(SSD1306_Portrait_t * canvas, ssd1306_portrait_t rotation);
+void ssd1306_portrait_clear(SSD1306_Portrait_t * canvas, bool invert);
+void ssd1306_portrait_text(SSD1306_Portrait_t * canvas, int page, const char * text, int text_len, bool invert);
+void ssd1306_portrait_image(SSD1306_Portrait_t * canvas, int page, int seg, const uint8_t * images, int width);
+void _ssd1306_portrait_pixel(SSD1306_Portrait_t * canvas, int xpos, int ypos, bool invert);
+void ssd1306_portrait_show(SSD1306_Portrait_t * canvas);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_PORTRAIT_H_ */
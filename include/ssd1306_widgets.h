@@ -0,0 +1,76 @@
+#ifndef MAIN_SSD1306_WIDGETS_H_
+#define MAIN_SSD1306_WIDGETS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Retained-mode widgets. Each widget is bound to a value source and remembers
+// what it last drew; an update re-renders only the text cells, bar columns or
+// icon that actually changed, so an unchanged screen costs nothing and a
+// changed digit costs one 8-byte glyph.
+
+#define SSD1306_WIDGET_MAX_CHARS 16
+
+typedef enum {
+	WIDGET_LABEL = 0,	// Fixed text
+	WIDGET_NUMBER,		// prefix + fixed-point value + suffix
+	WIDGET_BAR,		// Horizontal bar graph
+	WIDGET_ICON		// One of two bitmaps
+} ssd1306_widget_type_t;
+
+typedef struct {
+	ssd1306_widget_type_t type;
+	bool invert;
+
+	// Text widgets: character cell position and field width in characters
+	int page;
+	int col;
+	int chars;
+	const char * text;	// Label text / number prefix
+	const char * suffix;
+	const char * placeholder;	// Shown while the source is NaN
+	int decimals;
+	float scale;		// Applied to the source before formatting
+	float deadband;		// Ignore changes smaller than this (displayed units)
+
+	// Graphic widgets: pixel box
+	int x;
+	int y;
+	int width;
+	int height;
+	float lo;		// Bar range
+	float hi;
+	const uint8_t * bitmap_on;	// Icon for a non-zero source
+	const uint8_t * bitmap_off;	// Icon for zero (NULL: blank)
+
+	const float * source;
+
+	// Retained state
+	bool drawn;
+	float last_value;
+	char shown[SSD1306_WIDGET_MAX_CHARS];
+	int bar_fill;		// Filled columns inside the frame
+	int icon_state;
+} SSD1306_Widget_t;
+
+void ssd1306_widget_label(SSD1306_Widget_t * w, int page, int col, const char * text);
+void ssd1306_widget_number(SSD1306_Widget_t * w, int page, int col, int chars, const float * source, float scale, int decimals, const char * suffix);
+void ssd1306_widget_bar(SSD1306_Widget_t * w, int x, int y, int width, int height, const float * source, float lo, float hi);
+void ssd1306_widget_icon(SSD1306_Widget_t * w, int x, int y, int width, int height, const float * source, const uint8_t * bitmap_on, const uint8_t * bitmap_off);
+void ssd1306_widget_invalidate(SSD1306_Widget_t * w);
+bool ssd1306_widget_update(SSD1306_t * dev, SSD1306_Widget_t * w);
+int ssd1306_widgets_update(SSD1306_t * dev, SSD1306_Widget_t * widgets, int count);
+int ssd1306_format_fixed(char * buf, int size, float value, int decimals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_WIDGETS_H_ */
@@ -1,26 +1,61 @@
 #include "bme688.h"
+#include "i2c_bus.h"
 #include "esp_err.h"
 #include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 #include <stdint.h>
 
+#define BME688_POLL_INTERVAL_MS     2       // new_data polling step once the expected duration elapsed
+
+// Oversampling register code -> number of conversion cycles (pg. 36)
+static const uint8_t os_to_meas_cycles[6] = {0, 1, 2, 4, 8, 16};
+
+// ------ Measurement duration (TPH only, forced mode) ------
+static uint32_t BME688_CalcMeasDuration(uint8_t os_t, uint8_t os_p, uint8_t os_h) {
+    uint32_t meas_cycles = 0;
+    meas_cycles += os_to_meas_cycles[os_t > 5 ? 5 : os_t];
+    meas_cycles += os_to_meas_cycles[os_p > 5 ? 5 : os_p];
+    meas_cycles += os_to_meas_cycles[os_h > 5 ? 5 : os_h];
+
+    uint32_t meas_dur_us = meas_cycles * 1963;
+    meas_dur_us += 477 * 4;             // TPH switching duration
+    meas_dur_us += 477 * 5;             // Gas measurement duration
+    meas_dur_us += 500;                 // Wake up from sleep
+
+    return (meas_dur_us / 1000) + 1;    // Round up to whole milliseconds
+}
+
+
 // ------ BME688 Initialization Function ------
 uint8_t BME688_INITIALIZE(BME688 *dev, i2c_port_t port) {
     dev ->i2c_port          = port;
     dev ->address           = BME688_I2C_ADDR;
+    if (dev->timeout_ms == 0)
+        dev ->timeout_ms    = BME688_I2C_TIMEOUT_MS;
+    dev ->deadline_us       = 0;
     dev ->humidity          = 0.0f;
     dev ->temp_c            = 0.0f;
-    dev ->pressure          = 0.0f;
+    dev ->pressure_pa       = 0.0f;
+    dev ->gas_res_ohm       = 0;
+    dev ->gas_wait          = 0;
+    dev ->run_gas           = false;
+    dev ->heat_temp_c       = BME688_HEATER_TEMP_DEFAULT;
+    dev ->heat_wait_ms      = BME688_HEATER_WAIT_DEFAULT_MS;
+    dev ->gas_valid         = false;
+    dev ->heat_stab         = false;
 
     uint8_t errNum = 0;
     esp_err_t status;
-    uint8_t registerData;
+    uint8_t registerData = 0;
     
     // Read the contents of the variant id register
     status = BME688_ReadRegister(dev, BME688_VARIANT_ID, &registerData);
 
-    // Check Device ID
+    // Check Device ID (bail out right away if the sensor does not answer)
     errNum += (status !=ESP_OK);
-    if (registerData != BME688_DEVICE_ID)
+    if (status != ESP_OK || registerData != BME688_DEVICE_ID)
         return 255;
 
     // Set Device Polling Mode
@@ -58,6 +93,9 @@ uint8_t BME688_INITIALIZE(BME688 *dev, i2c_port_t port) {
     status = BME688_WriteRegister(dev, BME688_CONFIG, &registerData);
     errNum += (status !=ESP_OK);
 
+    // Expected conversion time for 8x/8x/8x oversampling
+    dev->meas_dur_ms = BME688_CalcMeasDuration(0b100, 0b100, 0b100);
+
     // ------ Read Calibration Variables ------
     uint8_t lsb, msb;
 
@@ -193,30 +231,127 @@ uint8_t BME688_INITIALIZE(BME688 *dev, i2c_port_t port) {
 }
 
 // ------ Low Level Functions ------
+// Timeout for the next transfer: the per-transfer timeout, shortened to what is
+// left of the sample budget. Returns false when the budget is already spent.
+static bool BME688_TransferTicks(BME688 *dev, TickType_t *ticks) {
+    uint32_t timeout_ms = dev->timeout_ms ? dev->timeout_ms : BME688_I2C_TIMEOUT_MS;
+
+    if (dev->deadline_us != 0) {
+        int64_t remaining_us = dev->deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0) {
+            dev->err_budget++;
+            return false;
+        }
+        uint32_t remaining_ms = (uint32_t)((remaining_us + 999) / 1000);
+        if (remaining_ms < timeout_ms) timeout_ms = remaining_ms;
+    }
+
+    *ticks = I2C_BUS_TimeoutTicks(timeout_ms);
+    return true;
+}
+
+// Lock the bus within the transfer's timeout; the transfer gets what is left of
+// it. A bus still busy when the timeout (or the sample budget) runs out counts
+// as err_timeout (err_budget) and nothing is sent.
+static esp_err_t BME688_BusBegin(BME688 *dev, TickType_t *ticks) {
+    TickType_t start = xTaskGetTickCount();
+    if (I2C_BUS_Begin(dev->i2c_port, dev->address, *ticks) != ESP_OK) {
+        if (dev->deadline_us != 0 && esp_timer_get_time() >= dev->deadline_us) {
+            dev->err_budget++;
+        } else {
+            dev->err_timeout++;
+        }
+        return ESP_ERR_TIMEOUT;
+    }
+    TickType_t waited = xTaskGetTickCount() - start;
+    *ticks = (waited < *ticks) ? *ticks - waited : 1;
+    return ESP_OK;
+}
+
+static esp_err_t BME688_CountError(BME688 *dev, esp_err_t status) {
+    if (status == ESP_ERR_TIMEOUT) {
+        dev->err_timeout++;
+    } else if (status != ESP_OK) {
+        dev->err_nack++;
+    }
+    return status;
+}
+
 // Read Register
 esp_err_t BME688_ReadRegister(BME688 *dev, uint8_t reg, uint8_t *data) {
-    return i2c_master_write_read_device(
+    TickType_t ticks;
+    if (!BME688_TransferTicks(dev, &ticks)) return ESP_ERR_TIMEOUT;
+    if (BME688_BusBegin(dev, &ticks) != ESP_OK) return ESP_ERR_TIMEOUT;   // Lock bus, switch to this device's SCL speed
+
+    esp_err_t status = i2c_master_write_read_device(
         dev->i2c_port,                  // I2C port (ex: I2C_NUM_0)
         dev->address,                   // sensor I2C address (0x76 or 0x77)
         &reg,                           // buffer containing register address
         1,                              // 1 byte (8 bits) size of register address
         data,                           // buffer to store read data
         1,                              // number of bytes to read
-        1000 / portTICK_PERIOD_MS       // timeout in ticks
+        ticks                           // timeout in ticks
     );
+    I2C_BUS_End(dev->i2c_port);
+
+    return BME688_CountError(dev, status);
 }
 
 // Write Register
 esp_err_t BME688_WriteRegister(BME688 *dev, uint8_t reg, uint8_t *data) {
     uint8_t buffer[2] = {reg, *data};   // ESPIDF expects register writes to be two bytes
-    
-    return i2c_master_write_to_device(
+    TickType_t ticks;
+    if (!BME688_TransferTicks(dev, &ticks)) return ESP_ERR_TIMEOUT;
+    if (BME688_BusBegin(dev, &ticks) != ESP_OK) return ESP_ERR_TIMEOUT;
+
+    esp_err_t status = i2c_master_write_to_device(
         dev->i2c_port,                  // I2C port (ex:I2C_NUM_0)
         dev->address,                   // sensor I2C address (0x76 or 0x77)
         buffer,                         // buffer containing register address
         2,                              // 2 bytes (16 bits) 
-        1000 / portTICK_PERIOD_MS       // timeout in ticks
+        ticks                           // timeout in ticks
     );
+    I2C_BUS_End(dev->i2c_port);
+
+    return BME688_CountError(dev, status);
+}
+
+// ------ Bus integrity check (used by the SCL speed probe) ------
+// Chip ID plus a few calibration words, compared with what INITIALIZE read.
+esp_err_t BME688_VerifyBus(BME688 *dev) {
+    esp_err_t status;
+    uint8_t chip_id = 0;
+    uint8_t lsb = 0, msb = 0;
+
+    status = BME688_ReadRegister(dev, BME688_CHIP_ID, &chip_id);
+    if (status != ESP_OK) return status;
+    if (chip_id != BME688_CHIP_ID_VALUE) return ESP_ERR_INVALID_RESPONSE;
+
+    status  = BME688_ReadRegister(dev, BME688_CALIB_PAR_T1_LSB, &lsb);
+    status |= BME688_ReadRegister(dev, BME688_CALIB_PAR_T1_MSB, &msb);
+    if (status != ESP_OK) return ESP_FAIL;
+    if (dev->par_t1 != (uint16_t)((msb << 8) | lsb)) return ESP_ERR_INVALID_RESPONSE;
+
+    status  = BME688_ReadRegister(dev, BME688_CALIB_PAR_P1_LSB, &lsb);
+    status |= BME688_ReadRegister(dev, BME688_CALIB_PAR_P1_MSB, &msb);
+    if (status != ESP_OK) return ESP_FAIL;
+    if (dev->par_p1 != (uint16_t)((msb << 8) | lsb)) return ESP_ERR_INVALID_RESPONSE;
+
+    status  = BME688_ReadRegister(dev, BME688_CALIB_PAR_G2_LSB, &lsb);
+    status |= BME688_ReadRegister(dev, BME688_CALIB_PAR_G2_MSB, &msb);
+    if (status != ESP_OK) return ESP_FAIL;
+    if (dev->par_g2 != (int16_t)((msb << 8) | lsb)) return ESP_ERR_INVALID_RESPONSE;
+
+    return ESP_OK;
+}
+
+// ------ Per-sample latency budget ------
+void BME688_SetDeadline(BME688 *dev, uint32_t budget_ms) {
+    dev->deadline_us = esp_timer_get_time() + (int64_t)budget_ms * 1000;
+}
+
+void BME688_ClearDeadline(BME688 *dev) {
+    dev->deadline_us = 0;
 }
 
 
@@ -232,10 +367,34 @@ esp_err_t BME688_ForceMeasurement(BME688 *dev) {
     registerData |= 0x01;               // Set forced mode
     status = BME688_WriteRegister(dev, BME688_CTRL_MEAS, &registerData);
     if (status != ESP_OK) return status;
-    vTaskDelay(pdMS_TO_TICKS(10));      // Small delay before polling data registers
     
     return ESP_OK;
 }
+
+// ------ Wait for forced measurement to complete ------
+// Sleeps for the expected TPH conversion time (plus heater time when run_gas is set),
+// then polls new_data_0 until the sensor reports fresh results.
+esp_err_t BME688_WaitForMeasurement(BME688 *dev, uint32_t timeout_ms) {
+    esp_err_t status;
+    uint8_t registerData;
+    int64_t start_us = esp_timer_get_time();
+
+    uint32_t expected_ms = dev->meas_dur_ms;
+    if (dev->run_gas) expected_ms += BME688_DecodeGasWait(dev->gas_wait);
+    if (expected_ms > timeout_ms) expected_ms = timeout_ms;
+
+    vTaskDelay(pdMS_TO_TICKS(expected_ms));
+
+    while (1) {
+        status = BME688_ReadRegister(dev, BME688_MEAS_STATUS_0, &registerData);
+        if (status != ESP_OK) return status;
+        if (registerData & BME688_NEW_DATA_MSK) return ESP_OK;
+        if (esp_timer_get_time() - start_us >= (int64_t)timeout_ms * 1000) return ESP_ERR_TIMEOUT;
+
+        TickType_t poll = pdMS_TO_TICKS(BME688_POLL_INTERVAL_MS);
+        vTaskDelay(poll ? poll : 1);    // At least one tick, even at 100 Hz
+    }
+}
 // ------ Measure Temperature Data ------
 esp_err_t BME688_ReadTemperature(BME688 *dev) {
     uint8_t regData[3];                  // 24 bit data
@@ -301,7 +460,7 @@ esp_err_t BME688_ReadPressure(BME688 *dev) {
     var3 = (press_comp / 256.0) * (press_comp / 256.0) * (press_comp / 256.0) * (dev->par_p10 / 131072.0);
     press_comp = press_comp + (var1 + var2 + var3 + ((double)dev->par_p7 * 128.0)) / 16.0;
     //press_comp = press_comp / 1000.0;
-    dev->pressure = press_comp;
+    dev->pressure_pa = press_comp;
     
     return ESP_OK;
 }
@@ -313,6 +472,7 @@ esp_err_t BME688_ReadHumidity(BME688 *dev) {
 
     status  = BME688_ReadRegister(dev, BME688_HUM_MSB_0, &regData[0]);
     status |= BME688_ReadRegister(dev, BME688_HUM_LSB_0, &regData[1]);
+    if (status != ESP_OK) return status;
 
     uint16_t hum_raw = ((int32_t)regData[0] << 8) | 
                        ((int32_t)regData[1]);
@@ -344,8 +504,8 @@ esp_err_t BME688_WriteGas(BME688 *dev) {
     float var3;
     float var4;
     float var5;
-    float target_temp = 250.0; // 250°C
-    uint8_t gas_wait = 0b01110010; // corresponds to: 00 (1x),  110010 = 50
+    float target_temp = dev->heat_temp_c;                       // default 250°C
+    uint8_t gas_wait = BME688_EncodeGasWait(dev->heat_wait_ms); // default 0b01110010 = 01 (4x), 110010 = 50
     uint8_t ctrl_gas_1 = 0x20; // 0b00100000. run gas: bit5, heater_step = 0
     uint8_t res_heat;
 
@@ -365,11 +525,54 @@ esp_err_t BME688_WriteGas(BME688 *dev) {
     status = BME688_WriteRegister(dev, BME688_GAS_WAIT_0, &gas_wait);
     if (status != ESP_OK) return status;
 
+    dev->gas_wait = gas_wait;
+
     // Turn on heater
     status = BME688_WriteRegister(dev, BME688_CTRL_GAS_1, &ctrl_gas_1);
     if (status != ESP_OK) return status;
+    dev->run_gas = true;
     //printf("%d\n", (int)res_heat);
-    vTaskDelay(pdMS_TO_TICKS(300));  // Delay 30 milliseconds
+    // Heater runs during the next forced measurement, see BME688_WaitForMeasurement
+
+    return ESP_OK;
+}
+
+// ------ Heater profile for the next BME688_WriteGas ------
+void BME688_SetHeaterProfile(BME688 *dev, uint16_t target_temp_c, uint16_t wait_ms) {
+    dev->heat_temp_c = target_temp_c;
+    dev->heat_wait_ms = wait_ms;
+}
+
+// ------ gas_wait_x encoding ------ || Pg. 39
+// Bits 5:0 hold the duration, bits 7:6 a multiplier of 1, 4, 16 or 64 ms.
+uint8_t BME688_EncodeGasWait(uint16_t wait_ms) {
+    uint8_t factor = 0;
+
+    if (wait_ms >= BME688_HEATER_WAIT_MAX_MS) return 0xFF;
+    while (wait_ms > 0x3F) {
+        wait_ms = (wait_ms + 3) / 4;    // Round up so the heater never gets less than requested
+        factor++;
+    }
+    if (wait_ms > 0x3F) return 0xFF;
+
+    return (uint8_t)((factor << 6) | wait_ms);
+}
+
+uint32_t BME688_DecodeGasWait(uint8_t gas_wait) {
+    static const uint8_t multiplier[4] = {1, 4, 16, 64};
+    return (uint32_t)(gas_wait & 0x3F) * multiplier[gas_wait >> 6];
+}
+
+// ------ Enable/disable gas conversion for the next forced measurement ------
+esp_err_t BME688_SetGasEnabled(BME688 *dev, bool enable) {
+    esp_err_t status;
+    uint8_t ctrl_gas_1 = enable ? 0x20 : 0x00;  // run gas: bit5, heater_step = 0
+
+    if (dev->run_gas == enable) return ESP_OK;  // Skip redundant bus write
+
+    status = BME688_WriteRegister(dev, BME688_CTRL_GAS_1, &ctrl_gas_1);
+    if (status != ESP_OK) return status;
+    dev->run_gas = enable;
 
     return ESP_OK;
 }
@@ -383,9 +586,12 @@ esp_err_t BME688_ReadGas(BME688 *dev) {
     // Extract raw gas data
     status  = BME688_ReadRegister(dev, BME688_GAS_R_MSB_0, &regData[0]);
     status |= BME688_ReadRegister(dev, BME688_GAS_R_LSB_0, &regData[1]);
+    if (status != ESP_OK) return status;
     uint16_t gas_r_raw = ((uint16_t)regData[0] << 2) | 
                             ((regData[1] & 0xC0) >> 6); 
     uint8_t gas_range = regData[1] & 0x0F; // Positions 3:0 contain gas range
+    dev->gas_valid = (regData[1] & BME688_GAS_VALID_MSK) != 0;
+    dev->heat_stab = (regData[1] & BME688_HEAT_STAB_MSK) != 0;
 
     // Convert raw gas readings using calibration values
     uint32_t var1_r;
@@ -397,7 +603,7 @@ esp_err_t BME688_ReadGas(BME688 *dev) {
     var2_r *= INT32_C(3);
     var2_r = INT32_C(4096) + var2_r;
     gas_res = 1000000.0 * (float)var1_r / (float)var2_r;
-    dev->gas_res = gas_res;
+    dev->gas_res_ohm = gas_res;
 
     return ESP_OK;
 }
\ No newline at end of file
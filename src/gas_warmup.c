@@ -0,0 +1,99 @@
+#include "gas_warmup.h"
+#include <math.h>
+#include <string.h>
+
+static void WARMUP_EnterPhase(WARMUP *w, WARMUP_Phase phase, int64_t now_ms) {
+    w->phase = phase;
+    w->phase_start_ms = now_ms;
+    w->count = 0;               // Resistance jumps when the heater temperature changes
+    w->head = 0;
+    w->have_drift = false;
+    w->below_count = 0;
+}
+
+// ------ Initialization ------
+void WARMUP_Init(WARMUP *w, uint16_t heater_temp_c, uint32_t gas_period_ms, int64_t now_ms) {
+    memset(w, 0, sizeof(*w));
+    w->boot_ms = now_ms;
+    w->heater_temp_c = heater_temp_c;
+    w->gas_period_ms = gas_period_ms;
+    w->time_to_stable_ms = -1;
+    WARMUP_EnterPhase(w, WARMUP_PRECONDITION, now_ms);
+}
+
+// ------ Heater target / gas period for the current phase ------
+uint16_t WARMUP_HeaterTemp(const WARMUP *w) {
+    return (w->phase == WARMUP_PRECONDITION) ? WARMUP_PRECOND_TEMP_C : w->heater_temp_c;
+}
+
+uint32_t WARMUP_GasPeriod(const WARMUP *w) {
+    switch (w->phase) {
+        case WARMUP_PRECONDITION:   return WARMUP_PRECOND_PERIOD_MS;
+        case WARMUP_SETTLING:       return WARMUP_SETTLE_PERIOD_MS;
+        default:                    return w->gas_period_ms;
+    }
+}
+
+// ------ Least-squares slope of ln(R) over the window, 1/min ------
+static float WARMUP_Slope(const WARMUP *w) {
+    float t_mean = 0.0f, y_mean = 0.0f;
+    for (int i = 0; i < w->count; i++) {
+        t_mean += w->t_ms[i] / 60000.0f;
+        y_mean += w->ln_r[i];
+    }
+    t_mean /= w->count;
+    y_mean /= w->count;
+
+    float sxy = 0.0f, sxx = 0.0f;
+    for (int i = 0; i < w->count; i++) {
+        float dt = w->t_ms[i] / 60000.0f - t_mean;
+        sxy += dt * (w->ln_r[i] - y_mean);
+        sxx += dt * dt;
+    }
+    return (sxx > 0.0f) ? sxy / sxx : 0.0f;
+}
+
+// ------ Feed the result of one gas cycle (gas_res_ohm = 0 if not valid) ------
+// Returns true when the reading was taken at the measurement temperature and
+// may be published (pre-conditioning readings are not comparable).
+bool WARMUP_Update(WARMUP *w, uint32_t gas_res_ohm, int64_t now_ms) {
+    if (w->phase == WARMUP_PRECONDITION) {
+        if (now_ms - w->phase_start_ms >= WARMUP_PRECOND_DURATION_MS) {
+            WARMUP_EnterPhase(w, WARMUP_SETTLING, now_ms);
+        }
+        return false;
+    }
+    // Settling that never converges (drifting or very noisy sensor) still ends
+    if (w->phase == WARMUP_SETTLING && now_ms - w->phase_start_ms >= WARMUP_SETTLE_MAX_MS) {
+        w->stable = true;
+        w->settle_timeout = true;
+        w->time_to_stable_ms = now_ms - w->boot_ms;
+        w->phase = WARMUP_STABLE;
+    }
+    if (gas_res_ohm == 0) return false;
+    if (w->phase == WARMUP_STABLE) return true;
+
+    w->ln_r[w->head] = logf((float)gas_res_ohm);
+    w->t_ms[w->head] = (int32_t)(now_ms - w->phase_start_ms);
+    w->head = (w->head + 1) % WARMUP_SLOPE_SAMPLES;
+    if (w->count < WARMUP_SLOPE_SAMPLES) w->count++;
+
+    // Judge only full windows: a short fit is dominated by reading noise
+    if (w->count == WARMUP_SLOPE_SAMPLES) {
+        w->drift_per_min = WARMUP_Slope(w);
+        w->have_drift = true;
+        if (fabsf(w->drift_per_min) < WARMUP_DRIFT_THRESHOLD) {
+            if (w->below_count < UINT16_MAX) w->below_count++;
+        } else {
+            w->below_count = 0;
+        }
+    }
+
+    if (w->phase == WARMUP_SETTLING && w->below_count >= WARMUP_STABLE_SAMPLES) {
+        w->stable = true;
+        w->time_to_stable_ms = now_ms - w->boot_ms;
+        w->phase = WARMUP_STABLE;
+    }
+
+    return true;
+}
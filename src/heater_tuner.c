@@ -0,0 +1,85 @@
+#include "heater_tuner.h"
+#include <string.h>
+
+static uint16_t HEATER_Step(uint16_t wait_ms, uint16_t div) {
+    uint16_t step = wait_ms / div;
+    return step < HEATER_TUNER_MIN_STEP_MS ? HEATER_TUNER_MIN_STEP_MS : step;
+}
+
+// Quantize to what gas_wait can actually express so learned values match the hardware
+static uint16_t HEATER_Quantize(uint16_t wait_ms) {
+    return (uint16_t)BME688_DecodeGasWait(BME688_EncodeGasWait(wait_ms));
+}
+
+static HEATER_Profile *HEATER_Find(HEATER_Tuner *tuner, uint16_t target_temp_c) {
+    for (int i = 0; i < tuner->count; i++) {
+        if (tuner->profile[i].target_temp_c == target_temp_c) return &tuner->profile[i];
+    }
+    return NULL;
+}
+
+// ------ Initialization ------
+void HEATER_TunerInit(HEATER_Tuner *tuner, uint16_t start_ms) {
+    memset(tuner, 0, sizeof(*tuner));
+    tuner->start_ms = HEATER_Quantize(start_ms);
+}
+
+// ------ Program the heater profile for the next gas cycle ------
+void HEATER_TunerApply(HEATER_Tuner *tuner, BME688 *dev, uint16_t target_temp_c) {
+    HEATER_Profile *p = HEATER_Find(tuner, target_temp_c);
+
+    if (p == NULL) {
+        if (tuner->count < HEATER_TUNER_MAX_PROFILES) {
+            p = &tuner->profile[tuner->count++];
+        } else {
+            p = &tuner->profile[HEATER_TUNER_MAX_PROFILES - 1];    // Recycle the last slot
+        }
+        memset(p, 0, sizeof(*p));
+        p->target_temp_c    = target_temp_c;
+        p->wait_ms          = tuner->start_ms;
+        p->last_stable_ms   = tuner->start_ms;
+        p->state            = HEATER_TUNE_SEARCH;
+    }
+
+    tuner->active = p;
+    BME688_SetHeaterProfile(dev, target_temp_c, p->wait_ms);
+}
+
+// ------ Feed back heat_stab_r from the gas result ------
+void HEATER_TunerUpdate(HEATER_Tuner *tuner, const BME688 *dev) {
+    HEATER_Profile *p = tuner->active;
+    if (p == NULL || p->target_temp_c != dev->heat_temp_c) return;
+    if (!dev->gas_valid) return;                        // No conversion, nothing learned
+
+    if (dev->heat_stab) {
+        if (p->wait_ms < p->last_stable_ms) p->last_stable_ms = p->wait_ms;
+
+        if (p->state == HEATER_TUNE_SEARCH) {
+            uint16_t step = HEATER_Step(p->wait_ms, HEATER_TUNER_SHRINK_DIV);
+            uint16_t next = (p->wait_ms > HEATER_TUNER_MIN_MS + step) ? p->wait_ms - step : HEATER_TUNER_MIN_MS;
+            next = HEATER_Quantize(next);
+
+            if (next >= p->wait_ms || p->wait_ms == HEATER_TUNER_MIN_MS) {
+                p->state = HEATER_TUNE_LOCKED;          // Hit the floor while still stable
+            } else {
+                p->wait_ms = next;
+            }
+        }
+    } else {
+        p->unstable_count++;
+
+        // Back off to the last stable duration plus margin and keep it
+        uint16_t base = (p->state == HEATER_TUNE_SEARCH) ? p->last_stable_ms : p->wait_ms;
+        uint32_t next = (uint32_t)base + HEATER_Step(base, HEATER_TUNER_MARGIN_DIV);
+        if (next > BME688_HEATER_WAIT_MAX_MS) next = BME688_HEATER_WAIT_MAX_MS;
+
+        p->wait_ms = HEATER_Quantize((uint16_t)next);
+        p->last_stable_ms = p->wait_ms;
+        p->state = HEATER_TUNE_LOCKED;
+    }
+}
+
+// ------ Learned duration for a target temperature (NULL if never used) ------
+const HEATER_Profile *HEATER_TunerGetProfile(const HEATER_Tuner *tuner, uint16_t target_temp_c) {
+    return HEATER_Find((HEATER_Tuner *)tuner, target_temp_c);
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "esp_rom_sys.h"
+
+#include "i2c_bus.h"
+
+// Candidate speeds for I2C_BUS_ProbeSpeed, slowest first
+static const uint32_t probe_speeds[] = {100000, 400000, 1000000};
+
+// Buses registered by I2C_BUS_Init, looked up by port from the device drivers
+static I2C_BUS *registered[I2C_NUM_MAX];
+
+static esp_err_t I2C_BUS_Configure(I2C_BUS *bus, uint32_t clk_hz) {
+    i2c_config_t conf = {0};
+    conf.mode = I2C_MODE_MASTER;
+    conf.sda_io_num = bus->sda_io;
+    conf.scl_io_num = bus->scl_io;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.master.clk_speed = clk_hz;
+
+    esp_err_t status = i2c_param_config(bus->port, &conf);
+    if (status == ESP_OK) bus->active_hz = clk_hz;
+    return status;
+}
+
+static esp_err_t I2C_BUS_Install(I2C_BUS *bus) {
+    esp_err_t status = I2C_BUS_Configure(bus, bus->clk_hz);
+    if (status != ESP_OK) return status;
+    status = i2c_driver_install(bus->port, I2C_MODE_MASTER, 0, 0, 0);
+    if (status != ESP_OK) return status;
+
+    bus->installed = true;
+    return ESP_OK;
+}
+
+static I2C_BUS_Device *I2C_BUS_FindDevice(I2C_BUS *bus, uint8_t address) {
+    for (int i = 0; i < bus->num_devices; i++) {
+        if (bus->device[i].address == address) return &bus->device[i];
+    }
+    return NULL;
+}
+
+// ------ Bus initialization ------
+esp_err_t I2C_BUS_Init(I2C_BUS *bus, i2c_port_t port, int sda_io, int scl_io, uint32_t clk_hz) {
+    bus->port = port;
+    bus->sda_io = sda_io;
+    bus->scl_io = scl_io;
+    bus->clk_hz = clk_hz;
+    bus->active_hz = 0;
+    bus->installed = false;
+    bus->num_devices = 0;
+    bus->stats = (I2C_BUS_Stats){0};
+    bus->lock = xSemaphoreCreateMutex();
+
+    if (port >= 0 && port < I2C_NUM_MAX) registered[port] = bus;
+
+    return I2C_BUS_Install(bus);
+}
+
+// ------ Per-device clock speed ------
+esp_err_t I2C_BUS_SetDeviceSpeed(I2C_BUS *bus, uint8_t address, uint32_t clk_hz) {
+    I2C_BUS_Device *device = I2C_BUS_FindDevice(bus, address);
+    if (device == NULL) {
+        if (bus->num_devices >= I2C_BUS_MAX_DEVICES) return ESP_ERR_NO_MEM;
+        device = &bus->device[bus->num_devices++];
+        device->address = address;
+    }
+    device->clk_hz = clk_hz;
+    return ESP_OK;
+}
+
+uint32_t I2C_BUS_GetDeviceSpeed(const I2C_BUS *bus, uint8_t address) {
+    I2C_BUS_Device *device = I2C_BUS_FindDevice((I2C_BUS *)bus, address);
+    return device ? device->clk_hz : bus->clk_hz;
+}
+
+// Lock the bus within ticks and switch SCL to the device's speed (no-op for
+// unregistered ports). On ESP_ERR_TIMEOUT the bus is not locked.
+esp_err_t I2C_BUS_Begin(i2c_port_t port, uint8_t address, TickType_t ticks) {
+    if (port < 0 || port >= I2C_NUM_MAX || registered[port] == NULL) return ESP_OK;
+    I2C_BUS *bus = registered[port];
+
+    if (bus->lock && xSemaphoreTake(bus->lock, ticks) != pdTRUE) return ESP_ERR_TIMEOUT;
+    uint32_t clk_hz = I2C_BUS_GetDeviceSpeed(bus, address);
+    if (bus->installed && clk_hz != bus->active_hz) I2C_BUS_Configure(bus, clk_hz);
+    return ESP_OK;
+}
+
+void I2C_BUS_End(i2c_port_t port) {
+    if (port < 0 || port >= I2C_NUM_MAX || registered[port] == NULL) return;
+    I2C_BUS *bus = registered[port];
+
+    if (bus->lock) xSemaphoreGive(bus->lock);
+}
+
+// ------ Boot-time speed probe ------
+// Steps the device up through probe_speeds and keeps the fastest speed at which
+// every one of I2C_BUS_PROBE_REPEATS checks passed. Stops at the first failing speed.
+uint32_t I2C_BUS_ProbeSpeed(I2C_BUS *bus, uint8_t address, I2C_BUS_ProbeCheck check, void *ctx) {
+    uint32_t best_hz = 0;
+
+    for (int i = 0; i < sizeof(probe_speeds) / sizeof(probe_speeds[0]); i++) {
+        if (I2C_BUS_SetDeviceSpeed(bus, address, probe_speeds[i]) != ESP_OK) break;
+
+        bool ok = true;
+        for (int n = 0; n < I2C_BUS_PROBE_REPEATS && ok; n++) {
+            ok = (check(ctx) == ESP_OK);
+        }
+        if (!ok) {
+            I2C_BUS_Recover(bus);           // A failed transfer may have left the slave mid-byte
+            break;
+        }
+        best_hz = probe_speeds[i];
+    }
+
+    // Nothing passed: fall back to the bus default
+    if (best_hz == 0) best_hz = bus->clk_hz;
+    I2C_BUS_SetDeviceSpeed(bus, address, best_hz);
+    printf("I2C%d 0x%02X: %lu Hz\n", (int)bus->port, address, (unsigned long)best_hz);
+
+    return best_hz;
+}
+
+// ------ Bus lock-up recovery ------
+// A slave interrupted mid-byte can hold SDA low forever. Clock SCL until it
+// lets go (at most 9 pulses), generate a STOP, then reinstall the driver.
+esp_err_t I2C_BUS_Recover(I2C_BUS *bus) {
+    if (bus->lock) xSemaphoreTake(bus->lock, portMAX_DELAY);
+    if (bus->installed) {
+        i2c_driver_delete(bus->port);
+        bus->installed = false;
+    }
+    bus->stats.recoveries++;
+
+    gpio_reset_pin(bus->sda_io);
+    gpio_reset_pin(bus->scl_io);
+    gpio_set_direction(bus->sda_io, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(bus->scl_io, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(bus->sda_io, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode(bus->scl_io, GPIO_PULLUP_ONLY);
+    gpio_set_level(bus->sda_io, 1);
+    gpio_set_level(bus->scl_io, 1);
+    esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+
+    for (int i = 0; i < I2C_BUS_RECOVERY_CLOCKS; i++) {
+        if (gpio_get_level(bus->sda_io)) break;         // Slave released SDA
+        gpio_set_level(bus->scl_io, 0);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(bus->scl_io, 1);
+        esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA low -> high while SCL is high
+    gpio_set_level(bus->scl_io, 0);
+    esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(bus->sda_io, 0);
+    esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(bus->scl_io, 1);
+    esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(bus->sda_io, 1);
+    esp_rom_delay_us(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+
+    if (!gpio_get_level(bus->sda_io)) bus->stats.sda_stuck++;
+
+    bus->stats.driver_reinstalls++;
+    esp_err_t status = I2C_BUS_Install(bus);
+    if (status != ESP_OK) bus->stats.reinstall_failures++;
+
+    if (bus->lock) xSemaphoreGive(bus->lock);
+    return status;
+}
+
+void I2C_BUS_PrintStats(const I2C_BUS *bus) {
+    printf(
+    "I2C%d recoveries=%lu sda_stuck=%lu reinstalls=%lu reinstall_fail=%lu reinits=%lu reinit_fail=%lu\n",
+        (int)bus->port,
+        (unsigned long)bus->stats.recoveries,
+        (unsigned long)bus->stats.sda_stuck,
+        (unsigned long)bus->stats.driver_reinstalls,
+        (unsigned long)bus->stats.reinstall_failures,
+        (unsigned long)bus->stats.device_reinits,
+        (unsigned long)bus->stats.reinit_failures
+    );
+}
+
+// ------ Capped exponential backoff ------
+bool I2C_BUS_BackoffReady(const I2C_BUS_Backoff *backoff, int64_t now_ms) {
+    return backoff->delay_ms == 0 || now_ms >= backoff->next_attempt_ms;
+}
+
+void I2C_BUS_BackoffFail(I2C_BUS_Backoff *backoff, int64_t now_ms) {
+    if (backoff->delay_ms == 0) {
+        backoff->delay_ms = I2C_BUS_BACKOFF_BASE_MS;
+    } else {
+        backoff->delay_ms *= 2;
+        if (backoff->delay_ms > I2C_BUS_BACKOFF_MAX_MS) backoff->delay_ms = I2C_BUS_BACKOFF_MAX_MS;
+    }
+    backoff->next_attempt_ms = now_ms + backoff->delay_ms;
+}
+
+void I2C_BUS_BackoffReset(I2C_BUS_Backoff *backoff) {
+    backoff->delay_ms = 0;
+    backoff->next_attempt_ms = 0;
+}
+
+TickType_t I2C_BUS_TimeoutTicks(uint32_t timeout_ms) {
+    TickType_t ticks = (timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    return ticks + 1;           // The current tick may be almost over
+}
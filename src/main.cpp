@@ -3,7 +3,9 @@
 #include "freertos/task.h"
 #include "driver/i2c.h"
 #include <string.h>
+#include <math.h>
 #include "driver/gpio.h"
+#include "esp_timer.h"
 
 //#define DEVICE_ADDR     0x76  // BME688 Sensor
 
@@ -11,23 +13,124 @@
 // Drivers
 #include "bme688.h"
 #include "ssd1306.h"
+#include "ssd1306_chart.h"
+#include "ssd1306_widgets.h"
+#include "ssd1306_gray.h"
+#include "ssd1306_mirror.h"
+#include "sampler.h"
+#include "heater_tuner.h"
+#include "gas_warmup.h"
+#include "i2c_bus.h"
 
 #define I2C_PORT        I2C_NUM_0
 #define I2C_SDA_IO      2
 #define I2C_SCL_IO      1
-#define I2C_FREQ_HZ 100000  // 100 kHz
-
-void i2c_master_init(void) {
-    i2c_config_t conf = {};
-    conf.mode = I2C_MODE_MASTER;
-    conf.sda_io_num = I2C_SDA_IO;
-    conf.scl_io_num = I2C_SCL_IO;
-    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.master.clk_speed = I2C_FREQ_HZ;
-
-    i2c_param_config(I2C_PORT, &conf);
-    i2c_driver_install(I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
+#define I2C_FREQ_HZ 100000  // 100 kHz (default; each device is probed for a faster rate at boot)
+
+// OLED bus. Set OLED_I2C_PORT to I2C_NUM_1 (and wire the panel to OLED_SDA_IO/OLED_SCL_IO)
+// to give the display its own controller, so flushes never wait on sensor transfers.
+#define OLED_I2C_PORT   I2C_PORT
+#define OLED_SDA_IO     4
+#define OLED_SCL_IO     5
+
+// Set to 1 to time full-frame flushes at each SCL speed at boot
+#define OLED_FPS_BENCH  0
+#define OLED_FPS_FRAMES 50
+// Set to 1 to compare the bitmap blitter with the old bit-by-bit routine at boot
+#define OLED_BLIT_BENCH 0
+// Set to 1 to check at boot whether the display bus can drive 4-level grayscale
+#define OLED_GRAY_BENCH 0
+#define OLED_GRAY_SUBFRAME_HZ   150     // 50 gray cycles per second
+#define OLED_GRAY_BENCH_MS      2000
+// Set to 1 to stream the screen to the serial console (view with tools/oled_mirror.py)
+#define OLED_MIRROR     0
+
+// Fault handling
+#define SAMPLE_BUDGET_MS        150     // Bus + conversion time allowed per sample (heater wait added on top)
+#define SENSOR_FAULT_LIMIT      2       // Consecutive failed samples before bus recovery
+
+// Acquisition rates
+#define TPH_PERIOD_MS   1000    // Temperature/pressure/humidity at 1 Hz
+#define GAS_PERIOD_MS   30000   // Gas resistance every 30 s (heater only runs on these cycles)
+
+static int64_t now_ms(void) {
+    return esp_timer_get_time() / 1000;
+}
+
+static I2C_BUS sensor_bus;
+static I2C_BUS display_bus;
+
+// SCL speed probe checks
+static esp_err_t probe_sensor(void *ctx) {
+    return BME688_VerifyBus((BME688 *)ctx);
+}
+
+static esp_err_t probe_screen(void *ctx) {
+    return i2c_verify((SSD1306_t *)ctx);
+}
+
+// ------ Bus recovery + sensor re-initialization ------
+// Returns true once the sensor answers again; otherwise the next attempt is
+// pushed out by a capped exponential backoff.
+static bool sensor_recover(BME688 *sensor, I2C_BUS_Backoff *backoff) {
+    if (!I2C_BUS_BackoffReady(backoff, now_ms())) return false;
+
+    I2C_BUS_Recover(&sensor_bus);
+    sensor_bus.stats.device_reinits++;
+    uint8_t err = BME688_INITIALIZE(sensor, sensor_bus.port);
+    if (err != 0) {
+        sensor_bus.stats.reinit_failures++;
+        I2C_BUS_BackoffFail(backoff, now_ms());
+        printf("Sensor re-init failed (%d), retry in %lu ms\n", err, (unsigned long)backoff->delay_ms);
+    } else {
+        I2C_BUS_BackoffReset(backoff);
+        printf("Sensor recovered\n");
+    }
+    I2C_BUS_PrintStats(&sensor_bus);
+    printf("BME688 timeouts=%lu nacks=%lu budget=%lu\n",
+        (unsigned long)sensor->err_timeout, (unsigned long)sensor->err_nack, (unsigned long)sensor->err_budget);
+
+    return err == 0;
+}
+
+// ------ Display frame-rate benchmark ------
+// Times OLED_FPS_FRAMES single-transaction frame flushes at each SCL speed,
+// then restores the probed rate.
+static void oled_fps_bench(I2C_BUS *bus, SSD1306_t *screen) {
+    static const uint32_t speeds[] = { 100000, 400000, 1000000 };
+    uint32_t probed = I2C_BUS_GetDeviceSpeed(bus, screen->_address);
+
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        I2C_BUS_SetDeviceSpeed(bus, screen->_address, speeds[i]);
+        if (i2c_verify(screen) != ESP_OK) {
+            printf("OLED %lu Hz: no response\n", (unsigned long)speeds[i]);
+            I2C_BUS_Recover(bus);
+            continue;
+        }
+        float fps = ssd1306_measure_fps(screen, OLED_FPS_FRAMES);
+        printf("OLED %lu Hz: %.1f fps\n", (unsigned long)speeds[i], fps);
+    }
+    I2C_BUS_SetDeviceSpeed(bus, screen->_address, probed);
+}
+
+// ------ Grayscale benchmark ------
+// Cycles a four-level test pattern for OLED_GRAY_BENCH_MS and prints the
+// subframe rate and jitter the bus actually achieved.
+static void oled_gray_bench(SSD1306_t *screen) {
+    static SSD1306_Gray_t gray;
+    SSD1306_GrayStats_t stats;
+
+    ssd1306_gray_init(&gray, screen);
+    for (int level = 0; level < SSD1306_GRAY_LEVELS; level++) {
+        ssd1306_gray_fill_rect(&gray, level * 32, 16, 32, 48, level);
+    }
+    ssd1306_gray_text(&gray, 0, 0, "Gray levels", 11, 3);
+    ssd1306_gray_run(&gray, OLED_GRAY_SUBFRAME_HZ, OLED_GRAY_BENCH_MS, &stats);
+    ssd1306_gray_end(&gray);
+
+    printf("OLED gray: %.1f subframes/s (%.1f gray Hz), jitter %.0f us, late %d, dropped %d: %s\n",
+           stats.subframe_hz, stats.gray_hz, stats.jitter_us, stats.late, stats.dropped,
+           stats.sustained ? "sustained" : "bus too slow");
 }
 
 void i2c_scan() {
@@ -51,14 +154,21 @@ void i2c_scan() {
 extern "C" void app_main(void)
 {   
     // Initialize I2C bus
-    i2c_master_init();
+    I2C_BUS_Init(&sensor_bus, I2C_PORT, I2C_SDA_IO, I2C_SCL_IO, I2C_FREQ_HZ);
+    I2C_BUS *screen_bus = &sensor_bus;
+    if (OLED_I2C_PORT != I2C_PORT) {
+        I2C_BUS_Init(&display_bus, OLED_I2C_PORT, OLED_SDA_IO, OLED_SCL_IO, I2C_FREQ_HZ);
+        screen_bus = &display_bus;
+    }
 
     // Initialize sensor/screen
     BME688 sensor;
-    SSD1306_t screen;
+    memset(&sensor, 0, sizeof(sensor));
+    // Static: the frame, shadow and flush buffers are too large for the main task stack
+    static SSD1306_t screen;
     memset(&screen, 0, sizeof(screen));
     screen._address = 0x3C;         // REQUIRED
-    screen._i2c_num = I2C_PORT;     // REQUIRED (0 or 1)
+    screen._i2c_num = screen_bus->port;     // REQUIRED (0 or 1)
 
     esp_err_t status;
     uint8_t err = BME688_INITIALIZE(&sensor, I2C_PORT);
@@ -67,6 +177,20 @@ extern "C" void app_main(void)
     ssd1306_clear_screen(&screen, false);       // clear, with default background (black)
     ssd1306_contrast(&screen, 0xff); 
 
+    // Step each device up through 100k/400k/1M and keep the fastest reliable rate
+    if (err == 0) I2C_BUS_ProbeSpeed(&sensor_bus, sensor.address, probe_sensor, &sensor);
+    I2C_BUS_ProbeSpeed(screen_bus, screen._address, probe_screen, &screen);
+    if (OLED_FPS_BENCH) oled_fps_bench(screen_bus, &screen);
+    if (OLED_BLIT_BENCH) ssd1306_bench_bitmaps(&screen, 100);
+    if (OLED_GRAY_BENCH) oled_gray_bench(&screen);
+
+    // Panel I/O runs in its own task; the loop below only renders and presents
+    if (ssd1306_start_flush_task(&screen, tskIDLE_PRIORITY + 1) != ESP_OK) {
+        printf("Display flush task unavailable, drawing synchronously\n");
+    }
+    static SSD1306_Mirror_t mirror;
+    if (OLED_MIRROR) ssd1306_mirror_init(&mirror, &screen, NULL, NULL);
+
     if (err == 0) {
             printf("Initialization completed with 0 errors!\n");
             printf("Running loop\n");
@@ -74,56 +198,142 @@ extern "C" void app_main(void)
             printf("Number of errors: %d\n", err);
         }
    
+    // Gas runs on the warm-up schedule until the sensor has settled
+    WARMUP warmup;
+    WARMUP_Init(&warmup, BME688_HEATER_TEMP_DEFAULT, GAS_PERIOD_MS, now_ms());
+
+    SAMPLER sampler;
+    SAMPLER_Init(&sampler, TPH_PERIOD_MS, WARMUP_GasPeriod(&warmup), now_ms());
+
+    HEATER_Tuner tuner;
+    HEATER_TunerInit(&tuner, BME688_HEATER_WAIT_DEFAULT_MS);
+
+    // Sparklines under the text: temperature on pages 4-5, humidity on 6-7
+    static SSD1306_Chart_t temp_chart, hum_chart;
+    ssd1306_chart_init(&temp_chart, &screen, 4, 2);
+    ssd1306_chart_init(&hum_chart, &screen, 6, 2);
+
+    // Status text: static labels plus value fields bound to the sensor readings.
+    // Deadbands are half a display step so readings don't flicker between two values.
+    static float gas_kohm = NAN;
+    enum { STATUS_WIDGETS = 8 };
+    static SSD1306_Widget_t status_widgets[STATUS_WIDGETS];
+    ssd1306_widget_label(&status_widgets[0], 0, 0, "Temp:");
+    ssd1306_widget_number(&status_widgets[1], 0, 6, 10, &sensor.temp_c, 1.0f, 1, " C");
+    status_widgets[1].deadband = 0.05f;
+    ssd1306_widget_label(&status_widgets[2], 1, 0, "Press:");
+    ssd1306_widget_number(&status_widgets[3], 1, 7, 9, &sensor.pressure_pa, 0.001f, 1, " kPa");
+    status_widgets[3].deadband = 0.05f;
+    ssd1306_widget_label(&status_widgets[4], 2, 0, "Hum:");
+    ssd1306_widget_number(&status_widgets[5], 2, 5, 11, &sensor.humidity, 1.0f, 1, "%");
+    status_widgets[5].deadband = 0.05f;
+    ssd1306_widget_label(&status_widgets[6], 3, 0, "GasR:");
+    ssd1306_widget_number(&status_widgets[7], 3, 6, 10, &gas_kohm, 1.0f, 1, " kOhm");
+    status_widgets[7].deadband = 0.05f;
+    status_widgets[7].placeholder = "warming up";
+
+    I2C_BUS_Backoff backoff = {};
+    bool sensor_faulted = (err != 0);
+    uint8_t fault_count = 0;
+
     // Main loop
     while (1) {
         //printf("Loop running\n");
         //i2c_scan();
-        //vTaskDelay(2000 / portTICK_PERIOD_MS);
-
-        // Force sensor to take new measurement
-        status = BME688_ForceMeasurement(&sensor);
-        //printf("Status: %d\n", status);
-
-        // Read Temp, Press, Hum Data
-        status = BME688_ReadTemperature(&sensor);
-        //printf("\tTemperature: %.2f °C\n", sensor.temp_c);
-
-        status = BME688_ReadPressure(&sensor);
-        float pressure_kpa = sensor.pressure_pa / 1000.0f;
-        //printf("\tPressure: %.2f Pa\n", pressure_kpa);
-        
-        status = BME688_ReadHumidity(&sensor);
-        //printf("\tHumidity: %.2f \n", sensor.humidity);
-
-        // Read and write gas
-        status = BME688_WriteGas(&sensor);
-        status = BME688_ReadGas(&sensor);
-        float gas_res_kohm = sensor.gas_res_ohm / 1000.0f;
-        //printf("\tGas Resistance: %.2f ohms\n", gas_res_kohm);
-
-        printf(
-        "%.2f,%.2f,%.2f,%lu\n",
-            sensor.temp_c,
-            sensor.pressure_pa,
-            sensor.humidity,
-            sensor.gas_res_ohm
-        );
-
-        // Format data for SSD1306
-        char line0[20], line1[20], line2[20], line3[20];
-        snprintf(line0, sizeof(line0), "Temp: %.1f C", sensor.temp_c);
-        snprintf(line1, sizeof(line1), "Press: %.1f kPa", pressure_kpa);
-        snprintf(line2, sizeof(line2), "Hum: %.1f%%", sensor.humidity);
-        snprintf(line3, sizeof(line3), "GasR: %.1f kOhms", gas_res_kohm);
-        ssd1306_clear_screen(&screen, false);
-
-        // Display Text
-        ssd1306_display_text(&screen, 0, line0, strlen(line0), false);
-        ssd1306_display_text(&screen, 1, line1, strlen(line1), false);
-        ssd1306_display_text(&screen, 2, line2, strlen(line2), false);
-        ssd1306_display_text(&screen, 3, line3, strlen(line3), false);
-
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Wait 10 seconds before next measurement
-        
+
+        uint8_t due = SAMPLER_Due(&sampler, now_ms());
+        if (due == 0) {
+            // Round up: a wait shorter than a tick must not become vTaskDelay(0)
+            uint32_t wait_ms = SAMPLER_MsUntilNext(&sampler, now_ms());
+            TickType_t wait_ticks = (wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+            vTaskDelay(wait_ticks > 0 ? wait_ticks : 1);
+            continue;
+        }
+
+        // Sensor faulted: retry recovery on the backoff schedule, skip this slot
+        if (sensor_faulted) {
+            if (!sensor_recover(&sensor, &backoff)) {
+                SAMPLER_Complete(&sampler, due, now_ms());
+                continue;
+            }
+            sensor_faulted = false;
+            fault_count = 0;
+        }
+
+        // Force sensor to take new measurement (heater only on gas cycles)
+        SAMPLER_Record rec;
+        uint32_t budget_ms = SAMPLE_BUDGET_MS;
+        if (due & SAMPLER_CH_GAS) {
+            HEATER_TunerApply(&tuner, &sensor, WARMUP_HeaterTemp(&warmup));
+            budget_ms += sensor.heat_wait_ms;
+        }
+        BME688_SetDeadline(&sensor, budget_ms);
+        status = SAMPLER_Acquire(&sensor, due, now_ms(), &rec);
+        BME688_ClearDeadline(&sensor);
+        if (status == ESP_OK && (due & SAMPLER_CH_GAS)) HEATER_TunerUpdate(&tuner, &sensor);
+        SAMPLER_Complete(&sampler, due, now_ms());
+        if (status != ESP_OK) {
+            printf("Measurement failed: %s\n", esp_err_to_name(status));
+            if (++fault_count >= SENSOR_FAULT_LIMIT) {
+                sensor_faulted = !sensor_recover(&sensor, &backoff);
+                if (!sensor_faulted) fault_count = 0;
+            }
+            continue;
+        }
+        fault_count = 0;
+
+        // Warm-up: drop pre-conditioning readings, follow the phase's gas period
+        if (due & SAMPLER_CH_GAS) {
+            WARMUP_Phase phase = warmup.phase;
+            uint32_t gas_res = (rec.channels & SAMPLER_CH_GAS) ? rec.gas_res_ohm : 0;
+            if (!WARMUP_Update(&warmup, gas_res, rec.timestamp_ms)) {
+                rec.channels &= ~SAMPLER_CH_GAS;
+            }
+            if (warmup.phase != phase) {
+                SAMPLER_SetPeriod(&sampler, SAMPLER_CH_GAS, WARMUP_GasPeriod(&warmup), now_ms());
+                if (warmup.stable) {
+                    printf("Gas sensor stable after %lld s%s\n", (long long)(warmup.time_to_stable_ms / 1000),
+                           warmup.settle_timeout ? " (settle time limit, still drifting)" : "");
+                }
+            }
+        }
+        if (warmup.stable) rec.flags |= SAMPLER_FLAG_GAS_STABLE;
+        if (warmup.settle_timeout) rec.flags |= SAMPLER_FLAG_GAS_SETTLE_TIMEOUT;
+
+        // timestamp,channels,temp,pressure,humidity,gas,gas_stable (gas empty on TPH-only records)
+        if (rec.channels & SAMPLER_CH_GAS) {
+            printf(
+            "%lld,%u,%.2f,%.2f,%.2f,%lu,%u\n",
+                (long long)rec.timestamp_ms,
+                rec.channels,
+                rec.temp_c,
+                rec.pressure_pa,
+                rec.humidity,
+                (unsigned long)rec.gas_res_ohm,
+                (rec.flags & SAMPLER_FLAG_GAS_STABLE) ? 1 : 0
+            );
+        } else {
+            printf(
+            "%lld,%u,%.2f,%.2f,%.2f,,%u\n",
+                (long long)rec.timestamp_ms,
+                rec.channels,
+                rec.temp_c,
+                rec.pressure_pa,
+                rec.humidity,
+                (rec.flags & SAMPLER_FLAG_GAS_STABLE) ? 1 : 0
+            );
+        }
+
+        // Gas line keeps showing the most recent valid gas reading
+        if (rec.channels & SAMPLER_CH_GAS) {
+            gas_kohm = warmup.stable ? rec.gas_res_ohm / 1000.0f : NAN;
+        }
+
+        // Widgets redraw only the characters that changed
+        ssd1306_widgets_update(&screen, status_widgets, STATUS_WIDGETS);
+        ssd1306_chart_push(&temp_chart, rec.temp_c);
+        ssd1306_chart_push(&hum_chart, rec.humidity);
+        ssd1306_present(&screen);
+        if (OLED_MIRROR) ssd1306_mirror_update(&mirror);
         }
 }
@@ -0,0 +1,117 @@
+#include "sampler.h"
+#include "esp_err.h"
+#include <string.h>
+
+// ------ Scheduler ------
+void SAMPLER_Init(SAMPLER *sched, uint32_t tph_period_ms, uint32_t gas_period_ms, int64_t now_ms) {
+    memset(sched, 0, sizeof(*sched));
+
+    sched->channel[0].mask          = SAMPLER_CH_TPH;
+    sched->channel[0].period_ms     = tph_period_ms;
+    sched->channel[0].next_due_ms   = now_ms;
+
+    sched->channel[1].mask          = SAMPLER_CH_GAS;
+    sched->channel[1].period_ms     = gas_period_ms;
+    sched->channel[1].next_due_ms   = now_ms;           // Take a gas reading on the first cycle
+}
+
+// Returns the SAMPLER_CH_* bits that are due at now_ms
+uint8_t SAMPLER_Due(const SAMPLER *sched, int64_t now_ms) {
+    uint8_t due = 0;
+    for (int i = 0; i < SAMPLER_NUM_CHANNELS; i++) {
+        const SAMPLER_Channel *ch = &sched->channel[i];
+        if (ch->period_ms == 0) continue;
+        if (now_ms >= ch->next_due_ms) due |= ch->mask;
+    }
+    return due;
+}
+
+// Advance every channel contained in the completed record
+void SAMPLER_Complete(SAMPLER *sched, uint8_t channels, int64_t now_ms) {
+    for (int i = 0; i < SAMPLER_NUM_CHANNELS; i++) {
+        SAMPLER_Channel *ch = &sched->channel[i];
+        if (ch->period_ms == 0 || !(channels & ch->mask)) continue;
+
+        ch->next_due_ms += ch->period_ms;               // Fixed rate, no drift
+        if (ch->next_due_ms <= now_ms) {
+            ch->next_due_ms = now_ms + ch->period_ms;   // Fell behind, skip missed slots
+        }
+    }
+}
+
+// Time until the earliest channel becomes due (0 if something is due already)
+uint32_t SAMPLER_MsUntilNext(const SAMPLER *sched, int64_t now_ms) {
+    int64_t wait_ms = INT64_MAX;
+    for (int i = 0; i < SAMPLER_NUM_CHANNELS; i++) {
+        const SAMPLER_Channel *ch = &sched->channel[i];
+        if (ch->period_ms == 0) continue;
+
+        int64_t remaining = ch->next_due_ms - now_ms;
+        if (remaining < wait_ms) wait_ms = remaining;
+    }
+    if (wait_ms < 0) return 0;
+    if (wait_ms > UINT32_MAX) return UINT32_MAX;
+    return (uint32_t)wait_ms;
+}
+
+// Change a channel's period; the new period counts from now
+void SAMPLER_SetPeriod(SAMPLER *sched, uint8_t channel, uint32_t period_ms, int64_t now_ms) {
+    for (int i = 0; i < SAMPLER_NUM_CHANNELS; i++) {
+        SAMPLER_Channel *ch = &sched->channel[i];
+        if (ch->mask != channel || ch->period_ms == period_ms) continue;
+
+        ch->period_ms = period_ms;
+        ch->next_due_ms = now_ms + period_ms;
+    }
+}
+
+// ------ Run one forced measurement for the requested channels ------
+// run_gas is only set on cycles that need a gas reading, so TPH-only
+// cycles skip the heater entirely.
+esp_err_t SAMPLER_Acquire(BME688 *dev, uint8_t channels, int64_t now_ms, SAMPLER_Record *rec) {
+    esp_err_t status;
+    bool want_gas = (channels & SAMPLER_CH_GAS) != 0;
+
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp_ms = now_ms;
+
+    // Program heater (uses last ambient temperature) or switch it off
+    if (want_gas) {
+        status = BME688_WriteGas(dev);
+    } else {
+        status = BME688_SetGasEnabled(dev, false);
+    }
+    if (status != ESP_OK) return status;
+
+    status = BME688_ForceMeasurement(dev);
+    if (status != ESP_OK) return status;
+
+    status = BME688_WaitForMeasurement(dev, SAMPLER_MEAS_TIMEOUT_MS);
+    if (status != ESP_OK) return status;
+
+    // Temperature first: t_fine feeds pressure/humidity compensation
+    status = BME688_ReadTemperature(dev);
+    if (status != ESP_OK) return status;
+    status = BME688_ReadPressure(dev);
+    if (status != ESP_OK) return status;
+    status = BME688_ReadHumidity(dev);
+    if (status != ESP_OK) return status;
+
+    rec->channels   |= SAMPLER_CH_TPH;
+    rec->temp_c      = dev->temp_c;
+    rec->pressure_pa = dev->pressure_pa;
+    rec->humidity    = dev->humidity;
+
+    if (want_gas) {
+        status = BME688_ReadGas(dev);
+        if (status != ESP_OK) return status;
+
+        // Only stamp gas when the heater actually reached its target
+        if (dev->gas_valid && dev->heat_stab) {
+            rec->channels   |= SAMPLER_CH_GAS;
+            rec->gas_res_ohm = dev->gas_res_ohm;
+        }
+    }
+
+    return ESP_OK;
+}
@@ -1,12 +1,18 @@
 #include <string.h>
+#include <stdlib.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "ssd1306.h"
-#include "font8x8_basic.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_effects.h"
+
+#define TAG "SSD1306"
 
 #define PACK8 __attribute__((aligned( __alignof__( uint8_t ) ), packed ))
 
@@ -17,6 +23,8 @@ typedef union out_column_t {
 
 void ssd1306_init(SSD1306_t * dev, int width, int height)
 {
+	dev->_double = false;
+	dev->_ramBase = 0;
 	if (dev->_address == SPI_ADDRESS) {
 		spi_init(dev, width, height);
 	} else {
@@ -26,6 +34,477 @@ void ssd1306_init(SSD1306_t * dev, int width, int height)
 	for (int i=0;i<dev->_pages;i++) {
 		memset(dev->_page[i]._segs, 0, 128);
 	}
+	dev->_contrast = 0xFF; // Set by i2c_init/spi_init
+	// GDDRAM content is unknown after power-up
+	ssd1306_invalidate(dev);
+}
+
+// Panel I/O from the caller and the flush task must not interleave
+static void ssd1306_io_lock(SSD1306_t * dev)
+{
+	if (dev->_async) xSemaphoreTake(dev->_async->_ioLock, portMAX_DELAY);
+}
+
+static void ssd1306_io_unlock(SSD1306_t * dev)
+{
+	if (dev->_async) xSemaphoreGive(dev->_async->_ioLock);
+}
+
+// A span that did not reach the panel goes out again with the next flush
+// (with a flush task: the next frame it drains)
+static void ssd1306_retry(SSD1306_t * dev, int page, int seg, int width)
+{
+	SSD1306_Async_t * a = dev->_async;
+	if (a == NULL) {
+		ssd1306_mark_dirty(dev, page, seg, width);
+		return;
+	}
+	// The front page is the one that failed or a newer one
+	int end = seg + width - 1;
+	xSemaphoreTake(a->_lock, portMAX_DELAY);
+	if (a->_start[page] < 0) {
+		a->_start[page] = seg;
+		a->_end[page] = end;
+	} else {
+		if (seg < a->_start[page]) a->_start[page] = seg;
+		if (end > a->_end[page]) a->_end[page] = end;
+	}
+	xSemaphoreGive(a->_lock);
+}
+
+// Send one span to the panel and record it in the shadow. A span that could
+// not be sent stays out of the shadow and is sent again.
+static void ssd1306_write(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+{
+	bool sent;
+	if (dev->_address == SPI_ADDRESS) {
+		sent = spi_display_image(dev, page, seg, images, width);
+	} else {
+		sent = i2c_display_image(dev, page, seg, images, width);
+	}
+	if (sent) {
+		memcpy(&dev->_page[page]._shadow[seg], images, width);
+	} else {
+		ssd1306_retry(dev, page, seg, width);
+	}
+}
+
+// Send the bytes of src[start..end] that differ from the shadow.
+// Changed runs closer than SSD1306_FLUSH_MERGE_GAP are sent as one window.
+static void ssd1306_flush_page(SSD1306_t * dev, int page, const uint8_t * src, int start, int end)
+{
+	const uint8_t * shadow = dev->_page[page]._shadow;
+	if (start < 0) start = 0;
+	if (end >= dev->_width) end = dev->_width - 1;
+
+	int seg = start;
+	while (seg <= end) {
+		while (seg <= end && src[seg] == shadow[seg]) seg++;
+		if (seg > end) break;
+
+		int run_end = seg;
+		for (int i = seg + 1; i <= end; i++) {
+			if (src[i] != shadow[i]) {
+				run_end = i;
+			} else if (i - run_end > SSD1306_FLUSH_MERGE_GAP) {
+				break;
+			}
+		}
+		ssd1306_write(dev, page, seg, &src[seg], run_end - seg + 1);
+		seg = run_end + 1;
+	}
+}
+
+static void ssd1306_send_start_line(SSD1306_t * dev, int line)
+{
+	if (dev->_address == SPI_ADDRESS) {
+		spi_start_line(dev, line);
+	} else {
+		i2c_start_line(dev, line);
+	}
+}
+
+static void ssd1306_send_contrast(SSD1306_t * dev, int contrast)
+{
+	if (dev->_address == SPI_ADDRESS) {
+		spi_contrast(dev, contrast);
+	} else {
+		i2c_contrast(dev, contrast);
+	}
+}
+
+// Shift pages [start, end] of GDDRAM and the shadow one column left. Whatever
+// scrolls into the last column is unknown, so the shadow there is set to the
+// complement of next[page], the byte about to be drawn, to force it out.
+static void ssd1306_send_content_scroll(SSD1306_t * dev, int start, int end, const uint8_t next[])
+{
+	// A command sent while the previous one is still moving columns gets lost
+	if (dev->_scrollUs != 0) {
+		int64_t wait_us = dev->_scrollUs + SSD1306_CONTENT_SCROLL_GAP_US - esp_timer_get_time();
+		if (wait_us > 0) {
+			TickType_t ticks = (wait_us + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000);
+			vTaskDelay(ticks > 0 ? ticks : 1);
+		}
+	}
+
+	// Scroll commands act on SEG outputs, so segment remap (flip) reverses
+	// their direction in column terms; flipped pages are also stored in
+	// reverse order.
+	int _start = start;
+	int _end = end;
+	if (dev->_flip) {
+		_start = (dev->_pages - end) - 1;
+		_end = (dev->_pages - start) - 1;
+	}
+	if (dev->_address == SPI_ADDRESS) {
+		spi_content_scroll(dev, _start, _end, !dev->_flip);
+	} else {
+		i2c_content_scroll(dev, _start, _end, !dev->_flip);
+	}
+	dev->_scrollUs = esp_timer_get_time();
+
+	int last = dev->_width - 1;
+	for (int page=start; page<=end; page++) {
+		PAGE_t * p = &dev->_page[page];
+		memmove(&p->_shadow[0], &p->_shadow[1], last);
+		p->_shadow[last] = ~next[page];
+	}
+}
+
+// Double buffering: show the GDDRAM half just written and make the other one
+// the target. _page[p]._shadow always mirrors the hidden half and
+// _page[p + _pages]._shadow (unused pages on a 128x32 panel) the visible one.
+static void ssd1306_swap_halves(SSD1306_t * dev)
+{
+	ssd1306_send_start_line(dev, dev->_ramBase * 8);
+	dev->_ramBase = dev->_ramBase ? 0 : dev->_pages;
+	uint8_t wk[128];
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(wk, dev->_page[page]._shadow, 128);
+		memcpy(dev->_page[page]._shadow, dev->_page[page + dev->_pages]._shadow, 128);
+		memcpy(dev->_page[page + dev->_pages]._shadow, wk, 128);
+	}
+}
+
+// Push every page of src and make it the shadow (not if the transfer failed)
+static void ssd1306_send_frame(SSD1306_t * dev, const uint8_t * const src[])
+{
+	bool sent;
+	if (dev->_address == SPI_ADDRESS) {
+		sent = spi_display_frame(dev, src);
+	} else {
+		sent = i2c_display_frame(dev, src);
+	}
+	if (!sent) {
+		for (int page=0; page<dev->_pages;page++) {
+			ssd1306_retry(dev, page, 0, dev->_width);
+		}
+		return;
+	}
+	for (int page=0; page<dev->_pages;page++) {
+		if (src[page] != dev->_page[page]._shadow) {
+			memcpy(dev->_page[page]._shadow, src[page], 128);
+		}
+	}
+	if (dev->_double) ssd1306_swap_halves(dev);
+}
+
+// Send the changed bytes of src within each page's [start, end] (start < 0: clean page)
+static void ssd1306_send_pages(SSD1306_t * dev, const uint8_t * src[], const int start[], const int end[])
+{
+	// Double buffering: the hidden half is a frame behind, so whole pages are
+	// compared, clean ones against what is on screen
+	int _start[8], _end[8];
+	if (dev->_double) {
+		bool changed = false;
+		for (int page=0; page<dev->_pages; page++) {
+			if (start[page] >= 0) changed = true;
+		}
+		if (!changed) return;
+		for (int page=0; page<dev->_pages; page++) {
+			if (start[page] < 0) src[page] = dev->_page[page + dev->_pages]._shadow;
+			_start[page] = 0;
+			_end[page] = dev->_width - 1;
+		}
+		start = _start;
+		end = _end;
+	}
+
+	// Mostly-changed screen: one frame transaction beats many small windows
+	if (dev->_address != SPI_ADDRESS) {
+		int changed = 0;
+		for (int page=0; page<dev->_pages; page++) {
+			if (start[page] < 0) continue;
+			for (int seg=start[page]; seg<=end[page]; seg++) {
+				if (src[page][seg] != dev->_page[page]._shadow[seg]) changed++;
+			}
+		}
+		if (changed > SSD1306_FRAME_FLUSH_THRESHOLD) {
+			// Clean pages already show the shadow
+			for (int page=0; page<dev->_pages; page++) {
+				if (start[page] < 0) src[page] = dev->_page[page]._shadow;
+			}
+			ssd1306_send_frame(dev, src);
+			return;
+		}
+	}
+
+	for (int page=0; page<dev->_pages; page++) {
+		if (start[page] < 0) continue;
+		ssd1306_flush_page(dev, page, src[page], start[page], end[page]);
+	}
+	if (dev->_double) ssd1306_swap_halves(dev);
+}
+
+// Record that [seg, seg+width) of a page changed in the internal buffer
+void ssd1306_mark_dirty(SSD1306_t * dev, int page, int seg, int width)
+{
+	if (page < 0 || page >= dev->_pages || width <= 0) return;
+	int end = seg + width - 1;
+	if (seg < 0) seg = 0;
+	if (end >= dev->_width) end = dev->_width - 1;
+	if (seg > end) return;
+
+	PAGE_t * p = &dev->_page[page];
+	if (!p->_valid) {
+		p->_valid = true;
+		p->_dirtyStart = seg;
+		p->_dirtyEnd = end;
+	} else {
+		if (seg < p->_dirtyStart) p->_dirtyStart = seg;
+		if (end > p->_dirtyEnd) p->_dirtyEnd = end;
+	}
+}
+
+// Forget what the panel shows (e.g. after hardware scrolling moved GDDRAM).
+// The next flush rewrites every byte.
+void ssd1306_invalidate(SSD1306_t * dev)
+{
+	ssd1306_io_lock(dev);
+	for (int page=0; page<dev->_pages; page++) {
+		for (int seg=0; seg<128; seg++) {
+			dev->_page[page]._shadow[seg] = ~dev->_page[page]._segs[seg];
+			if (dev->_double) dev->_page[page + dev->_pages]._shadow[seg] = ~dev->_page[page]._segs[seg];
+		}
+	}
+	ssd1306_io_unlock(dev);
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
+	}
+}
+
+// Push only the bytes that changed since the last flush.
+// With a flush task running this is the same as ssd1306_present.
+void ssd1306_flush(SSD1306_t * dev)
+{
+	if (dev->_async) {
+		ssd1306_present(dev);
+		return;
+	}
+
+	const uint8_t * src[8];
+	int start[8], end[8];
+	for (int page=0; page<dev->_pages; page++) {
+		PAGE_t * p = &dev->_page[page];
+		src[page] = p->_segs;
+		start[page] = p->_valid ? p->_dirtyStart : -1;
+		end[page] = p->_dirtyEnd;
+		p->_valid = false;
+	}
+	ssd1306_send_pages(dev, src, start, end);
+}
+
+// A span of _segs has been composed: send it now, or only mark it dirty while
+// batching or when a flush task owns the panel.
+static void ssd1306_commit(SSD1306_t * dev, int page, int seg, int width)
+{
+	if (dev->_async || dev->_batch > 0 || dev->_double) {
+		ssd1306_mark_dirty(dev, page, seg, width);
+		return;
+	}
+	// Send only what the panel does not already show
+	ssd1306_flush_page(dev, page, dev->_page[page]._segs, seg, seg + width - 1);
+}
+
+// Collect drawing calls until the matching ssd1306_batch_end, which flushes
+// everything they changed at once. Batches may nest.
+void ssd1306_batch_begin(SSD1306_t * dev)
+{
+	dev->_batch++;
+}
+
+void ssd1306_batch_end(SSD1306_t * dev)
+{
+	if (dev->_batch == 0) return;
+	if (--dev->_batch == 0) ssd1306_flush(dev);
+}
+
+// 128x32 panels only: their 4 pages fill half of GDDRAM. Each flush writes
+// the half that is not on screen, then shows it with one start line command,
+// so a frame appears all at once and never half drawn. Drawing calls only mark
+// what they change; nothing reaches the panel before ssd1306_flush or
+// ssd1306_present. Hardware and content scroll commands and the console, which
+// move the start line or GDDRAM themselves, must not be used meanwhile.
+esp_err_t ssd1306_double_buffer(SSD1306_t * dev, bool enable)
+{
+	if (enable == dev->_double) return ESP_OK;
+	if (enable && dev->_pages * 2 > SSD1306_GDDRAM_PAGES) return ESP_ERR_NOT_SUPPORTED;
+
+	ssd1306_io_lock(dev);
+	if (enable) {
+		// Half 0 is on screen; the hidden half holds anything
+		for (int page=0; page<dev->_pages; page++) {
+			memcpy(dev->_page[page + dev->_pages]._shadow, dev->_page[page]._shadow, 128);
+			for (int seg=0; seg<128; seg++) {
+				dev->_page[page]._shadow[seg] = ~dev->_page[page]._segs[seg];
+			}
+		}
+		dev->_ramBase = dev->_pages;
+		dev->_double = true;
+	} else {
+		dev->_double = false;
+		if (dev->_ramBase == 0) {
+			// Half 1 is on screen: copy it down so going back to half 0 shows no change
+			for (int page=0; page<dev->_pages; page++) {
+				ssd1306_write(dev, page, 0, dev->_page[page + dev->_pages]._shadow, dev->_width);
+			}
+		} else {
+			for (int page=0; page<dev->_pages; page++) {
+				memcpy(dev->_page[page]._shadow, dev->_page[page + dev->_pages]._shadow, 128);
+			}
+			dev->_ramBase = 0;
+		}
+		ssd1306_send_start_line(dev, 0);
+	}
+	ssd1306_io_unlock(dev);
+
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
+	}
+	return ESP_OK;
+}
+
+// One wake of the flush task: send what has been presented since the last one,
+// with queued contrast changes on the side of the pages they were queued on
+// and queued content scrolls ahead of them
+void _ssd1306_flush_drain(SSD1306_t * dev)
+{
+	SSD1306_Async_t * a = dev->_async;
+	const uint8_t * src[8];
+	int start[8], end[8];
+	uint8_t shift[8], next[8];
+
+	// Short critical section: take the presented pages, leave the front free
+	xSemaphoreTake(a->_lock, portMAX_DELAY);
+	for (int page=0; page<dev->_pages; page++) {
+		src[page] = a->_tx[page];
+		start[page] = a->_start[page];
+		end[page] = a->_end[page];
+		if (start[page] >= 0) memcpy(a->_tx[page], a->_front[page], 128);
+		a->_start[page] = -1;
+		shift[page] = a->_shift[page];
+		next[page] = a->_front[page][dev->_width - 1];
+		a->_shift[page] = 0;
+	}
+	int before = a->_contrastBefore;
+	int after = a->_contrastAfter;
+	a->_contrastBefore = -1;
+	a->_contrastAfter = -1;
+	xSemaphoreGive(a->_lock);
+
+	ssd1306_io_lock(dev);
+	if (before >= 0) ssd1306_send_contrast(dev, before);
+	// One command per run of pages, repeated while any page has scrolls left
+	bool scrolled = true;
+	while (scrolled) {
+		scrolled = false;
+		for (int page=0; page<dev->_pages; page++) {
+			if (shift[page] == 0) continue;
+			int run = page;
+			while (run + 1 < dev->_pages && shift[run + 1] > 0) run++;
+			ssd1306_send_content_scroll(dev, page, run, next);
+			for (int i=page; i<=run; i++) shift[i]--;
+			page = run;
+			scrolled = true;
+		}
+	}
+	ssd1306_send_pages(dev, src, start, end);
+	if (after >= 0) ssd1306_send_contrast(dev, after);
+	ssd1306_io_unlock(dev);
+}
+
+// Flush task: drains the front buffer whenever ssd1306_present hands over a frame
+static void ssd1306_flush_task(void * arg)
+{
+	SSD1306_t * dev = (SSD1306_t *)arg;
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		_ssd1306_flush_drain(dev);
+	}
+}
+
+// Move panel I/O to a task of its own. Drawing calls then only render into the
+// back buffer (_segs); ssd1306_present hands the result over without waiting.
+esp_err_t ssd1306_start_flush_task(SSD1306_t * dev, UBaseType_t priority)
+{
+	if (dev->_async) return ESP_OK;
+
+	SSD1306_Async_t * a = calloc(1, sizeof(SSD1306_Async_t));
+	if (a == NULL) return ESP_ERR_NO_MEM;
+	a->_lock = xSemaphoreCreateMutex();
+	a->_ioLock = xSemaphoreCreateMutex();
+	if (a->_lock == NULL || a->_ioLock == NULL) goto fail;
+	for (int page=0; page<8; page++) {
+		a->_start[page] = -1;
+	}
+	a->_contrastBefore = -1;
+	a->_contrastAfter = -1;
+
+	dev->_async = a;
+	if (xTaskCreate(ssd1306_flush_task, "ssd1306_flush", SSD1306_FLUSH_TASK_STACK, dev, priority, &a->_task) != pdPASS) {
+		dev->_async = NULL;
+		goto fail;
+	}
+	ESP_LOGI(TAG, "Flush task started");
+	return ESP_OK;
+
+fail:
+	if (a->_lock) vSemaphoreDelete(a->_lock);
+	if (a->_ioLock) vSemaphoreDelete(a->_ioLock);
+	free(a);
+	return ESP_ERR_NO_MEM;
+}
+
+// Publish the back buffer. Without a flush task this flushes in place;
+// with one it copies the dirty pages to the front buffer and returns.
+void ssd1306_present(SSD1306_t * dev)
+{
+	SSD1306_Async_t * a = dev->_async;
+	if (a == NULL) {
+		ssd1306_flush(dev);
+		return;
+	}
+
+	bool changed = false;
+	xSemaphoreTake(a->_lock, portMAX_DELAY);
+	for (int page=0; page<dev->_pages; page++) {
+		PAGE_t * p = &dev->_page[page];
+		if (!p->_valid) continue;
+		memcpy(a->_front[page], p->_segs, 128);
+		// Pages not yet drained keep their older range too
+		if (a->_start[page] < 0) {
+			a->_start[page] = p->_dirtyStart;
+			a->_end[page] = p->_dirtyEnd;
+		} else {
+			if (p->_dirtyStart < a->_start[page]) a->_start[page] = p->_dirtyStart;
+			if (p->_dirtyEnd > a->_end[page]) a->_end[page] = p->_dirtyEnd;
+		}
+		p->_valid = false;
+		changed = true;
+	}
+	xSemaphoreGive(a->_lock);
+
+	if (changed) xTaskNotifyGive(a->_task);
 }
 
 int ssd1306_get_width(SSD1306_t * dev)
@@ -45,15 +524,59 @@ int ssd1306_get_pages(SSD1306_t * dev)
 
 void ssd1306_show_buffer(SSD1306_t * dev)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		for (int page=0; page<dev->_pages;page++) {
-			spi_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
-		}
-	} else {
+	ssd1306_display_frame(dev);
+}
+
+// Push the whole internal buffer. On I2C this is a single transaction in
+// horizontal addressing mode instead of a command + data pair per page.
+void ssd1306_display_frame(SSD1306_t * dev)
+{
+	if (dev->_async) {
 		for (int page=0; page<dev->_pages;page++) {
-			i2c_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
+			ssd1306_mark_dirty(dev, page, 0, dev->_width);
 		}
+		ssd1306_present(dev);
+		return;
 	}
+
+	const uint8_t * src[8];
+	for (int page=0; page<dev->_pages;page++) {
+		src[page] = dev->_page[page]._segs;
+		dev->_page[page]._valid = false;
+	}
+	ssd1306_send_frame(dev, src);
+}
+
+// Full-frame flushes per second at the panel's current bus speed.
+// Always transmits from the caller, even with a flush task running.
+float ssd1306_measure_fps(SSD1306_t * dev, int frames)
+{
+	if (frames <= 0) return 0.0f;
+	const uint8_t * src[8];
+	for (int page=0; page<dev->_pages;page++) {
+		src[page] = dev->_page[page]._segs;
+	}
+
+	ssd1306_io_lock(dev);
+	int64_t start = esp_timer_get_time();
+	for (int i=0; i<frames; i++) {
+		ssd1306_send_frame(dev, src);
+	}
+	int64_t elapsed_us = esp_timer_get_time() - start;
+	ssd1306_io_unlock(dev);
+
+	if (elapsed_us <= 0) return 0.0f;
+	return frames * 1000000.0f / elapsed_us;
+}
+
+// Send a full frame from caller-owned pages (grayscale bitplanes, for
+// instance) in one transaction. The frame buffer is left alone; the shadow
+// follows what the panel now shows.
+void ssd1306_display_pages(SSD1306_t * dev, const uint8_t * const pages[])
+{
+	ssd1306_io_lock(dev);
+	ssd1306_send_frame(dev, pages);
+	ssd1306_io_unlock(dev);
 }
 
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer)
@@ -61,6 +584,7 @@ void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer)
 	int index = 0;
 	for (int page=0; page<dev->_pages;page++) {
 		memcpy(&dev->_page[page]._segs, &buffer[index], 128);
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
 		index = index + 128;
 	}
 }
@@ -77,6 +601,7 @@ void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer)
 void ssd1306_set_page(SSD1306_t * dev, int page, const uint8_t * buffer)
 {
 	memcpy(&dev->_page[page]._segs, buffer, 128);
+	ssd1306_mark_dirty(dev, page, 0, dev->_width);
 }
 
 void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer)
@@ -86,13 +611,13 @@ void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer)
 
 void ssd1306_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_display_image(dev, page, seg, images, width);
-	} else {
-		i2c_display_image(dev, page, seg, images, width);
-	}
+	if (page >= dev->_pages) return;
+	if (seg >= dev->_width) return;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+
 	// Set to internal buffer
-	memcpy(&dev->_page[page]._segs[seg], images, width);
+	memmove(&dev->_page[page]._segs[seg], images, width);
+	ssd1306_commit(dev, page, seg, width);
 }
 
 void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert)
@@ -101,15 +626,14 @@ void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text
 	int _text_len = text_len;
 	if (_text_len > 16) _text_len = 16;
 
+	// Compose the whole line, then send it as one span
+	uint8_t * segs = dev->_page[page]._segs;
 	int seg = 0;
-	uint8_t image[8];
 	for (int i = 0; i < _text_len; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, seg, image, 8);
+		ssd1306_blit_glyph(&segs[seg], ssd1306_glyph((uint8_t)text[i], dev->_flip), invert);
 		seg = seg + 8;
 	}
+	if (seg) ssd1306_commit(dev, page, 0, seg);
 }
 
 void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay)
@@ -121,19 +645,16 @@ void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char *
 	int _seg = seg;
 	uint8_t image[8];
 	for (int i = 0; i < box_width; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, _seg, image, 8);
+		ssd1306_blit_glyph(&dev->_page[page]._segs[_seg], ssd1306_glyph((uint8_t)text[i], dev->_flip), invert);
 		_seg = _seg + 8;
 	}
+	ssd1306_commit(dev, page, seg, text_box_pixel);
+	ssd1306_present(dev);
 	vTaskDelay(delay);
 
 	// Horizontally scroll inside the box
 	for (int _text=box_width;_text<text_len;_text++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[_text]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		ssd1306_blit_glyph(image, ssd1306_glyph((uint8_t)text[_text], dev->_flip), invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -141,6 +662,7 @@ void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char *
 			}
 			dev->_page[page]._segs[seg+text_box_pixel-1] = image[_bit];
 			ssd1306_display_image(dev, page, seg, &dev->_page[page]._segs[seg], text_box_pixel);
+			ssd1306_present(dev);
 			vTaskDelay(delay);
 		}
 	}
@@ -158,19 +680,16 @@ void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char *
 	// Fill the text box with blanks
 	for (int i = 0; i < box_width; i++) {
 		//memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		memcpy(image, font8x8_basic_tr[0x20], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
-		ssd1306_display_image(dev, page, _seg, image, 8);
+		ssd1306_blit_glyph(&dev->_page[page]._segs[_seg], ssd1306_glyph(0x20, dev->_flip), invert);
 		_seg = _seg + 8;
 	}
+	ssd1306_commit(dev, page, seg, text_box_pixel);
+	ssd1306_present(dev);
 	vTaskDelay(delay);
 
 	// Horizontally scroll inside the box
 	for (int _text=0;_text<text_len;_text++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[_text]], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		ssd1306_blit_glyph(image, ssd1306_glyph((uint8_t)text[_text], dev->_flip), invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -178,15 +697,14 @@ void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char *
 			}
 			dev->_page[page]._segs[seg+text_box_pixel-1] = image[_bit];
 			ssd1306_display_image(dev, page, seg, &dev->_page[page]._segs[seg], text_box_pixel);
+			ssd1306_present(dev);
 			vTaskDelay(delay);
 		}
 	}
 
 	// Horizontally scroll inside the box
 	for (int _text=0;_text<box_width;_text++) {
-		memcpy(image, font8x8_basic_tr[0x20], 8);
-		if (invert) ssd1306_invert(image, 8);
-		if (dev->_flip) ssd1306_flip(image, 8);
+		ssd1306_blit_glyph(image, ssd1306_glyph(0x20, dev->_flip), invert);
 		for (int _bit=0;_bit<8;_bit++) {
 			for (int _pixel=0;_pixel<text_box_pixel;_pixel++) {
 				//ESP_LOGI(__FUNCTION__, "_text=%d _bit=%d _pixel=%d", _text, _bit, _pixel);
@@ -194,6 +712,7 @@ void ssd1306_display_text_box2(SSD1306_t * dev, int page, int seg, const char *
 			}
 			dev->_page[page]._segs[seg+text_box_pixel-1] = image[_bit];
 			ssd1306_display_image(dev, page, seg, &dev->_page[page]._segs[seg], text_box_pixel);
+			ssd1306_present(dev);
 			vTaskDelay(delay);
 		}
 	}
@@ -211,7 +730,7 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_l
 
 	for (int nn = 0; nn < _text_len; nn++) {
 
-		uint8_t const * const in_columns = font8x8_basic_tr[(uint8_t)text[nn]];
+		uint8_t const * const in_columns = ssd1306_glyph((uint8_t)text[nn], false);
 
 		// make the character 3x as high
 		out_column_t out_columns[8];
@@ -233,8 +752,9 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_l
 
 		// render character in 8 column high pieces, making them 3x as wide
 		for (int yy = 0; yy < 3; yy++)	{ // for each group of 8 pixels high (y-direction)
+			if (page+yy >= dev->_pages) break;
 
-			uint8_t image[24];
+			uint8_t * image = &dev->_page[page+yy]._segs[seg];
 			for (int xx = 0; xx < 8; xx++) { // for each column (x-direction)
 				image[xx*3+0] = 
 				image[xx*3+1] = 
@@ -242,24 +762,25 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_l
 			}
 			if (invert) ssd1306_invert(image, 24);
 			if (dev->_flip) ssd1306_flip(image, 24);
-			if (dev->_address == SPI_ADDRESS) {
-				spi_display_image(dev, page+yy, seg, image, 24);
-			} else {
-				i2c_display_image(dev, page+yy, seg, image, 24);
-			}
-			memcpy(&dev->_page[page+yy]._segs[seg], image, 24);
 		}
 		seg = seg + 24;
 	}
+
+	// One span per page row of the composed text
+	for (int yy = 0; yy < 3 && page+yy < dev->_pages; yy++) {
+		if (seg) ssd1306_commit(dev, page+yy, 0, seg);
+	}
 }
 
 void ssd1306_clear_screen(SSD1306_t * dev, bool invert)
 {
 	char space[16];
 	memset(space, 0x00, sizeof(space));
+	ssd1306_batch_begin(dev);
 	for (int page = 0; page < dev->_pages; page++) {
 		ssd1306_display_text(dev, page, space, sizeof(space), invert);
 	}
+	ssd1306_batch_end(dev);
 }
 
 void ssd1306_clear_line(SSD1306_t * dev, int page, bool invert)
@@ -269,13 +790,32 @@ void ssd1306_clear_line(SSD1306_t * dev, int page, bool invert)
 	ssd1306_display_text(dev, page, space, sizeof(space), invert);
 }
 
+// With a flush task the change is queued like a frame: frames presented
+// before it are sent first, so a fade never shows a stale frame at the new
+// contrast.
 void ssd1306_contrast(SSD1306_t * dev, int contrast)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_contrast(dev, contrast);
-	} else {
-		i2c_contrast(dev, contrast);
+	dev->_contrast = contrast < 0 ? 0 : (contrast > 0xFF ? 0xFF : contrast);
+	SSD1306_Async_t * a = dev->_async;
+	if (a) {
+		xSemaphoreTake(a->_lock, portMAX_DELAY);
+		bool queued = false;
+		for (int page=0; page<dev->_pages; page++) {
+			if (a->_start[page] >= 0) queued = true;
+		}
+		if (queued) {
+			a->_contrastAfter = dev->_contrast;
+		} else {
+			a->_contrastBefore = dev->_contrast;
+		}
+		xSemaphoreGive(a->_lock);
+		xTaskNotifyGive(a->_task);
+		return;
 	}
+
+	ssd1306_io_lock(dev);
+	ssd1306_send_contrast(dev, dev->_contrast);
+	ssd1306_io_unlock(dev);
 }
 
 void ssd1306_software_scroll(SSD1306_t * dev, int start, int end)
@@ -300,13 +840,6 @@ void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool
 	ESP_LOGD(__FUNCTION__, "dev->_scEnable=%d", dev->_scEnable);
 	if (dev->_scEnable == false) return;
 
-	void (*func)(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
-	if (dev->_address == SPI_ADDRESS) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
 	int srcIndex = dev->_scEnd - dev->_scDirection;
 	while(1) {
 		int dstIndex = srcIndex + dev->_scDirection;
@@ -314,7 +847,7 @@ void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool
 		for(int seg = 0; seg < dev->_width; seg++) {
 			dev->_page[dstIndex]._segs[seg] = dev->_page[srcIndex]._segs[seg];
 		}
-		(*func)(dev, dstIndex, 0, dev->_page[dstIndex]._segs, sizeof(dev->_page[dstIndex]._segs));
+		ssd1306_display_image(dev, dstIndex, 0, dev->_page[dstIndex]._segs, dev->_width);
 		if (srcIndex == dev->_scStart) break;
 		srcIndex = srcIndex - dev->_scDirection;
 	}
@@ -343,11 +876,93 @@ void ssd1306_scroll_clear(SSD1306_t * dev)
 
 void ssd1306_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 {
+	ssd1306_io_lock(dev);
 	if (dev->_address == SPI_ADDRESS) {
 		spi_hardware_scroll(dev, scroll);
 	} else {
 		i2c_hardware_scroll(dev, scroll);
 	}
+	ssd1306_io_unlock(dev);
+	// Scrolling moves GDDRAM content behind our back
+	ssd1306_invalidate(dev);
+}
+
+// Move pages [start, end] one column toward column 0, on the panel with the
+// controller's one-column content scroll and in the buffer and shadow alike.
+// The last column is left blank and dirty for the caller to draw.
+void ssd1306_content_scroll_left(SSD1306_t * dev, int start, int end)
+{
+	if (start > end) { int t = start; start = end; end = t; }
+	if (start < 0) start = 0;
+	if (end >= dev->_pages) end = dev->_pages - 1;
+	if (start > end) return;
+	int last = dev->_width - 1;
+
+	for (int page=start; page<=end; page++) {
+		PAGE_t * p = &dev->_page[page];
+		memmove(&p->_segs[0], &p->_segs[1], last);
+		p->_segs[last] = 0;
+		if (p->_valid && p->_dirtyStart > 0) p->_dirtyStart--;
+		ssd1306_mark_dirty(dev, page, last, 1);
+	}
+
+	// Double buffered: the scroll command would move the visible half, so the
+	// shifted pages go out with the next flush instead
+	if (dev->_double) {
+		for (int page=start; page<=end; page++) {
+			ssd1306_mark_dirty(dev, page, 0, dev->_width);
+		}
+		return;
+	}
+
+	// Flush task: the command is queued for it like a frame. Frames presented
+	// before now still hold unscrolled pages; shifting them too lets the task
+	// send the scroll first and then whatever is presented.
+	SSD1306_Async_t * a = dev->_async;
+	if (a) {
+		xSemaphoreTake(a->_lock, portMAX_DELAY);
+		for (int page=start; page<=end; page++) {
+			memmove(&a->_front[page][0], &a->_front[page][1], last);
+			a->_front[page][last] = 0;
+			if (a->_start[page] >= 0) {
+				if (a->_start[page] > 0) a->_start[page]--;
+				a->_end[page] = last;
+			}
+			a->_shift[page]++;
+		}
+		xSemaphoreGive(a->_lock);
+		xTaskNotifyGive(a->_task);
+		return;
+	}
+
+	uint8_t next[8];
+	for (int page=start; page<=end; page++) {
+		next[page] = dev->_page[page]._segs[last];
+	}
+	ssd1306_io_lock(dev);
+	ssd1306_send_content_scroll(dev, start, end, next);
+	ssd1306_io_unlock(dev);
+}
+
+// Raw GDDRAM access for modules that manage panel memory themselves (the
+// console ring). Neither goes through the frame buffer or its shadow; call
+// ssd1306_invalidate before drawing through the buffer again.
+void ssd1306_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width)
+{
+	ssd1306_io_lock(dev);
+	if (dev->_address == SPI_ADDRESS) {
+		spi_display_ram(dev, ram_page, seg, images, width);
+	} else {
+		i2c_display_ram(dev, ram_page, seg, images, width);
+	}
+	ssd1306_io_unlock(dev);
+}
+
+void ssd1306_start_line(SSD1306_t * dev, int line)
+{
+	ssd1306_io_lock(dev);
+	ssd1306_send_start_line(dev, line);
+	ssd1306_io_unlock(dev);
 }
 
 // delay = 0 : display with no wait
@@ -401,8 +1016,8 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 			for (int seg=_start;seg<=_end;seg++) {
 				wk0 = dev->_page[page]._segs[seg];
 				wk1 = dev->_page[page+1]._segs[seg];
-				if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-				if (dev->_flip) wk1 = ssd1306_rotate_byte(wk1);
+				if (dev->_flip) wk0 = ssd1306_reverse8(wk0);
+				if (dev->_flip) wk1 = ssd1306_reverse8(wk1);
 				if (seg == 0) {
 					ESP_LOGD(__FUNCTION__, "b page=%d wk0=%02x wk1=%02x", page, wk0, wk1);
 				}
@@ -413,7 +1028,7 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 				if (seg == 0) {
 					ESP_LOGD(__FUNCTION__, "a page=%d wk0=%02x wk1=%02x wk2=%02x", page, wk0, wk1, wk2);
 				}
-				if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
+				if (dev->_flip) wk2 = ssd1306_reverse8(wk2);
 				dev->_page[page]._segs[seg] = wk2;
 			}
 		}
@@ -423,13 +1038,13 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 		for (int seg=_start;seg<=_end;seg++) {
 			wk0 = dev->_page[pages]._segs[seg];
 			wk1 = save[seg];
-			if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-			if (dev->_flip) wk1 = ssd1306_rotate_byte(wk1);
+			if (dev->_flip) wk0 = ssd1306_reverse8(wk0);
+			if (dev->_flip) wk1 = ssd1306_reverse8(wk1);
 			wk0 = wk0 >> 1;
 			wk1 = wk1 & 0x01;
 			wk1 = wk1 << 7;
 			wk2 = wk0 | wk1;
-			if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
+			if (dev->_flip) wk2 = ssd1306_reverse8(wk2);
 			dev->_page[pages]._segs[seg] = wk2;
 		}
 
@@ -452,8 +1067,8 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 			for (int seg=_start;seg<=_end;seg++) {
 				wk0 = dev->_page[page]._segs[seg];
 				wk1 = dev->_page[page-1]._segs[seg];
-				if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-				if (dev->_flip) wk1 = ssd1306_rotate_byte(wk1);
+				if (dev->_flip) wk0 = ssd1306_reverse8(wk0);
+				if (dev->_flip) wk1 = ssd1306_reverse8(wk1);
 				if (seg == 0) {
 					ESP_LOGD(__FUNCTION__, "b page=%d wk0=%02x wk1=%02x", page, wk0, wk1);
 				}
@@ -464,7 +1079,7 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 				if (seg == 0) {
 					ESP_LOGD(__FUNCTION__, "a page=%d wk0=%02x wk1=%02x wk2=%02x", page, wk0, wk1, wk2);
 				}
-				if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
+				if (dev->_flip) wk2 = ssd1306_reverse8(wk2);
 				dev->_page[page]._segs[seg] = wk2;
 			}
 		}
@@ -473,13 +1088,13 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 		for (int seg=_start;seg<=_end;seg++) {
 			wk0 = dev->_page[0]._segs[seg];
 			wk1 = save[seg];
-			if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-			if (dev->_flip) wk1 = ssd1306_rotate_byte(wk1);
+			if (dev->_flip) wk0 = ssd1306_reverse8(wk0);
+			if (dev->_flip) wk1 = ssd1306_reverse8(wk1);
 			wk0 = wk0 << 1;
 			wk1 = wk1 & 0x80;
 			wk1 = wk1 >> 7;
 			wk2 = wk0 | wk1;
-			if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
+			if (dev->_flip) wk2 = ssd1306_reverse8(wk2);
 			dev->_page[0]._segs[seg] = wk2;
 		}
 
@@ -520,96 +1135,41 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 
 	if (delay >= 0) {
 		for (int page=0;page<dev->_pages;page++) {
-			if (dev->_address == SPI_ADDRESS) {
-				spi_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			} else {
-				i2c_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			}
+			ssd1306_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
+			ssd1306_present(dev);
 			if (delay) vTaskDelay(delay);
 		}
+	} else {
+		for (int page=0;page<dev->_pages;page++) {
+			ssd1306_mark_dirty(dev, page, 0, dev->_width);
+		}
 	}
 
 }
 
+// Set bitmap to internal buffer. Not show it.
 void _ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert)
 {
-	if ( (width % 8) != 0) {
-		ESP_LOGE(__FUNCTION__, "width must be a multiple of 8");
-		return;
-	}
-	int _width = width / 8;
-	uint8_t wk0;
-	uint8_t wk1;
-	uint8_t wk2;
-	uint8_t page = (ypos / 8);
-	uint8_t _seg = xpos;
-	uint8_t dstBits = (ypos % 8);
-	ESP_LOGD(__FUNCTION__, "_width=%d ypos=%d page=%d dstBits=%d", _width, ypos, page, dstBits);
-	int offset = 0;
-	for(int _height=0;_height<height;_height++) {
-		for (int index=0;index<_width;index++) {
-			for (int srcBits=7; srcBits>=0; srcBits--) {
-				wk0 = dev->_page[page]._segs[_seg];
-				if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-
-				wk1 = bitmap[index+offset];
-				if (invert) wk1 = ~wk1;
-
-				//wk2 = ssd1306_copy_bit(bitmap[index+offset], srcBits, wk0, dstBits);
-				wk2 = ssd1306_copy_bit(wk1, srcBits, wk0, dstBits);
-				if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
-
-				ESP_LOGD(__FUNCTION__, "index=%d offset=%d wk1=0x%x page=%d _seg=%d, wk2=%02x", index, offset, wk1, page, _seg, wk2);
-				if (_seg >= 128) {
-					ESP_LOGW(__FUNCTION__, "segment is out of range");
-					break;
-				}
-				if (page >= dev->_pages) {
-					ESP_LOGW(__FUNCTION__, "page is out of range");
-					break;
-				}
-				dev->_page[page]._segs[_seg] = wk2;
-				_seg++;
-			}
-		}
-		//vTaskDelay(1);
-		offset = offset + _width;
-		dstBits++;
-		_seg = xpos;
-		if (dstBits == 8) {
-			page++;
-			dstBits=0;
-		}
-	}
-
-#if 0
-	for (int _seg=ypos;_seg<ypos+width;_seg++) {
-		ssd1306_dump_page(dev, page-1, _seg);
-	}
-	for (int _seg=ypos;_seg<ypos+width;_seg++) {
-		ssd1306_dump_page(dev, page, _seg);
-	}
-#endif
-	//ssd1306_show_buffer(dev);
+	ssd1306_blit(dev, xpos, ypos, bitmap, width, height, invert, BLIT_COPY);
 }
 
 
 void ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert)
 {
 	_ssd1306_bitmaps(dev, xpos, ypos, bitmap, width, height, invert);
-	
+
 	// Calculate the range of pages and segments to update
-	int start_page = ypos / 8;
+	int start_page = ypos < 0 ? 0 : ypos / 8;
 	int end_page = (ypos + height - 1) / 8;
-	int start_seg = xpos;
+	if (end_page >= dev->_pages) end_page = dev->_pages - 1;
+	int start_seg = xpos < 0 ? 0 : xpos;
 	int end_seg = xpos + width - 1;
+	if (end_seg >= dev->_width) end_seg = dev->_width - 1;
+	if (start_seg > end_seg) return;
 
 	// Update only the modified pages and segments
 	for (int page = start_page; page <= end_page; page++) {
-		int seg_start = (page == start_page) ? start_seg : 0;
-		int seg_end = (page == end_page) ? end_seg : 127;
-		int seg_width = seg_end - seg_start + 1;
-		ssd1306_display_image(dev, page, seg_start, &dev->_page[page]._segs[seg_start], seg_width);
+		ssd1306_commit(dev, page, start_seg, end_seg - start_seg + 1);
 	}
 }
 
@@ -617,23 +1177,97 @@ void ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap
 // Set pixel to internal buffer. Not show it.
 void _ssd1306_pixel(SSD1306_t * dev, int xpos, int ypos, bool invert)
 {
-	uint8_t _page = (ypos / 8);
-	uint8_t _bits = (ypos % 8);
-	uint8_t _seg = xpos;
-	uint8_t wk0 = dev->_page[_page]._segs[_seg];
+	if (xpos < 0 || xpos >= dev->_width) return;
+	if (ypos < 0 || ypos >= dev->_pages * 8) return;
+	int _page = (ypos / 8);
+	// Flipped pages store row 0 in bit 7
+	int _bits = dev->_flip ? 7 - (ypos % 8) : (ypos % 8);
 	uint8_t wk1 = 1 << _bits;
-	ESP_LOGD(__FUNCTION__, "ypos=%d _page=%d _bits=%d wk0=0x%02x wk1=0x%02x", ypos, _page, _bits, wk0, wk1);
 	if (invert) {
-		wk0 = wk0 & ~wk1;
+		dev->_page[_page]._segs[xpos] &= ~wk1;
 	} else {
-		wk0 = wk0 | wk1;
+		dev->_page[_page]._segs[xpos] |= wk1;
 	}
-	if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
-	ESP_LOGD(__FUNCTION__, "wk0=0x%02x wk1=0x%02x", wk0, wk1);
-	dev->_page[_page]._segs[_seg] = wk0;
+	ssd1306_mark_dirty(dev, _page, xpos, 1);
+}
+
+// Rows [y1, y2] of one page as a byte mask, in _segs bit order
+static uint8_t ssd1306_row_mask(SSD1306_t * dev, int page, int y1, int y2)
+{
+	int top = y1 - page * 8;
+	int bottom = y2 - page * 8;
+	if (top < 0) top = 0;
+	if (bottom > 7) bottom = 7;
+	uint8_t mask = (uint8_t)((0xFF << top) & (0xFF >> (7 - bottom)));
+	if (dev->_flip) mask = ssd1306_reverse8(mask);
+	return mask;
+}
+
+// Set or clear mask bits in columns [x1, x2] of one page
+static void ssd1306_apply_mask(SSD1306_t * dev, int page, int x1, int x2, uint8_t mask, bool invert)
+{
+	uint8_t * segs = dev->_page[page]._segs;
+	if (mask == 0xFF) {
+		memset(&segs[x1], invert ? 0x00 : 0xFF, x2 - x1 + 1);
+	} else if (invert) {
+		for (int x = x1; x <= x2; x++) segs[x] &= ~mask;
+	} else {
+		for (int x = x1; x <= x2; x++) segs[x] |= mask;
+	}
+	ssd1306_mark_dirty(dev, page, x1, x2 - x1 + 1);
+}
+
+// Set filled rectangle [x1, x2] x [y1, y2] to internal buffer. Not show it.
+// Works page by page: whole pages are memset, edge pages use a row mask.
+static void ssd1306_fill_span(SSD1306_t * dev, int x1, int y1, int x2, int y2, bool invert)
+{
+	if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+	if (y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (y2 >= dev->_pages * 8) y2 = dev->_pages * 8 - 1;
+	if (x1 > x2 || y1 > y2) return;
+
+	for (int page = y1 / 8; page <= y2 / 8; page++) {
+		ssd1306_apply_mask(dev, page, x1, x2, ssd1306_row_mask(dev, page, y1, y2), invert);
+	}
+}
+
+// Set horizontal line to internal buffer. Not show it.
+void _ssd1306_hline(SSD1306_t * dev, int x1, int x2, int y, bool invert)
+{
+	ssd1306_fill_span(dev, x1, y, x2, y, invert);
+}
+
+// Set vertical line to internal buffer. Not show it.
+void _ssd1306_vline(SSD1306_t * dev, int x, int y1, int y2, bool invert)
+{
+	ssd1306_fill_span(dev, x, y1, x, y2, invert);
+}
+
+// Set filled rectangle to internal buffer. Not show it.
+void _ssd1306_fill_rect(SSD1306_t * dev, int xpos, int ypos, int width, int height, bool invert)
+{
+	if (width <= 0 || height <= 0) return;
+	ssd1306_fill_span(dev, xpos, ypos, xpos + width - 1, ypos + height - 1, invert);
+}
+
+// Set rectangle outline to internal buffer. Not show it.
+void _ssd1306_rect(SSD1306_t * dev, int xpos, int ypos, int width, int height, bool invert)
+{
+	if (width <= 0 || height <= 0) return;
+	int x2 = xpos + width - 1;
+	int y2 = ypos + height - 1;
+	_ssd1306_hline(dev, xpos, x2, ypos, invert);
+	_ssd1306_hline(dev, xpos, x2, y2, invert);
+	_ssd1306_vline(dev, xpos, ypos, y2, invert);
+	_ssd1306_vline(dev, x2, ypos, y2, invert);
 }
 
 // Set line to internal buffer. Not show it.
+// Straight lines are single spans; otherwise each run of pixels that stays
+// on one row (shallow) or one column (steep) is drawn as a span.
 void _ssd1306_line(SSD1306_t * dev, int x1, int y1, int x2, int y2,  bool invert)
 {
 	int i;
@@ -641,6 +1275,15 @@ void _ssd1306_line(SSD1306_t * dev, int x1, int y1, int x2, int y2,  bool invert
 	int sx,sy;
 	int E;
 
+	if (y1 == y2) {
+		_ssd1306_hline(dev, x1, x2, y1, invert);
+		return;
+	}
+	if (x1 == x2) {
+		_ssd1306_vline(dev, x1, y1, y2, invert);
+		return;
+	}
+
 	/* distance between two points */
 	dx = ( x2 > x1 ) ? x2 - x1 : x1 - x2;
 	dy = ( y2 > y1 ) ? y2 - y1 : y1 - y2;
@@ -652,23 +1295,31 @@ void _ssd1306_line(SSD1306_t * dev, int x1, int y1, int x2, int y2,  bool invert
 	/* inclination < 1 */
 	if ( dx > dy ) {
 		E = -dx;
+		int run = x1;
 		for ( i = 0 ; i <= dx ; i++ ) {
-			_ssd1306_pixel(dev, x1, y1, invert);
-			x1 += sx;
 			E += 2 * dy;
+			if ( E >= 0 || i == dx ) {
+				_ssd1306_hline(dev, run, x1, y1, invert);
+				run = x1 + sx;
+			}
+			x1 += sx;
 			if ( E >= 0 ) {
-			y1 += sy;
-			E -= 2 * dx;
+				y1 += sy;
+				E -= 2 * dx;
+			}
 		}
-	}
 
 	/* inclination >= 1 */
 	} else {
 		E = -dy;
+		int run = y1;
 		for ( i = 0 ; i <= dy ; i++ ) {
-			_ssd1306_pixel(dev, x1, y1, invert);
-			y1 += sy;
 			E += 2 * dx;
+			if ( E >= 0 || i == dy ) {
+				_ssd1306_vline(dev, x1, run, y1, invert);
+				run = y1 + sy;
+			}
+			y1 += sy;
 			if ( E >= 0 ) {
 				x1 += sx;
 				E -= 2 * dy;
@@ -703,6 +1354,7 @@ void _ssd1306_circle(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, b
 }
 
 // Draw disc (fill circle)
+// One vertical span per column and quadrant; a span touches each page once.
 void _ssd1306_disc(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, bool invert)
 {
 	int x;
@@ -717,24 +1369,20 @@ void _ssd1306_disc(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, boo
 	ChangeX=1;
 	do{
 		if(ChangeX) {
-			//_ssd1306_line(dev, x0-x, y0-y, x0-x, y0+y, invert);
-			//_ssd1306_line(dev, x0+x, y0-y, x0+x, y0+y, invert);
 			if ((opt & OLED_DRAW_LOWER_LEFT) == OLED_DRAW_LOWER_LEFT)
-				_ssd1306_line(dev, x0-x, y0-y, x0-x, y0, invert);
+				_ssd1306_vline(dev, x0-x, y0-y, y0, invert);
 			if ((opt & OLED_DRAW_UPPER_LEFT) == OLED_DRAW_UPPER_LEFT)
-				_ssd1306_line(dev, x0-x, y0, x0-x, y0+y, invert);
+				_ssd1306_vline(dev, x0-x, y0, y0+y, invert);
 			if ((opt & OLED_DRAW_LOWER_RIGHT) == OLED_DRAW_LOWER_RIGHT)
-				_ssd1306_line(dev, x0+x, y0-y, x0+x, y0, invert);
+				_ssd1306_vline(dev, x0+x, y0-y, y0, invert);
 			if ((opt & OLED_DRAW_UPPER_RIGHT) == OLED_DRAW_UPPER_RIGHT)
-				_ssd1306_line(dev, x0+x, y0, x0+x, y0+y, invert);
+				_ssd1306_vline(dev, x0+x, y0, y0+y, invert);
 
 		} // endif
 		ChangeX=(old_err=err)<=x;
 		if (ChangeX) err+=++x*2+1;
 		if (old_err>y || err>x) err+=++y*2+1;
 	} while(y<=0);
-
-
 }
 
 // Draw cursor
@@ -747,17 +1395,25 @@ void _ssd1306_cursor(SSD1306_t * dev, int x0, int y0, int r, bool invert)
 void ssd1306_invert(uint8_t *buf, size_t blen)
 {
 	uint8_t wk;
-	for(int i=0; i<blen; i++){
+	for(size_t i=0; i<blen; i++){
 		wk = buf[i];
 		buf[i] = ~wk;
 	}
 }
 
 // Flip upside down
+// Four bytes per step; each byte is reversed on its own, so word order does not matter
 void ssd1306_flip(uint8_t *buf, size_t blen)
 {
-	for(int i=0; i<blen; i++){
-		buf[i] = ssd1306_rotate_byte(buf[i]);
+	size_t i = 0;
+	for(; i+4<=blen; i+=4){
+		uint32_t wk;
+		memcpy(&wk, &buf[i], 4);
+		wk = ssd1306_reverse8x4(wk);
+		memcpy(&buf[i], &wk, 4);
+	}
+	for(; i<blen; i++){
+		buf[i] = ssd1306_reverse8(buf[i]);
 	}
 }
 
@@ -785,63 +1441,25 @@ uint8_t ssd1306_copy_bit(uint8_t src, int srcBits, uint8_t dst, int dstBits)
 // Rotate 8-bit data
 // 0x12-->0x48
 uint8_t ssd1306_rotate_byte(uint8_t ch1) {
-	uint8_t ch2 = 0;
-	for (int j=0;j<8;j++) {
-		ch2 = (ch2 << 1) + (ch1 & 0x01);
-		ch1 = ch1 >> 1;
-	}
-	return ch2;
+	return ssd1306_reverse8(ch1);
 }
 
 
+// Fade to a blank screen: contrast ramp on the framebuffer effects engine
 void ssd1306_fadeout(SSD1306_t * dev)
 {
-	void (*func)(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
-	if (dev->_address == SPI_ADDRESS) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
-	uint8_t image[1];
-	for(int page=0; page<dev->_pages; page++) {
-		image[0] = 0xFF;
-		for(int line=0; line<8; line++) {
-			if (dev->_flip) {
-				image[0] = image[0] >> 1;
-			} else {
-				image[0] = image[0] << 1;
-			}
-			for(int seg=0; seg<128; seg++) {
-				(*func)(dev, page, seg, image, 1);
-				dev->_page[page]._segs[seg] = image[0];
-			}
-		}
-	}
+	ssd1306_effect_run(dev, EFFECT_FADE_OUT, NULL, SSD1306_FADEOUT_MS);
 }
 
 // Rotate character image
 // Only valid for 8 dots x 8 dots
 void ssd1306_rotate_image(uint8_t *image, bool flip) {
+	// bit i of image[j] becomes bit 7-j of image[i]: a transpose of the rows taken bottom-up
 	uint8_t _image[8];
-	uint8_t _smask = 0x01;
-	for (int i=0;i<8;i++) {
-		uint8_t _dmask = 0x80;
-		_image[i] = 0;
-		for (int j=0;j<8;j++) {
-			uint8_t _wk = image[j] & _smask;
-			ESP_LOGD(__FUNCTION__, "image[%d]=0x%x _smask=0x%x _wk=0x%x", j, image[j], _smask, _wk);
-			if (_wk != 0) {
-				_image[i] = _image[i] + _dmask;
-			}
-			_dmask = _dmask >> 1;
-		}
-		_smask = _smask << 1;
-	}
-
-	for (int i=0;i<8;i++) {
-		image[i] = _image[i];
+	for (int j=0;j<8;j++) {
+		_image[j] = image[7-j];
 	}
+	ssd1306_transpose8(_image, image);
 	if (flip) ssd1306_flip(image, 8);
 #if 0
 	for (int i=0;i<8;i++) {
@@ -856,10 +1474,7 @@ void ssd1306_display_rotate_text(SSD1306_t * dev, int seg, const char * text, in
 	uint8_t image[8];
 	int _page = dev->_pages-1;
 	for (uint8_t i = 0; i < _text_len; i++) {
-		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
-		ssd1306_rotate_image(image, dev->_flip);
-		ESP_LOGD(__FUNCTION__, "_page=%d seg=%d", _page, seg);
-		if (invert) ssd1306_invert(image, 8);
+		ssd1306_blit_glyph(image, ssd1306_glyph_rotated((uint8_t)text[i], dev->_flip), invert);
 		ssd1306_display_image(dev, _page, seg, image, 8);
 		_page--;
 		if (_page < 0) return;
@@ -0,0 +1,209 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_assets.h"
+
+#define TAG "SSD1306_ASSETS"
+
+// Check the header and CRC of a mapped pack of at most size bytes
+static esp_err_t assets_check(const uint8_t * base, size_t size)
+{
+	const SSD1306_AssetsHeader_t * header = (const SSD1306_AssetsHeader_t *)base;
+	if (size < sizeof(SSD1306_AssetsHeader_t) || header->magic != SSD1306_ASSETS_MAGIC) {
+		return ESP_ERR_NOT_FOUND;
+	}
+	if (header->version != SSD1306_ASSETS_VERSION) return ESP_ERR_INVALID_VERSION;
+	if (header->size > size || header->size < sizeof(SSD1306_AssetsHeader_t) + header->count * sizeof(SSD1306_AssetEntry_t)) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+	uint32_t crc = esp_rom_crc32_le(0, base + sizeof(SSD1306_AssetsHeader_t), header->size - sizeof(SSD1306_AssetsHeader_t));
+	if (crc != header->crc) return ESP_ERR_INVALID_CRC;
+	return ESP_OK;
+}
+
+// Map the asset partition and check the pack in it. Nothing is copied:
+// the pack stays mapped until ssd1306_assets_close.
+esp_err_t ssd1306_assets_open(SSD1306_Assets_t * pack, const char * label)
+{
+	memset(pack, 0, sizeof(SSD1306_Assets_t));
+	const esp_partition_t * part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+	if (part == NULL) {
+		ESP_LOGW(TAG, "No partition \"%s\"", label);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	const void * ptr;
+	esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &pack->handle);
+	if (ret != ESP_OK) {
+		ESP_LOGE(TAG, "Cannot map \"%s\": %s", label, esp_err_to_name(ret));
+		return ret;
+	}
+	ret = assets_check(ptr, part->size);
+	if (ret != ESP_OK) {
+		ESP_LOGW(TAG, "No valid asset pack in \"%s\": %s", label, esp_err_to_name(ret));
+		esp_partition_munmap(pack->handle);
+		return ret;
+	}
+
+	pack->base = ptr;
+	pack->header = ptr;
+	pack->dir = (const SSD1306_AssetEntry_t *)(pack->base + sizeof(SSD1306_AssetsHeader_t));
+	pack->mapped = true;
+	ESP_LOGI(TAG, "\"%s\": %d assets, %lu bytes", label, pack->header->count, (unsigned long)pack->header->size);
+	return ESP_OK;
+}
+
+void ssd1306_assets_close(SSD1306_Assets_t * pack)
+{
+	if (pack->mapped) esp_partition_munmap(pack->handle);
+	memset(pack, 0, sizeof(SSD1306_Assets_t));
+}
+
+// Directory entry of the named asset; NULL if missing, of another type or
+// reaching past the pack
+static const SSD1306_AssetEntry_t * assets_find(SSD1306_Assets_t * pack, const char * name, ssd1306_asset_type_t type)
+{
+	if (!pack->mapped) return NULL;
+	for (int i = 0; i < pack->header->count; i++) {
+		const SSD1306_AssetEntry_t * entry = &pack->dir[i];
+		if (strncmp(entry->name, name, SSD1306_ASSET_NAME_LEN) != 0) continue;
+		if (entry->type != type) return NULL;
+		if (entry->offset % 4 || entry->offset > pack->header->size || entry->size > pack->header->size - entry->offset) {
+			return NULL;
+		}
+		return entry;
+	}
+	return NULL;
+}
+
+esp_err_t ssd1306_assets_font(SSD1306_Assets_t * pack, const char * name, SSD1306_Font_t * font)
+{
+	memset(font, 0, sizeof(SSD1306_Font_t));
+	const SSD1306_AssetEntry_t * entry = assets_find(pack, name, ASSET_FONT);
+	if (entry == NULL || entry->size < sizeof(SSD1306_FontHeader_t)) return ESP_ERR_NOT_FOUND;
+
+	const uint8_t * data = pack->base + entry->offset;
+	const SSD1306_FontHeader_t * header = (const SSD1306_FontHeader_t *)data;
+	bool flipped = header->flags & SSD1306_ASSET_FLIPPED;
+	size_t need = sizeof(SSD1306_FontHeader_t) + header->count * sizeof(SSD1306_FontGlyph_t) + header->columns * (flipped ? 2 : 1);
+	if (header->pages < 1 || header->pages > 8 || need > entry->size) return ESP_ERR_INVALID_SIZE;
+
+	const SSD1306_FontGlyph_t * glyphs = (const SSD1306_FontGlyph_t *)(data + sizeof(SSD1306_FontHeader_t));
+	for (int i = 0; i < header->count; i++) {
+		if ((uint32_t)glyphs[i].offset + glyphs[i].width * header->pages > header->columns) return ESP_ERR_INVALID_SIZE;
+	}
+
+	font->header = header;
+	font->glyphs = glyphs;
+	font->columns[0] = (const uint8_t *)&glyphs[header->count];
+	font->columns[1] = flipped ? font->columns[0] + header->columns : NULL;
+	return ESP_OK;
+}
+
+esp_err_t ssd1306_assets_atlas(SSD1306_Assets_t * pack, const char * name, SSD1306_Atlas_t * atlas)
+{
+	memset(atlas, 0, sizeof(SSD1306_Atlas_t));
+	const SSD1306_AssetEntry_t * entry = assets_find(pack, name, ASSET_ATLAS);
+	if (entry == NULL || entry->size < sizeof(SSD1306_AtlasHeader_t)) return ESP_ERR_NOT_FOUND;
+
+	const uint8_t * data = pack->base + entry->offset;
+	const SSD1306_AtlasHeader_t * header = (const SSD1306_AtlasHeader_t *)data;
+	bool flipped = header->flags & SSD1306_ASSET_FLIPPED;
+	size_t icons = (size_t)header->count * header->width * header->pages;
+	if (header->pages < 1 || header->pages > 8 || sizeof(SSD1306_AtlasHeader_t) + icons * (flipped ? 2 : 1) > entry->size) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	atlas->header = header;
+	atlas->icons[0] = data + sizeof(SSD1306_AtlasHeader_t);
+	atlas->icons[1] = flipped ? atlas->icons[0] + icons : NULL;
+	return ESP_OK;
+}
+
+static const SSD1306_FontGlyph_t * font_glyph(const SSD1306_Font_t * font, uint8_t ch)
+{
+	const SSD1306_FontHeader_t * header = font->header;
+	int i = ch - header->first;
+	if (i < 0 || i >= header->count || font->glyphs[i].width == 0) {
+		i = header->missing - header->first;
+		if (i < 0 || i >= header->count) return NULL;
+	}
+	return &font->glyphs[i];
+}
+
+// Columns of one page of a glyph or icon into _segs, clipped to the panel.
+// Without a flipped copy in the pack, flipped panels reverse each byte here.
+static void assets_columns(SSD1306_t * dev, int page, int seg, const uint8_t * const src[2], size_t offset, int width, bool invert)
+{
+	if (page >= dev->_pages) return;
+	int skip = seg < 0 ? -seg : 0;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+	if (skip >= width) return;
+
+	uint8_t * segs = dev->_page[page]._segs;
+	bool reverse = dev->_flip && src[1] == NULL;
+	const uint8_t * s = ((dev->_flip && !reverse) ? src[1] : src[0]) + offset;
+	if (!reverse && !invert) {
+		memcpy(&segs[seg + skip], &s[skip], width - skip);
+		return;
+	}
+	for (int i = skip; i < width; i++) {
+		uint8_t wk = reverse ? ssd1306_reverse8(s[i]) : s[i];
+		segs[seg + i] = invert ? ~wk : wk;
+	}
+}
+
+// Columns text_len characters take, spacing included
+int ssd1306_font_width(const SSD1306_Font_t * font, const char * text, int text_len)
+{
+	int width = 0;
+	for (int i = 0; i < text_len; i++) {
+		const SSD1306_FontGlyph_t * glyph = font_glyph(font, (uint8_t)text[i]);
+		if (glyph) width += glyph->width + font->header->spacing;
+	}
+	return width;
+}
+
+// Draw text with its top at page into the frame buffer and mark it dirty
+// (show with ssd1306_present). Each character cell is opaque, spacing
+// included. Returns the column after the text.
+int ssd1306_font_text(SSD1306_t * dev, const SSD1306_Font_t * font, int page, int seg, const char * text, int text_len, bool invert)
+{
+	const SSD1306_FontHeader_t * header = font->header;
+	if (page < 0 || page >= dev->_pages) return seg;
+
+	int _seg = seg;
+	for (int i = 0; i < text_len && _seg < dev->_width; i++) {
+		const SSD1306_FontGlyph_t * glyph = font_glyph(font, (uint8_t)text[i]);
+		if (glyph == NULL) continue;
+		for (int k = 0; k < header->pages; k++) {
+			assets_columns(dev, page + k, _seg, font->columns, glyph->offset + k * glyph->width, glyph->width, invert);
+			for (int s = _seg + glyph->width; s < _seg + glyph->width + header->spacing && s < dev->_width; s++) {
+				if (page + k < dev->_pages && s >= 0) dev->_page[page + k]._segs[s] = invert ? 0xFF : 0x00;
+			}
+		}
+		_seg += glyph->width + header->spacing;
+	}
+	for (int k = 0; k < header->pages; k++) {
+		ssd1306_mark_dirty(dev, page + k, seg, _seg - seg);
+	}
+	return _seg;
+}
+
+// Icon number index of the atlas with its top at page, marked dirty
+void ssd1306_atlas_icon(SSD1306_t * dev, const SSD1306_Atlas_t * atlas, int page, int seg, int index, bool invert)
+{
+	const SSD1306_AtlasHeader_t * header = atlas->header;
+	if (index < 0 || index >= header->count) return;
+	if (page < 0 || page >= dev->_pages) return;
+
+	size_t offset = (size_t)index * header->width * header->pages;
+	for (int k = 0; k < header->pages; k++) {
+		assets_columns(dev, page + k, seg, atlas->icons, offset + k * header->width, header->width, invert);
+		ssd1306_mark_dirty(dev, page + k, seg, header->width);
+	}
+}
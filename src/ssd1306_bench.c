@@ -0,0 +1,95 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ssd1306.h"
+
+#define TAG "SSD1306_BENCH"
+
+// The bit-by-bit routine ssd1306_blit replaced, kept as the baseline
+// (per-pixel ssd1306_copy_bit, widths in multiples of 8, no clipping).
+static void bitmaps_reference(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert)
+{
+	int _width = width / 8;
+	uint8_t page = (ypos / 8);
+	uint8_t _seg = xpos;
+	uint8_t dstBits = (ypos % 8);
+	int offset = 0;
+	for(int _height=0;_height<height;_height++) {
+		for (int index=0;index<_width;index++) {
+			for (int srcBits=7; srcBits>=0; srcBits--) {
+				if (_seg >= 128 || page >= dev->_pages) break;
+				uint8_t wk0 = dev->_page[page]._segs[_seg];
+				if (dev->_flip) wk0 = ssd1306_rotate_byte(wk0);
+				uint8_t wk1 = bitmap[index+offset];
+				if (invert) wk1 = ~wk1;
+				uint8_t wk2 = ssd1306_copy_bit(wk1, srcBits, wk0, dstBits);
+				if (dev->_flip) wk2 = ssd1306_rotate_byte(wk2);
+				dev->_page[page]._segs[_seg] = wk2;
+				_seg++;
+			}
+		}
+		offset = offset + _width;
+		dstBits++;
+		_seg = xpos;
+		if (dstBits == 8) {
+			page++;
+			dstBits=0;
+		}
+	}
+}
+
+// Time a full-screen bitmap with both routines and check they agree.
+// Works on the internal buffer only; its content is restored afterwards.
+void ssd1306_bench_bitmaps(SSD1306_t * dev, int iterations)
+{
+	if (iterations <= 0) return;
+	int width = dev->_width;
+	int height = dev->_pages * 8;
+	int size = width / 8 * height;
+	uint8_t * bitmap = malloc(size);
+	uint8_t * saved = malloc(128 * 8);
+	uint8_t * expect = malloc(128 * 8);
+	if (bitmap == NULL || saved == NULL || expect == NULL) {
+		ESP_LOGE(TAG, "no memory");
+		goto done;
+	}
+	for (int i=0; i<size; i++) {
+		bitmap[i] = (uint8_t)(i * 37 + (i >> 3));
+	}
+	ssd1306_get_buffer(dev, saved);
+
+	int64_t start = esp_timer_get_time();
+	for (int i=0; i<iterations; i++) {
+		bitmaps_reference(dev, 0, 0, bitmap, width, height, false);
+	}
+	int64_t reference_us = esp_timer_get_time() - start;
+	ssd1306_get_buffer(dev, expect);
+
+	start = esp_timer_get_time();
+	for (int i=0; i<iterations; i++) {
+		ssd1306_blit(dev, 0, 0, bitmap, width, height, false, BLIT_COPY);
+	}
+	int64_t blit_us = esp_timer_get_time() - start;
+
+	uint8_t page_buf[128];
+	bool match = true;
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_get_page(dev, page, page_buf);
+		if (memcmp(page_buf, &expect[page * 128], 128) != 0) match = false;
+	}
+
+	ESP_LOGI(TAG, "%dx%d bitmap: bit-by-bit %lld us, blit %lld us per call (%s)",
+		width, height,
+		(long long)(reference_us / iterations), (long long)(blit_us / iterations),
+		match ? "match" : "MISMATCH");
+
+	ssd1306_set_buffer(dev, saved);
+
+done:
+	free(bitmap);
+	free(saved);
+	free(expect);
+}
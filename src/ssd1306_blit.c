@@ -0,0 +1,82 @@
+#include <string.h>
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+
+// Row-major, MSB-first bitmaps (rows padded to whole bytes) are converted to
+// the page/column layout eight rows at a time: an 8x8 bit transpose
+// (ssd1306_transpose8) turns eight source bytes into eight column bytes, which
+// are then shifted into place across at most two pages.
+
+// Merge the masked bits of one column byte into the frame buffer
+static inline void blit_byte(SSD1306_t * dev, int page, int seg, uint8_t src, uint8_t mask, ssd1306_blit_mode_t mode)
+{
+	if (mask == 0 || page >= dev->_pages) return;
+	if (dev->_flip) {
+		src = ssd1306_reverse8(src);
+		mask = ssd1306_reverse8(mask);
+	}
+	src &= mask;
+	uint8_t * dst = &dev->_page[page]._segs[seg];
+	switch (mode) {
+	case BLIT_COPY:    *dst = (*dst & ~mask) | src; break;
+	case BLIT_OR:      *dst |= src; break;
+	case BLIT_XOR:     *dst ^= src; break;
+	case BLIT_AND_NOT: *dst &= ~src; break;
+	}
+}
+
+// Draw a width x height bitmap with its top-left corner at (xpos, ypos) into
+// the internal buffer. Any width is accepted and the image is clipped to the
+// panel. Not show it; changed ranges are marked dirty.
+void ssd1306_blit(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert, ssd1306_blit_mode_t mode)
+{
+	if (width <= 0 || height <= 0) return;
+	int stride = (width + 7) / 8;
+
+	// Visible columns [x0, x1) and source rows [r_start, r_end)
+	int x0 = xpos < 0 ? 0 : xpos;
+	int x1 = xpos + width;
+	if (x1 > dev->_width) x1 = dev->_width;
+	int r_start = ypos < 0 ? -ypos : 0;
+	int r_end = dev->_pages * 8 - ypos;
+	if (r_end > height) r_end = height;
+	if (x0 >= x1 || r_start >= r_end) return;
+
+	uint8_t inv = invert ? 0xFF : 0x00;
+	int bx_start = (x0 - xpos) & ~7;
+
+	for (int r = r_start; r < r_end; r += 8) {
+		int rows_in_band = r_end - r;
+		if (rows_in_band > 8) rows_in_band = 8;
+		uint8_t band_mask = (uint8_t)((1u << rows_in_band) - 1);
+
+		int y = ypos + r;
+		int page = y >> 3;
+		int shift = y & 7;
+		uint16_t mask = (uint16_t)band_mask << shift;
+
+		for (int bx = bx_start; xpos + bx < x1; bx += 8) {
+			// After the transpose cols[7 - c] is column c, bit k = row k of the band
+			uint8_t rows[8];
+			const uint8_t * src = &bitmap[r * stride + bx / 8];
+			for (int k = 0; k < 8; k++) {
+				rows[k] = (k < rows_in_band) ? (src[k * stride] ^ inv) : 0;
+			}
+			uint8_t cols[8];
+			ssd1306_transpose8(rows, cols);
+
+			for (int c = 0; c < 8; c++) {
+				int seg = xpos + bx + c;
+				if (seg < x0) continue;
+				if (seg >= x1) break;
+				uint16_t wk = (uint16_t)cols[7 - c] << shift;
+				blit_byte(dev, page, seg, wk & 0xFF, mask & 0xFF, mode);
+				if (shift) blit_byte(dev, page + 1, seg, wk >> 8, mask >> 8, mode);
+			}
+		}
+
+		ssd1306_mark_dirty(dev, page, x0, x1 - x0);
+		if (shift) ssd1306_mark_dirty(dev, page + 1, x0, x1 - x0);
+	}
+}
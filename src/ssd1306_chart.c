@@ -0,0 +1,130 @@
+#include <string.h>
+#include <math.h>
+
+#include "ssd1306.h"
+#include "ssd1306_chart.h"
+
+void ssd1306_chart_init(SSD1306_Chart_t * chart, SSD1306_t * dev, int page, int pages)
+{
+	memset(chart, 0, sizeof(SSD1306_Chart_t));
+	if (page < 0) page = 0;
+	if (page + pages > dev->_pages) pages = dev->_pages - page;
+	chart->dev = dev;
+	chart->page = page;
+	chart->pages = pages;
+	chart->autorange = true;
+}
+
+// Fixed y-axis; values outside it are clamped to the chart edges
+void ssd1306_chart_set_range(SSD1306_Chart_t * chart, float lo, float hi)
+{
+	chart->autorange = false;
+	chart->ranged = (hi > lo);
+	chart->lo = lo;
+	chart->hi = hi;
+	ssd1306_chart_redraw(chart);
+}
+
+static float chart_sample(const SSD1306_Chart_t * chart, int i)
+{
+	int width = chart->dev->_width;
+	int start = (chart->count < width) ? 0 : chart->head;
+	return chart->history[(start + i) % width];
+}
+
+// Pixel row of a value, top row for hi
+static int chart_row(const SSD1306_Chart_t * chart, float value)
+{
+	int top = chart->page * 8;
+	int height = chart->pages * 8;
+	if (!chart->ranged) return top + height - 1;
+	float frac = (value - chart->lo) / (chart->hi - chart->lo);
+	if (frac < 0.0f) frac = 0.0f;
+	if (frac > 1.0f) frac = 1.0f;
+	return top + (height - 1) - (int)lroundf(frac * (height - 1));
+}
+
+// Draw sample i into column seg, joined to the previous sample by a vertical span
+static void chart_column(SSD1306_Chart_t * chart, int seg, int i)
+{
+	SSD1306_t * dev = chart->dev;
+	for (int page=chart->page; page<chart->page + chart->pages; page++) {
+		dev->_page[page]._segs[seg] = 0;
+		ssd1306_mark_dirty(dev, page, seg, 1);
+	}
+
+	int y = chart_row(chart, chart_sample(chart, i));
+	int y_prev = (i > 0) ? chart_row(chart, chart_sample(chart, i - 1)) : y;
+	_ssd1306_vline(dev, seg, y_prev, y, false);
+}
+
+// Range from the data with headroom. Returns true if lo/hi changed.
+// Hysteresis: a new range is only taken when data leaves the current one
+// or shrinks to under a quarter of it.
+static bool chart_autorange(SSD1306_Chart_t * chart)
+{
+	float min = chart_sample(chart, 0);
+	float max = min;
+	int n = chart->count < chart->dev->_width ? chart->count : chart->dev->_width;
+	for (int i=1; i<n; i++) {
+		float v = chart_sample(chart, i);
+		if (v < min) min = v;
+		if (v > max) max = v;
+	}
+
+	float span = max - min;
+	if (chart->ranged && min >= chart->lo && max <= chart->hi
+		&& span * 4.0f >= chart->hi - chart->lo) {
+		return false;
+	}
+	if (span <= 0.0f) {
+		span = fabsf(max) * 0.01f;
+		if (span <= 0.0f) span = 1.0f;
+	}
+	float lo = min - span * SSD1306_CHART_HEADROOM;
+	float hi = max + span * SSD1306_CHART_HEADROOM;
+	if (chart->ranged && lo == chart->lo && hi == chart->hi) return false;
+	chart->lo = lo;
+	chart->hi = hi;
+	chart->ranged = true;
+	return true;
+}
+
+// Render every column from the history. Only the changed bytes reach the
+// panel on the next flush.
+void ssd1306_chart_redraw(SSD1306_Chart_t * chart)
+{
+	SSD1306_t * dev = chart->dev;
+	int width = dev->_width;
+	int n = chart->count < width ? chart->count : width;
+
+	_ssd1306_fill_rect(dev, 0, chart->page * 8, width, chart->pages * 8, true);
+	for (int i=0; i<n; i++) {
+		chart_column(chart, width - n + i, i);
+	}
+	chart->redraws++;
+}
+
+void ssd1306_chart_push(SSD1306_Chart_t * chart, float value)
+{
+	SSD1306_t * dev = chart->dev;
+	int width = dev->_width;
+	if (chart->pages <= 0) return;
+
+	if (chart->count < width) {
+		chart->history[chart->count++] = value;
+	} else {
+		chart->history[chart->head] = value;
+		chart->head = (chart->head + 1) % width;
+	}
+
+	if (chart->autorange && chart_autorange(chart)) {
+		ssd1306_chart_redraw(chart);
+		return;
+	}
+
+	// Same axis: shift the panel by one column and draw only the new sample
+	ssd1306_content_scroll_left(dev, chart->page, chart->page + chart->pages - 1);
+	int n = chart->count < width ? chart->count : width;
+	chart_column(chart, width - 1, n - 1);
+}
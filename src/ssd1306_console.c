@@ -0,0 +1,87 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "ssd1306.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_console.h"
+
+// GDDRAM page showing visible line i (0 = top). Rows run up the RAM on a
+// normal panel and down it on a flipped one.
+static int console_page(SSD1306_Console_t * con, int i)
+{
+	SSD1306_t * dev = con->dev;
+	int top = con->start / 8;
+	if (dev->_flip) return (top + dev->_pages - 1 - i) % SSD1306_GDDRAM_PAGES;
+	return (top + i) % SSD1306_GDDRAM_PAGES;
+}
+
+// One line of glyphs, blank to the right; invert highlights the whole row
+static void console_compose(SSD1306_t * dev, uint8_t * segs, const char * text, bool invert)
+{
+	memset(segs, invert ? 0xFF : 0x00, dev->_width);
+	int seg = 0;
+	for (int i = 0; text[i] && seg + 8 <= dev->_width; i++, seg += 8) {
+		ssd1306_blit_glyph(&segs[seg], ssd1306_glyph((uint8_t)text[i], dev->_flip), invert);
+	}
+}
+
+void ssd1306_console_init(SSD1306_Console_t * con, SSD1306_t * dev)
+{
+	memset(con, 0, sizeof(SSD1306_Console_t));
+	con->dev = dev;
+
+	uint8_t blank[128] = {0};
+	for (int page = 0; page < SSD1306_GDDRAM_PAGES; page++) {
+		ssd1306_display_ram(dev, page, 0, blank, dev->_width);
+	}
+	ssd1306_start_line(dev, 0);
+}
+
+// Scroll up by one line and show text on the bottom line (at most
+// SSD1306_CONSOLE_COLUMNS characters; the rest is cut off)
+void ssd1306_console_print(SSD1306_Console_t * con, const char * text, int text_len, bool invert)
+{
+	SSD1306_t * dev = con->dev;
+	if (text_len > SSD1306_CONSOLE_COLUMNS) text_len = SSD1306_CONSOLE_COLUMNS;
+	if (text_len < 0) text_len = 0;
+
+	// The page that becomes the bottom line is off screen (or the outgoing top
+	// line) until the start line moves
+	con->start = (con->start + (dev->_flip ? 64 - 8 : 8)) % 64;
+	int page = console_page(con, dev->_pages - 1);
+	memcpy(con->text[page], text, text_len);
+	con->text[page][text_len] = '\0';
+	con->invert[page] = invert;
+
+	uint8_t segs[128];
+	console_compose(dev, segs, con->text[page], invert);
+	ssd1306_display_ram(dev, page, 0, segs, dev->_width);
+	ssd1306_start_line(dev, con->start);
+	con->lines++;
+}
+
+void ssd1306_console_printf(SSD1306_Console_t * con, const char * format, ...)
+{
+	char line[SSD1306_CONSOLE_COLUMNS + 1];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	ssd1306_console_print(con, line, strlen(line), false);
+}
+
+// Give the panel back to the frame buffer: the visible lines are drawn into
+// it, the start line goes back to 0 and the whole frame is resent
+void ssd1306_console_end(SSD1306_Console_t * con)
+{
+	SSD1306_t * dev = con->dev;
+	for (int i = 0; i < dev->_pages; i++) {
+		int page = console_page(con, i);
+		console_compose(dev, dev->_page[i]._segs, con->text[page], con->invert[page]);
+	}
+	con->start = 0;
+	ssd1306_start_line(dev, 0);
+	ssd1306_invalidate(dev);
+	ssd1306_present(dev);
+}
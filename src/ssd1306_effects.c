@@ -0,0 +1,233 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_effects.h"
+
+#define TAG "SSD1306_FX"
+
+// Logical rows [0, rows) of a page as a _segs bit mask
+static uint8_t rows_mask(SSD1306_t * dev, int page, int rows)
+{
+	int n = rows - page * 8;
+	if (n <= 0) return 0x00;
+	if (n >= 8) return 0xFF;
+	uint8_t mask = (uint8_t)((1 << n) - 1);
+	return dev->_flip ? ssd1306_reverse8(mask) : mask;
+}
+
+// Column x of a frame as a logical bit column (bit y = row y)
+static uint64_t column_get(SSD1306_t * dev, uint8_t frame[][128], int x)
+{
+	uint64_t v = 0;
+	for (int page=0; page<dev->_pages; page++) {
+		uint8_t b = frame[page][x];
+		if (dev->_flip) b = ssd1306_reverse8(b);
+		v |= (uint64_t)b << (page * 8);
+	}
+	return v;
+}
+
+static void column_put(SSD1306_t * dev, uint8_t * const out[], int x, uint64_t v)
+{
+	for (int page=0; page<dev->_pages; page++) {
+		uint8_t b = (uint8_t)(v >> (page * 8));
+		out[page][x] = dev->_flip ? ssd1306_reverse8(b) : b;
+	}
+}
+
+static void effect_contrast(SSD1306_Effect_t * fx, int contrast)
+{
+	if (contrast == fx->last_contrast) return;
+	ssd1306_contrast(fx->dev, contrast);
+	fx->last_contrast = contrast;
+}
+
+// Copy a whole frame into the output pages
+static void frame_copy(SSD1306_t * dev, uint8_t * const out[], uint8_t frame[][128])
+{
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(out[page], frame[page], 128);
+	}
+}
+
+// Frame at progress num/den (0..den) into the output pages
+static void effect_render(SSD1306_Effect_t * fx, int num, int den, uint8_t * const out[])
+{
+	SSD1306_t * dev = fx->dev;
+	int width = dev->_width;
+	int height = dev->_pages * 8;
+
+	switch (fx->type) {
+	case EFFECT_FADE_OUT:
+		frame_copy(dev, out, (num < den) ? fx->from : fx->to);
+		break;
+
+	case EFFECT_FADE_IN:
+		frame_copy(dev, out, fx->to);
+		break;
+
+	case EFFECT_WIPE_LEFT:
+	case EFFECT_WIPE_RIGHT: {
+		int edge = width * num / den;	// Columns taken from the target
+		for (int page=0; page<dev->_pages; page++) {
+			if (fx->type == EFFECT_WIPE_RIGHT) {
+				memcpy(&out[page][0], &fx->to[page][0], edge);
+				memcpy(&out[page][edge], &fx->from[page][edge], width - edge);
+			} else {
+				memcpy(&out[page][0], &fx->from[page][0], width - edge);
+				memcpy(&out[page][width - edge], &fx->to[page][width - edge], edge);
+			}
+		}
+		break;
+	}
+
+	case EFFECT_WIPE_UP:
+	case EFFECT_WIPE_DOWN: {
+		int edge = height * num / den;	// Rows taken from the target
+		for (int page=0; page<dev->_pages; page++) {
+			uint8_t mask;
+			if (fx->type == EFFECT_WIPE_DOWN) {
+				mask = rows_mask(dev, page, edge);
+			} else {
+				mask = ~rows_mask(dev, page, height - edge);
+			}
+			for (int x=0; x<width; x++) {
+				out[page][x] = (fx->to[page][x] & mask) | (fx->from[page][x] & ~mask);
+			}
+		}
+		break;
+	}
+
+	case EFFECT_WRAP_LEFT:
+	case EFFECT_WRAP_RIGHT: {
+		int offset = (width * num / den) % width;
+		if (fx->type == EFFECT_WRAP_RIGHT) offset = (width - offset) % width;
+		for (int page=0; page<dev->_pages; page++) {
+			memcpy(&out[page][0], &fx->from[page][offset], width - offset);
+			memcpy(&out[page][width - offset], &fx->from[page][0], offset);
+		}
+		break;
+	}
+
+	case EFFECT_WRAP_UP:
+	case EFFECT_WRAP_DOWN: {
+		int offset = (height * num / den) % height;
+		if (fx->type == EFFECT_WRAP_DOWN) offset = (height - offset) % height;
+		uint64_t mask = (height == 64) ? ~0ULL : ((1ULL << height) - 1);
+		for (int x=0; x<width; x++) {
+			uint64_t v = column_get(dev, fx->from, x);
+			if (offset) v = ((v >> offset) | (v << (height - offset))) & mask;
+			column_put(dev, out, x, v);
+		}
+		break;
+	}
+
+	case EFFECT_INVERT: {
+		// Quarters 1 and 3 inverted
+		bool inverted = (num < den) && ((num * 4 / den) & 1);
+		frame_copy(dev, out, fx->from);
+		for (int page=0; inverted && page<dev->_pages; page++) {
+			ssd1306_invert(out[page], 128);
+		}
+		break;
+	}
+
+	default:
+		frame_copy(dev, out, fx->to);
+		break;
+	}
+}
+
+// Begin an effect from the current screen to target (pages x 128 bytes, NULL
+// for a blank screen; WRAP and INVERT end on the current screen).
+void ssd1306_effect_start(SSD1306_Effect_t * fx, SSD1306_t * dev, ssd1306_effect_type_t type, const uint8_t * target, uint32_t duration_ms)
+{
+	fx->dev = dev;
+	fx->type = type;
+	fx->duration_ms = duration_ms;
+	fx->frames = 0;
+	fx->contrast = dev->_contrast;
+	fx->last_contrast = dev->_contrast;
+
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_get_page(dev, page, fx->from[page]);
+	}
+	if (type == EFFECT_WRAP_LEFT || type == EFFECT_WRAP_RIGHT || type == EFFECT_WRAP_UP
+		|| type == EFFECT_WRAP_DOWN || type == EFFECT_INVERT) {
+		memcpy(fx->to, fx->from, sizeof(fx->to));
+	} else if (target) {
+		memcpy(fx->to, target, (size_t)dev->_pages * 128);
+	} else {
+		memset(fx->to, 0, sizeof(fx->to));
+	}
+
+	if (type == EFFECT_FADE_IN) effect_contrast(fx, 0);
+	fx->start_us = esp_timer_get_time();
+	fx->running = true;
+}
+
+// Render and present the frame for the current time.
+// Returns false once the final frame has been shown.
+bool ssd1306_effect_step(SSD1306_Effect_t * fx)
+{
+	if (!fx->running) return false;
+	SSD1306_t * dev = fx->dev;
+
+	int64_t elapsed_ms = (esp_timer_get_time() - fx->start_us) / 1000;
+	int den = fx->duration_ms > 0 ? (int)fx->duration_ms : 1;
+	int num = (elapsed_ms >= den) ? den : (int)elapsed_ms;
+	bool done = (num == den);
+
+	// Render straight into the frame buffer, then one batched flush
+	uint8_t * out[8];
+	for (int page=0; page<dev->_pages; page++) {
+		out[page] = dev->_page[page]._segs;
+	}
+	ssd1306_batch_begin(dev);
+	effect_render(fx, num, den, out);
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
+	}
+	ssd1306_batch_end(dev);
+
+	// Contrast ramps ride along with the frames; with a flush task each change
+	// is queued behind the frame just presented
+	if (fx->type == EFFECT_FADE_OUT) {
+		effect_contrast(fx, done ? fx->contrast : fx->contrast * (den - num) / den);
+	} else if (fx->type == EFFECT_FADE_IN) {
+		effect_contrast(fx, fx->contrast * num / den);
+	}
+
+	fx->frames++;
+	if (done) {
+		fx->running = false;
+		ESP_LOGD(TAG, "effect %d: %lu frames in %lu ms", fx->type, (unsigned long)fx->frames, (unsigned long)fx->duration_ms);
+	}
+	return !done;
+}
+
+// Blocking helper: run an effect to completion at SSD1306_EFFECT_FRAME_MS per frame
+void ssd1306_effect_run(SSD1306_t * dev, ssd1306_effect_type_t type, const uint8_t * target, uint32_t duration_ms)
+{
+	SSD1306_Effect_t * fx = malloc(sizeof(SSD1306_Effect_t));
+	if (fx == NULL) {
+		ESP_LOGE(TAG, "no memory for effect");
+		return;
+	}
+	TickType_t frame_ticks = pdMS_TO_TICKS(SSD1306_EFFECT_FRAME_MS);
+	if (frame_ticks == 0) frame_ticks = 1;
+
+	ssd1306_effect_start(fx, dev, type, target, duration_ms);
+	TickType_t wake = xTaskGetTickCount();
+	while (ssd1306_effect_step(fx)) {
+		vTaskDelayUntil(&wake, frame_ticks);
+	}
+	free(fx);
+}
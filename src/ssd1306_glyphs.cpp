@@ -0,0 +1,65 @@
+#include <stdint.h>
+
+#include "ssd1306_glyphs.h"
+#include "font8x8_basic.h"
+
+// Glyph tables derived from font8x8_basic_tr by the compiler. Every variant is
+// a constant expression, so nothing is computed at boot and the tables land in
+// .rodata (flash) like the font itself.
+
+namespace {
+
+// 0x12 --> 0x48 (same as ssd1306_rotate_byte)
+constexpr uint8_t reverse_byte(uint8_t ch) {
+	uint8_t out = 0;
+	for (int j = 0; j < 8; j++) {
+		out = (uint8_t)((out << 1) | (ch & 0x01));
+		ch >>= 1;
+	}
+	return out;
+}
+
+enum Variant { NORMAL, FLIP, ROTATE, ROTATE_FLIP };
+
+// Same transform as ssd1306_rotate_image: bit i of column j becomes bit 7-j of column i
+constexpr void rotate(const uint8_t * in, uint8_t * out) {
+	for (int i = 0; i < 8; i++) {
+		uint8_t col = 0;
+		for (int j = 0; j < 8; j++) {
+			if (in[j] & (1 << i)) col |= (uint8_t)(0x80 >> j);
+		}
+		out[i] = col;
+	}
+}
+
+constexpr SSD1306_GlyphTable_t make_table(Variant v) {
+	SSD1306_GlyphTable_t t = {};
+	for (int ch = 0; ch < 128; ch++) {
+		uint8_t glyph[8] = {};
+		if (v == ROTATE || v == ROTATE_FLIP) {
+			rotate(font8x8_basic_tr[ch], glyph);
+		} else {
+			for (int i = 0; i < 8; i++) glyph[i] = font8x8_basic_tr[ch][i];
+		}
+		for (int i = 0; i < 8; i++) {
+			t.g[ch][i] = (v == FLIP || v == ROTATE_FLIP) ? reverse_byte(glyph[i]) : glyph[i];
+		}
+	}
+	return t;
+}
+
+constexpr SSD1306_GlyphTable_t normal_table = make_table(NORMAL);
+constexpr SSD1306_GlyphTable_t flip_table = make_table(FLIP);
+constexpr SSD1306_GlyphTable_t rotate_table = make_table(ROTATE);
+constexpr SSD1306_GlyphTable_t rotate_flip_table = make_table(ROTATE_FLIP);
+
+// Spot checks against the runtime transforms they replace
+static_assert(flip_table.g['A'][1] == reverse_byte(font8x8_basic_tr['A'][1]), "flip table");
+static_assert(rotate_table.g[0x01][3] == 0x10, "rotate table");
+
+} // namespace
+
+extern "C" const SSD1306_GlyphTable_t ssd1306_glyphs = normal_table;
+extern "C" const SSD1306_GlyphTable_t ssd1306_glyphs_flip = flip_table;
+extern "C" const SSD1306_GlyphTable_t ssd1306_glyphs_rotate = rotate_table;
+extern "C" const SSD1306_GlyphTable_t ssd1306_glyphs_rotate_flip = rotate_flip_table;
@@ -0,0 +1,214 @@
+#include <string.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_gray.h"
+
+#define TAG "SSD1306_GRAY"
+
+// Plane shown in each subframe of a gray cycle; the high plane is spread out
+// so no pixel stays dark for two subframes in a row unless its level is 0
+static const uint8_t gray_schedule[SSD1306_GRAY_SUBFRAMES] = { 1, 0, 1 };
+
+// Write level into the masked bits of one byte of both planes
+static inline void gray_put(SSD1306_Gray_t * gray, int page, int seg, uint8_t mask, int level)
+{
+	for (int plane=0; plane<2; plane++) {
+		uint8_t * dst = &gray->planes[plane][page][seg];
+		*dst = (level >> plane) & 1 ? (*dst | mask) : (*dst & ~mask);
+	}
+}
+
+// Rows [y1, y2] of one page as a byte mask, in _segs bit order
+static uint8_t gray_row_mask(SSD1306_t * dev, int page, int y1, int y2)
+{
+	int top = y1 - page * 8;
+	int bottom = y2 - page * 8;
+	if (top < 0) top = 0;
+	if (bottom > 7) bottom = 7;
+	uint8_t mask = (uint8_t)((0xFF << top) & (0xFF >> (7 - bottom)));
+	if (dev->_flip) mask = ssd1306_reverse8(mask);
+	return mask;
+}
+
+static int gray_level(int level)
+{
+	if (level < 0) return 0;
+	if (level >= SSD1306_GRAY_LEVELS) return SSD1306_GRAY_LEVELS - 1;
+	return level;
+}
+
+void ssd1306_gray_init(SSD1306_Gray_t * gray, SSD1306_t * dev)
+{
+	memset(gray, 0, sizeof(SSD1306_Gray_t));
+	gray->dev = dev;
+}
+
+void ssd1306_gray_clear(SSD1306_Gray_t * gray, int level)
+{
+	level = gray_level(level);
+	memset(gray->planes[0], (level & 1) ? 0xFF : 0x00, sizeof(gray->planes[0]));
+	memset(gray->planes[1], (level & 2) ? 0xFF : 0x00, sizeof(gray->planes[1]));
+}
+
+void ssd1306_gray_pixel(SSD1306_Gray_t * gray, int xpos, int ypos, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	if (xpos < 0 || xpos >= dev->_width) return;
+	if (ypos < 0 || ypos >= dev->_pages * 8) return;
+	int _page = (ypos / 8);
+	// Flipped pages store row 0 in bit 7
+	int _bits = dev->_flip ? 7 - (ypos % 8) : (ypos % 8);
+	gray_put(gray, _page, xpos, 1 << _bits, gray_level(level));
+}
+
+void ssd1306_gray_fill_rect(SSD1306_Gray_t * gray, int xpos, int ypos, int width, int height, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	int x1 = xpos < 0 ? 0 : xpos;
+	int x2 = xpos + width - 1;
+	int y1 = ypos < 0 ? 0 : ypos;
+	int y2 = ypos + height - 1;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (y2 >= dev->_pages * 8) y2 = dev->_pages * 8 - 1;
+	if (x1 > x2 || y1 > y2) return;
+	level = gray_level(level);
+
+	for (int page=y1/8; page<=y2/8; page++) {
+		uint8_t mask = gray_row_mask(dev, page, y1, y2);
+		for (int seg=x1; seg<=x2; seg++) {
+			gray_put(gray, page, seg, mask, level);
+		}
+	}
+}
+
+// Text at one level on a level-0 background, 8 pixels per character
+void ssd1306_gray_text(SSD1306_Gray_t * gray, int page, int seg, const char * text, int text_len, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	if (page < 0 || page >= dev->_pages) return;
+	level = gray_level(level);
+	for (int i=0; i<text_len && seg + 8 <= dev->_width; i++, seg += 8) {
+		const uint8_t * glyph = ssd1306_glyph((uint8_t)text[i], dev->_flip);
+		for (int plane=0; plane<2; plane++) {
+			if ((level >> plane) & 1) {
+				memcpy(&gray->planes[plane][page][seg], glyph, 8);
+			} else {
+				memset(&gray->planes[plane][page][seg], 0, 8);
+			}
+		}
+	}
+}
+
+// Send the next subframe of the cycle as one full-frame transaction
+void ssd1306_gray_step(SSD1306_Gray_t * gray)
+{
+	SSD1306_t * dev = gray->dev;
+	int plane = gray_schedule[gray->phase];
+	const uint8_t * src[8];
+	for (int page=0; page<dev->_pages; page++) {
+		src[page] = gray->planes[plane][page];
+	}
+	ssd1306_display_pages(dev, src);
+	gray->phase = (gray->phase + 1) % SSD1306_GRAY_SUBFRAMES;
+}
+
+// Sleep through whole ticks, then spin for the rest: vTaskDelay alone only
+// resolves 1/configTICK_RATE_HZ
+static void gray_wait_until(int64_t when_us)
+{
+	int64_t remaining = when_us - esp_timer_get_time();
+	int64_t tick_us = portTICK_PERIOD_MS * 1000;
+	if (remaining > 2 * tick_us) {
+		vTaskDelay((TickType_t)(remaining / tick_us - 1));
+		remaining = when_us - esp_timer_get_time();
+	}
+	if (remaining > 0) esp_rom_delay_us((uint32_t)remaining);
+}
+
+// Cycle the bitplanes at subframe_hz for duration_ms, with each subframe
+// started on a fixed time grid. Blocks the caller; run it from a task of its
+// own priority. stats may be NULL; the report is logged either way.
+void ssd1306_gray_run(SSD1306_Gray_t * gray, int subframe_hz, int duration_ms, SSD1306_GrayStats_t * stats)
+{
+	SSD1306_GrayStats_t s;
+	memset(&s, 0, sizeof(s));
+	if (subframe_hz <= 0) subframe_hz = 1;
+	int64_t period = 1000000 / subframe_hz;
+	int64_t late_us = period * SSD1306_GRAY_LATE_PCT / 100;
+
+	int64_t start = esp_timer_get_time();
+	int64_t end = start + (int64_t)duration_ms * 1000;
+	int64_t slot = start;
+	int64_t previous = -1;
+	double sum = 0.0;
+	double sum_sq = 0.0;
+	int intervals = 0;
+
+	while (slot < end) {
+		gray_wait_until(slot);
+		int64_t now = esp_timer_get_time();
+		if (now - slot > late_us) s.late++;
+		if (previous >= 0) {
+			int64_t interval = now - previous;
+			if (intervals == 0 || interval < s.interval_min_us) s.interval_min_us = interval;
+			if (interval > s.interval_max_us) s.interval_max_us = interval;
+			sum += interval;
+			sum_sq += (double)interval * interval;
+			intervals++;
+		}
+		previous = now;
+
+		ssd1306_gray_step(gray);
+		int64_t done = esp_timer_get_time();
+		if (done - now > s.send_max_us) s.send_max_us = done - now;
+		s.subframes++;
+
+		// A whole period behind: skip slots instead of sending a burst to catch up
+		slot += period;
+		if (done - slot >= period) {
+			int64_t skip = (done - slot) / period;
+			s.dropped += (int)skip;
+			slot += skip * period;
+		}
+	}
+
+	int64_t elapsed = esp_timer_get_time() - start;
+	if (elapsed > 0) {
+		s.subframe_hz = s.subframes * 1000000.0f / elapsed;
+		s.gray_hz = s.subframe_hz / SSD1306_GRAY_SUBFRAMES;
+	}
+	if (intervals > 0) {
+		double mean = sum / intervals;
+		double var = sum_sq / intervals - mean * mean;
+		s.jitter_us = var > 0.0 ? (float)sqrt(var) : 0.0f;
+	}
+	s.sustained = (s.subframes > 0 && s.late == 0 && s.dropped == 0 && s.send_max_us < period);
+
+	ESP_LOGI(TAG, "%d subframes: %.1f Hz (target %d), %.1f gray Hz",
+		s.subframes, s.subframe_hz, subframe_hz, s.gray_hz);
+	ESP_LOGI(TAG, "interval %lld..%lld us, jitter %.1f us, transfer max %lld us of %lld us period",
+		(long long)s.interval_min_us, (long long)s.interval_max_us, s.jitter_us,
+		(long long)s.send_max_us, (long long)period);
+	ESP_LOGI(TAG, "late %d, dropped %d: %s", s.late, s.dropped,
+		s.sustained ? "bus sustains this rate" : "bus too slow for this rate");
+	if (stats) *stats = s;
+}
+
+// Back to 1-bit drawing: the panel shows the frame buffer again
+void ssd1306_gray_end(SSD1306_Gray_t * gray)
+{
+	SSD1306_t * dev = gray->dev;
+	for (int page=0; page<dev->_pages; page++) {
+		ssd1306_mark_dirty(dev, page, 0, dev->_width);
+	}
+	ssd1306_present(dev);
+}
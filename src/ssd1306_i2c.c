@@ -7,17 +7,10 @@
 #include "esp_log.h"
 
 #include "ssd1306.h"
+#include "i2c_bus.h"
 
 #define TAG "SSD1306"
 
-#if CONFIG_I2C_PORT_0
-#define I2C_NUM I2C_NUM_0
-#elif CONFIG_I2C_PORT_1
-#define I2C_NUM I2C_NUM_1
-#else
-#define I2C_NUM I2C_NUM_0 // if spi is selected
-#endif
-
 // Copied from gpt
 #ifndef CONFIG_OFFSETX
 #define CONFIG_OFFSETX 0
@@ -31,9 +24,21 @@
 #define I2C_MASTER_FREQ_HZ 400000 // I2C clock of SSD1306 can run at 400 kHz max.
 #define I2C_TICKS_TO_WAIT 100	  // Maximum ticks to wait before issuing a timeout.
 
+// Run a command link with the bus locked at this panel's SCL speed. A bus
+// that stays busy for I2C_TICKS_TO_WAIT fails the transfer without sending it.
+static esp_err_t i2c_transmit(SSD1306_t * dev, i2c_cmd_handle_t cmd)
+{
+	if (I2C_BUS_Begin(dev->_i2c_num, dev->_address, I2C_TICKS_TO_WAIT) != ESP_OK) return ESP_ERR_TIMEOUT;
+	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	I2C_BUS_End(dev->_i2c_num);
+	return res;
+}
+
+// Installs the master driver on dev->_i2c_num (I2C_NUM_0 or I2C_NUM_1), so the
+// panel can have a controller of its own next to other buses.
 void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 {
-	ESP_LOGI(TAG, "Legacy i2c driver is used");
+	ESP_LOGI(TAG, "Legacy i2c driver is used, port=%d sda=%d scl=%d", dev->_i2c_num, sda, scl);
 	i2c_config_t i2c_config = {
 		.mode = I2C_MODE_MASTER,
 		.sda_io_num = sda,
@@ -42,8 +47,8 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 		.scl_pullup_en = GPIO_PULLUP_ENABLE,
 		.master.clk_speed = I2C_MASTER_FREQ_HZ
 	};
-	ESP_ERROR_CHECK(i2c_param_config(I2C_NUM, &i2c_config));
-	ESP_ERROR_CHECK(i2c_driver_install(I2C_NUM, I2C_MODE_MASTER, 0, 0, 0));
+	ESP_ERROR_CHECK(i2c_param_config(dev->_i2c_num, &i2c_config));
+	ESP_ERROR_CHECK(i2c_driver_install(dev->_i2c_num, I2C_MODE_MASTER, 0, 0, 0));
 
 	if (reset >= 0) {
 		//gpio_pad_select_gpio(reset);
@@ -56,7 +61,6 @@ void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
 
 	dev->_address = I2C_ADDRESS;
 	dev->_flip = false;
-	dev->_i2c_num = I2C_NUM;
 }
 
 void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address)
@@ -72,8 +76,8 @@ void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t
 		.scl_pullup_en = GPIO_PULLUP_ENABLE,
 		.master.clk_speed = I2C_MASTER_FREQ_HZ
 	};
-	ESP_ERROR_CHECK(i2c_param_config(I2C_NUM, &i2c_config));
-	ESP_ERROR_CHECK(i2c_driver_install(I2C_NUM, I2C_MODE_MASTER, 0, 0, 0));
+	ESP_ERROR_CHECK(i2c_param_config(i2c_num, &i2c_config));
+	ESP_ERROR_CHECK(i2c_driver_install(i2c_num, I2C_MODE_MASTER, 0, 0, 0));
 #endif
 
 	if (reset >= 0) {
@@ -127,12 +131,10 @@ void i2c_init(SSD1306_t * dev, int width, int height) {
 	i2c_master_write_byte(cmd, OLED_CMD_SET_VCOMH_DESELCT, true);		// DB
 	i2c_master_write_byte(cmd, 0x40, true);
 	i2c_master_write_byte(cmd, OLED_CMD_SET_MEMORY_ADDR_MODE, true);	// 20
-	//i2c_master_write_byte(cmd, OLED_CMD_SET_HORI_ADDR_MODE, true);	// 00
-	i2c_master_write_byte(cmd, OLED_CMD_SET_PAGE_ADDR_MODE, true);		// 02
-	// Set Lower Column Start Address for Page Addressing Mode
-	i2c_master_write_byte(cmd, 0x00, true);
-	// Set Higher Column Start Address for Page Addressing Mode
-	i2c_master_write_byte(cmd, 0x10, true);
+	// Horizontal mode: every write sets a column/page window, so a full
+	// frame can be streamed in one data transaction
+	i2c_master_write_byte(cmd, OLED_CMD_SET_HORI_ADDR_MODE, true);		// 00
+	//i2c_master_write_byte(cmd, OLED_CMD_SET_PAGE_ADDR_MODE, true);	// 02
 	i2c_master_write_byte(cmd, OLED_CMD_SET_CHARGE_PUMP, true);			// 8D
 	i2c_master_write_byte(cmd, 0x14, true);
 	i2c_master_write_byte(cmd, OLED_CMD_DEACTIVE_SCROLL, true);			// 2E
@@ -141,7 +143,7 @@ void i2c_init(SSD1306_t * dev, int width, int height) {
 
 	i2c_master_stop(cmd);
 
-	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_transmit(dev, cmd);
 	if (res == ESP_OK) {
 		ESP_LOGI(TAG, "OLED configured successfully");
 	} else {
@@ -151,50 +153,81 @@ void i2c_init(SSD1306_t * dev, int width, int height) {
 }
 
 
-void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width) {
-	if (page >= dev->_pages) return;
-	if (seg >= dev->_width) return;
+// Address a column/page window (horizontal mode) in an open command link.
+// Commands are sent one per control byte (Co=1) so the data stream can follow
+// in the same transaction.
+static void i2c_write_window(i2c_cmd_handle_t cmd, int col_start, int col_end, int page_start, int page_end)
+{
+	const uint8_t window[6] = {
+		OLED_CMD_SET_COLUMN_RANGE, col_start, col_end,	// 21
+		OLED_CMD_SET_PAGE_RANGE, page_start, page_end	// 22
+	};
+	for (int i = 0; i < 6; i++) {
+		i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true);	// 80
+		i2c_master_write_byte(cmd, window[i], true);
+	}
+}
 
-	int _seg = seg + CONFIG_OFFSETX;
-	uint8_t columLow = _seg & 0x0F;
-	uint8_t columHigh = (_seg >> 4) & 0x0F;
+bool i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width) {
+	if (page >= dev->_pages) return true;
+	if (seg >= dev->_width) return true;
 
 	int _page = page;
 	if (dev->_flip) {
 		_page = (dev->_pages - page) - 1;
 	}
+	return i2c_display_ram(dev, _page + dev->_ramBase, seg, images, width);
+}
+
+// Write to a GDDRAM page as the controller numbers it (0-7, whatever the panel
+// height), without the flip mapping of i2c_display_image. False if the
+// transfer failed.
+bool i2c_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width) {
+	if (ram_page < 0 || ram_page >= SSD1306_GDDRAM_PAGES) return true;
+	if (seg >= dev->_width) return true;
+
+	int _seg = seg + CONFIG_OFFSETX;
 
 	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 	i2c_master_start(cmd);
 	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
-
-	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_STREAM, true);
-	// Set Lower Column Start Address for Page Addressing Mode
-	i2c_master_write_byte(cmd, (0x00 + columLow), true);
-	// Set Higher Column Start Address for Page Addressing Mode
-	i2c_master_write_byte(cmd, (0x10 + columHigh), true);
-	// Set Page Start Address for Page Addressing Mode
-	i2c_master_write_byte(cmd, 0xB0 | _page, true);
-
+	i2c_write_window(cmd, _seg, _seg + width - 1, ram_page, ram_page);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_DATA_STREAM, true);
+	i2c_master_write(cmd, images, width, true);
 	i2c_master_stop(cmd);
-	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+
+	esp_err_t res = i2c_transmit(dev, cmd);
 	if (res != ESP_OK) {
 		ESP_LOGE(TAG, "Image command failed. code: 0x%.2X", res);
 	}
 	i2c_cmd_link_delete(cmd);
+	return res == ESP_OK;
+}
 
-	cmd = i2c_cmd_link_create();
+// Whole frame in one transaction: window over all pages, then pages[0..] as a
+// single data stream (1024 bytes on a 128x64 panel). False if it failed.
+bool i2c_display_frame(SSD1306_t * dev, const uint8_t * const pages[]) {
+	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 	i2c_master_start(cmd);
 	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+	i2c_write_window(cmd, CONFIG_OFFSETX, CONFIG_OFFSETX + dev->_width - 1, dev->_ramBase, dev->_ramBase + dev->_pages - 1);
 	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_DATA_STREAM, true);
-	i2c_master_write(cmd, images, width, true);
+	for (int _page = 0; _page < dev->_pages; _page++) {
+		// Flipped panels store page 0 at the bottom
+		int page = _page;
+		if (dev->_flip) {
+			page = (dev->_pages - _page) - 1;
+		}
+		i2c_master_write(cmd, pages[page], dev->_width, true);
+	}
 	i2c_master_stop(cmd);
 
-	res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_transmit(dev, cmd);
 	if (res != ESP_OK) {
-		ESP_LOGE(TAG, "Image command failed. code: 0x%.2X", res);
+		ESP_LOGE(TAG, "Frame command failed. code: 0x%.2X", res);
 	}
 	i2c_cmd_link_delete(cmd);
+	return res == ESP_OK;
 }
 
 void i2c_contrast(SSD1306_t * dev, int contrast) {
@@ -210,7 +243,7 @@ void i2c_contrast(SSD1306_t * dev, int contrast) {
 	i2c_master_write_byte(cmd, _contrast, true);
 	i2c_master_stop(cmd);
 
-	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_transmit(dev, cmd);
 	if (res != ESP_OK) {
 		ESP_LOGE(TAG, "Contrast command failed. code: 0x%.2X", res);
 	}
@@ -291,10 +324,80 @@ void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll) {
 
 	i2c_master_stop(cmd);
 
-	esp_err_t res = i2c_master_cmd_begin(dev->_i2c_num, cmd, I2C_TICKS_TO_WAIT);
+	esp_err_t res = i2c_transmit(dev, cmd);
 	if (res != ESP_OK) {
 		ESP_LOGE(TAG, "Scroll command failed. code: 0x%.2X", res);
 	}
 	i2c_cmd_link_delete(cmd);
 }
 
+// GDDRAM line (0-63) shown on the top row: a single command byte
+void i2c_start_line(SSD1306_t * dev, int line) {
+	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+	i2c_master_start(cmd);
+	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true); // 80
+	i2c_master_write_byte(cmd, OLED_CMD_SET_DISPLAY_START_LINE | (line & 0x3F), true); // 40-7F
+	i2c_master_stop(cmd);
+
+	esp_err_t res = i2c_transmit(dev, cmd);
+	if (res != ESP_OK) {
+		ESP_LOGE(TAG, "Start line command failed. code: 0x%.2X", res);
+	}
+	i2c_cmd_link_delete(cmd);
+}
+
+// Shift GDDRAM pages [start, end] by one column. Unlike the continuous scroll
+// this is a one-shot move; consecutive calls need 2 frame periods between them
+// (ssd1306_content_scroll_left keeps them apart).
+void i2c_content_scroll(SSD1306_t * dev, int start, int end, bool left) {
+	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+	i2c_master_start(cmd);
+
+	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_STREAM, true); // 00
+	i2c_master_write_byte(cmd, OLED_CMD_DEACTIVE_SCROLL, true); // 2E
+	if (left) {
+		i2c_master_write_byte(cmd, OLED_CMD_CONTENT_SCROLL_LEFT, true); // 2D
+	} else {
+		i2c_master_write_byte(cmd, OLED_CMD_CONTENT_SCROLL_RIGHT, true); // 2C
+	}
+	i2c_master_write_byte(cmd, 0x00, true); // Dummy byte
+	i2c_master_write_byte(cmd, start, true); // Define start page address
+	i2c_master_write_byte(cmd, 0x01, true); // Dummy byte
+	i2c_master_write_byte(cmd, end, true); // Define end page address
+	i2c_master_write_byte(cmd, CONFIG_OFFSETX, true); // Start column
+	i2c_master_write_byte(cmd, CONFIG_OFFSETX + dev->_width - 1, true); // End column
+
+	i2c_master_stop(cmd);
+
+	esp_err_t res = i2c_transmit(dev, cmd);
+	if (res != ESP_OK) {
+		ESP_LOGE(TAG, "Content scroll command failed. code: 0x%.2X", res);
+	}
+	i2c_cmd_link_delete(cmd);
+}
+
+// Bus check for the SCL speed probe: a NOP command must be ACKed and the
+// status byte read back must report the display as on (D6 = 0).
+// Modules without SDA out wiring read back 0xFF; those are checked by ACK only.
+esp_err_t i2c_verify(SSD1306_t * dev) {
+	uint8_t status = 0xFF;
+
+	i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+	i2c_master_start(cmd);
+	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_SINGLE, true); // 80
+	i2c_master_write_byte(cmd, OLED_CMD_NOP, true); // E3
+	i2c_master_start(cmd);
+	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_READ, true);
+	i2c_master_read_byte(cmd, &status, I2C_MASTER_LAST_NACK);
+	i2c_master_stop(cmd);
+
+	esp_err_t res = i2c_transmit(dev, cmd);
+	i2c_cmd_link_delete(cmd);
+	if (res != ESP_OK) return res;
+
+	if (status != 0xFF && (status & 0x40)) return ESP_ERR_INVALID_RESPONSE;
+	return ESP_OK;
+}
@@ -0,0 +1,238 @@
+#include <string.h>
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_layers.h"
+
+// Dirty bits of the words covering columns [seg, seg + width)
+static uint32_t layer_word_mask(int seg, int width)
+{
+	int w1 = seg / 4;
+	int w2 = (seg + width - 1) / 4;
+	int n = w2 - w1 + 1;
+	uint32_t bits = (n >= 32) ? 0xFFFFFFFFu : ((1u << n) - 1);
+	return bits << w1;
+}
+
+static void layer_mark(SSD1306_Layer_t * layer, int page, int seg, int width)
+{
+	if (width <= 0) return;
+	uint32_t bits = layer_word_mask(seg, width);
+	layer->dirty[page] |= bits;
+	layer->used[page] |= bits;
+}
+
+// Make the masked bits of one byte opaque, lit or dark
+static inline void layer_put(SSD1306_Layer_t * layer, int page, int seg, uint8_t mask, bool invert)
+{
+	layer->cover.segs[page][seg] |= mask;
+	if (invert) {
+		layer->ink.segs[page][seg] &= ~mask;
+	} else {
+		layer->ink.segs[page][seg] |= mask;
+	}
+}
+
+// Rows [y1, y2] of one page as a byte mask, in _segs bit order
+static uint8_t layer_row_mask(SSD1306_t * dev, int page, int y1, int y2)
+{
+	int top = y1 - page * 8;
+	int bottom = y2 - page * 8;
+	if (top < 0) top = 0;
+	if (bottom > 7) bottom = 7;
+	uint8_t mask = (uint8_t)((0xFF << top) & (0xFF >> (7 - bottom)));
+	if (dev->_flip) mask = ssd1306_reverse8(mask);
+	return mask;
+}
+
+// Clip a rectangle to the panel; false if nothing is left
+static bool layer_clip(SSD1306_t * dev, int * x1, int * y1, int * x2, int * y2)
+{
+	if (*x1 < 0) *x1 = 0;
+	if (*y1 < 0) *y1 = 0;
+	if (*x2 >= dev->_width) *x2 = dev->_width - 1;
+	if (*y2 >= dev->_pages * 8) *y2 = dev->_pages * 8 - 1;
+	return *x1 <= *x2 && *y1 <= *y2;
+}
+
+// All layers empty and visible, stacked in id order. The whole screen is
+// dirty, so the first compose also clears the frame buffer.
+void ssd1306_layers_init(SSD1306_Layers_t * layers, SSD1306_t * dev)
+{
+	memset(layers, 0, sizeof(SSD1306_Layers_t));
+	layers->dev = dev;
+	for (int i = 0; i < SSD1306_LAYERS; i++) {
+		layers->layer[i].visible = true;
+		layers->order[i] = i;
+	}
+	memset(layers->layer[0].dirty, 0xFF, sizeof(layers->layer[0].dirty));
+}
+
+// Showing or hiding a layer only touches the words it has drawn
+void ssd1306_layer_set_visible(SSD1306_Layers_t * layers, ssd1306_layer_t id, bool visible)
+{
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	if (layer->visible == visible) return;
+	layer->visible = visible;
+	for (int page = 0; page < 8; page++) layer->dirty[page] |= layer->used[page];
+}
+
+// Move a layer to position z (0 = bottom); the others keep their order
+void ssd1306_layer_set_z(SSD1306_Layers_t * layers, ssd1306_layer_t id, int z)
+{
+	if (z < 0) z = 0;
+	if (z >= SSD1306_LAYERS) z = SSD1306_LAYERS - 1;
+	int from = 0;
+	while (layers->order[from] != id) from++;
+	if (from == z) return;
+
+	if (from < z) {
+		memmove(&layers->order[from], &layers->order[from + 1], z - from);
+	} else {
+		memmove(&layers->order[z + 1], &layers->order[z], from - z);
+	}
+	layers->order[z] = id;
+	// Only where this layer has drawn can the stacking make a difference
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	for (int page = 0; page < 8; page++) layer->dirty[page] |= layer->used[page];
+}
+
+// Empty the layer: the layers below show through again
+void ssd1306_layer_clear(SSD1306_Layers_t * layers, ssd1306_layer_t id)
+{
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	memset(&layer->ink, 0, sizeof(layer->ink));
+	memset(&layer->cover, 0, sizeof(layer->cover));
+	for (int page = 0; page < 8; page++) {
+		layer->dirty[page] |= layer->used[page];
+		layer->used[page] = 0;
+	}
+}
+
+// Make a rectangle of the layer transparent
+void ssd1306_layer_erase(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, int width, int height)
+{
+	SSD1306_t * dev = layers->dev;
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	int x1 = xpos, y1 = ypos, x2 = xpos + width - 1, y2 = ypos + height - 1;
+	if (width <= 0 || height <= 0 || !layer_clip(dev, &x1, &y1, &x2, &y2)) return;
+
+	for (int page = y1 / 8; page <= y2 / 8; page++) {
+		uint8_t mask = layer_row_mask(dev, page, y1, y2);
+		for (int seg = x1; seg <= x2; seg++) {
+			layer->cover.segs[page][seg] &= ~mask;
+			layer->ink.segs[page][seg] &= ~mask;
+		}
+		layer_mark(layer, page, x1, x2 - x1 + 1);
+	}
+}
+
+// Opaque 8x8 character cells, as ssd1306_display_text but starting at any column
+void ssd1306_layer_text(SSD1306_Layers_t * layers, ssd1306_layer_t id, int page, int seg, const char * text, int text_len, bool invert)
+{
+	SSD1306_t * dev = layers->dev;
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	if (page < 0 || page >= dev->_pages || seg < 0) return;
+
+	int _seg = seg;
+	for (int i = 0; i < text_len && _seg + 8 <= dev->_width; i++, _seg += 8) {
+		ssd1306_blit_glyph(&layer->ink.segs[page][_seg], ssd1306_glyph((uint8_t)text[i], dev->_flip), invert);
+		memset(&layer->cover.segs[page][_seg], 0xFF, 8);
+	}
+	layer_mark(layer, page, seg, _seg - seg);
+}
+
+// Opaque column bytes, as ssd1306_display_image
+void ssd1306_layer_image(SSD1306_Layers_t * layers, ssd1306_layer_t id, int page, int seg, const uint8_t * images, int width)
+{
+	SSD1306_t * dev = layers->dev;
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	if (page < 0 || page >= dev->_pages) return;
+	if (seg < 0 || seg >= dev->_width) return;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+
+	memcpy(&layer->ink.segs[page][seg], images, width);
+	memset(&layer->cover.segs[page][seg], 0xFF, width);
+	layer_mark(layer, page, seg, width);
+}
+
+// One opaque pixel: lit, or dark (invert) over the layers below
+void _ssd1306_layer_pixel(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, bool invert)
+{
+	SSD1306_t * dev = layers->dev;
+	if (xpos < 0 || xpos >= dev->_width) return;
+	if (ypos < 0 || ypos >= dev->_pages * 8) return;
+	int _page = (ypos / 8);
+	// Flipped pages store row 0 in bit 7
+	int _bits = dev->_flip ? 7 - (ypos % 8) : (ypos % 8);
+	layer_put(&layers->layer[id], _page, xpos, 1 << _bits, invert);
+	layer_mark(&layers->layer[id], _page, xpos, 1);
+}
+
+void _ssd1306_layer_fill_rect(SSD1306_Layers_t * layers, ssd1306_layer_t id, int xpos, int ypos, int width, int height, bool invert)
+{
+	SSD1306_t * dev = layers->dev;
+	SSD1306_Layer_t * layer = &layers->layer[id];
+	int x1 = xpos, y1 = ypos, x2 = xpos + width - 1, y2 = ypos + height - 1;
+	if (width <= 0 || height <= 0 || !layer_clip(dev, &x1, &y1, &x2, &y2)) return;
+
+	for (int page = y1 / 8; page <= y2 / 8; page++) {
+		uint8_t mask = layer_row_mask(dev, page, y1, y2);
+		for (int seg = x1; seg <= x2; seg++) {
+			layer_put(layer, page, seg, mask, invert);
+		}
+		layer_mark(layer, page, x1, x2 - x1 + 1);
+	}
+}
+
+// Rebuild the dirty words of the frame buffer from the visible layers and
+// mark the ones that changed. Returns the number of words rebuilt.
+int _ssd1306_layers_compose(SSD1306_Layers_t * layers)
+{
+	SSD1306_t * dev = layers->dev;
+	SSD1306_Layer_t * stack[SSD1306_LAYERS];
+	int depth = 0;
+	for (int z = 0; z < SSD1306_LAYERS; z++) {
+		SSD1306_Layer_t * layer = &layers->layer[layers->order[z]];
+		if (layer->visible) stack[depth++] = layer;
+	}
+
+	int composed = 0;
+	for (int page = 0; page < dev->_pages; page++) {
+		uint32_t region = 0;
+		for (int i = 0; i < SSD1306_LAYERS; i++) {
+			region |= layers->layer[i].dirty[page];
+			layers->layer[i].dirty[page] = 0;
+		}
+
+		uint8_t * segs = dev->_page[page]._segs;
+		int first = -1, last = -1;
+		while (region) {
+			int w = __builtin_ctz(region);
+			region &= region - 1;
+			uint32_t out = 0;
+			for (int i = 0; i < depth; i++) {
+				out = (out & ~stack[i]->cover.words[page][w]) | stack[i]->ink.words[page][w];
+			}
+			uint32_t old;
+			memcpy(&old, &segs[w * 4], 4);
+			if (out != old) {
+				memcpy(&segs[w * 4], &out, 4);
+				if (first < 0) first = w;
+				last = w;
+			}
+			composed++;
+		}
+		if (first >= 0) ssd1306_mark_dirty(dev, page, first * 4, (last - first + 1) * 4);
+	}
+	layers->composed = composed;
+	return composed;
+}
+
+// Composite what changed and show it
+void ssd1306_layers_show(SSD1306_Layers_t * layers)
+{
+	_ssd1306_layers_compose(layers);
+	ssd1306_present(layers->dev);
+}
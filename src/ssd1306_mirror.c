@@ -0,0 +1,159 @@
+#include <string.h>
+#include <stdio.h>
+
+#include "ssd1306.h"
+#include "ssd1306_mirror.h"
+
+#define MIRROR_MIN_ZERO_RUN 2 // Shorter zero runs stay inside literals (cheaper)
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF
+static uint16_t mirror_crc16(const uint8_t * data, size_t len)
+{
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < len; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static size_t mirror_base64(const uint8_t * in, size_t len, char * out)
+{
+	size_t o = 0;
+	for (size_t i = 0; i < len; i += 3) {
+		uint32_t v = (uint32_t)in[i] << 16;
+		if (i + 1 < len) v |= (uint32_t)in[i + 1] << 8;
+		if (i + 2 < len) v |= in[i + 2];
+		out[o++] = base64_chars[(v >> 18) & 0x3F];
+		out[o++] = base64_chars[(v >> 12) & 0x3F];
+		out[o++] = (i + 1 < len) ? base64_chars[(v >> 6) & 0x3F] : '=';
+		out[o++] = (i + 2 < len) ? base64_chars[v & 0x3F] : '=';
+	}
+	return o;
+}
+
+static size_t mirror_zero_run(uint8_t * out, int run)
+{
+	run--;
+	if (run < 0x40) {
+		out[0] = 0x80 | run;
+		return 1;
+	}
+	out[0] = 0xC0 | (run & 0x3F);
+	out[1] = run >> 6;
+	return 2;
+}
+
+// RLE of the XOR of frame and base (base NULL: the frame itself), trailing zeros omitted
+static size_t mirror_encode(SSD1306_Mirror_t * mirror, const uint8_t * base, uint8_t * out)
+{
+	SSD1306_t * dev = mirror->dev;
+	int total = dev->_pages * 128;
+	uint8_t diff[8 * 128];
+	for (int page = 0; page < dev->_pages; page++) {
+		for (int seg = 0; seg < 128; seg++) {
+			uint8_t wk = dev->_page[page]._segs[seg];
+			diff[page * 128 + seg] = base ? (wk ^ base[page * 128 + seg]) : wk;
+		}
+	}
+	while (total > 0 && diff[total - 1] == 0) total--;
+
+	size_t o = 0;
+	int i = 0;
+	while (i < total) {
+		int zeros = 0;
+		while (i + zeros < total && diff[i + zeros] == 0) zeros++;
+		if (zeros >= MIRROR_MIN_ZERO_RUN) {
+			while (zeros > 0) {
+				int run = zeros > 0x4000 ? 0x4000 : zeros;
+				o += mirror_zero_run(&out[o], run);
+				i += run;
+				zeros -= run;
+			}
+			continue;
+		}
+
+		// Literal up to the next worthwhile zero run
+		int start = i;
+		while (i < total && i - start < 128) {
+			if (diff[i] == 0 && (i + 1 >= total || diff[i + 1] == 0)) break;
+			i++;
+		}
+		out[o++] = (uint8_t)(i - start - 1);
+		memcpy(&out[o], &diff[start], i - start);
+		o += i - start;
+	}
+	return o;
+}
+
+void ssd1306_mirror_stdout(const char * line, size_t len, void * ctx)
+{
+	(void)ctx;
+	fwrite(line, 1, len, stdout);
+	fflush(stdout);
+}
+
+// write NULL: lines go to stdout (the serial console)
+void ssd1306_mirror_init(SSD1306_Mirror_t * mirror, SSD1306_t * dev, ssd1306_mirror_write_t write, void * ctx)
+{
+	memset(mirror, 0, sizeof(SSD1306_Mirror_t));
+	mirror->dev = dev;
+	mirror->write = write ? write : ssd1306_mirror_stdout;
+	mirror->ctx = ctx;
+	mirror->keyframe_interval = SSD1306_MIRROR_KEYFRAME_INTERVAL;
+	mirror->since_key = -1;
+}
+
+// Send a keyframe with the next update, changed or not (e.g. a viewer attached)
+void ssd1306_mirror_keyframe(SSD1306_Mirror_t * mirror)
+{
+	mirror->since_key = -1;
+}
+
+// Send what changed since the last packet; call after ssd1306_present or
+// ssd1306_flush. Returns true if a packet was written.
+bool ssd1306_mirror_update(SSD1306_Mirror_t * mirror)
+{
+	SSD1306_t * dev = mirror->dev;
+	bool key = mirror->since_key < 0 || mirror->since_key >= mirror->keyframe_interval;
+	if (!key) {
+		bool changed = false;
+		for (int page = 0; page < dev->_pages && !changed; page++) {
+			changed = memcmp(mirror->last[page], dev->_page[page]._segs, 128) != 0;
+		}
+		if (!changed) return false;
+	}
+
+	uint8_t packet[SSD1306_MIRROR_MAX_PACKET];
+	size_t len = 0;
+	packet[len++] = key ? 'K' : 'D';
+	packet[len++] = mirror->seq & 0xFF;
+	packet[len++] = mirror->seq >> 8;
+	packet[len++] = dev->_pages;
+	packet[len++] = dev->_flip ? 0x01 : 0x00;
+	len += mirror_encode(mirror, key ? NULL : &mirror->last[0][0], &packet[len]);
+	uint16_t crc = mirror_crc16(packet, len);
+	packet[len++] = crc & 0xFF;
+	packet[len++] = crc >> 8;
+
+	char line[SSD1306_MIRROR_MAX_LINE];
+	size_t n = strlen(SSD1306_MIRROR_PREFIX);
+	memcpy(line, SSD1306_MIRROR_PREFIX, n);
+	n += mirror_base64(packet, len, &line[n]);
+	line[n++] = '\n';
+	line[n] = '\0';
+	mirror->write(line, n, mirror->ctx);
+
+	for (int page = 0; page < dev->_pages; page++) {
+		memcpy(mirror->last[page], dev->_page[page]._segs, 128);
+	}
+	mirror->seq++;
+	mirror->since_key = key ? 1 : mirror->since_key + 1;
+	mirror->packets++;
+	mirror->bytes += n;
+	return true;
+}
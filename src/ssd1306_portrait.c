@@ -0,0 +1,126 @@
+#include <string.h>
+
+#include "ssd1306.h"
+#include "ssd1306_bitops.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_portrait.h"
+
+// Mark the tiles covering logical columns [seg, seg + width) of one page
+static void portrait_mark(SSD1306_Portrait_t * canvas, int page, int seg, int width)
+{
+	if (width <= 0) return;
+	for (int b = seg / 8; b <= (seg + width - 1) / 8; b++) {
+		canvas->dirty[page] |= (uint8_t)(1 << b);
+	}
+}
+
+static void portrait_mark_all(SSD1306_Portrait_t * canvas)
+{
+	memset(canvas->dirty, (1 << (canvas->width / 8)) - 1, sizeof(canvas->dirty));
+}
+
+void ssd1306_portrait_init(SSD1306_Portrait_t * canvas, SSD1306_t * dev, ssd1306_portrait_t rotation)
+{
+	memset(canvas, 0, sizeof(SSD1306_Portrait_t));
+	canvas->dev = dev;
+	canvas->rotation = rotation;
+	canvas->width = dev->_pages * 8;
+	portrait_mark_all(canvas);
+}
+
+// Only the mapping changes; every tile is rotated again on the next show
+void ssd1306_portrait_set_rotation(SSD1306_Portrait_t * canvas, ssd1306_portrait_t rotation)
+{
+	if (canvas->rotation == rotation) return;
+	canvas->rotation = rotation;
+	portrait_mark_all(canvas);
+}
+
+void ssd1306_portrait_clear(SSD1306_Portrait_t * canvas, bool invert)
+{
+	memset(canvas->segs, invert ? 0xFF : 0x00, sizeof(canvas->segs));
+	portrait_mark_all(canvas);
+}
+
+// One line of text per logical page: 8 characters (4 on a 32-pixel panel)
+void ssd1306_portrait_text(SSD1306_Portrait_t * canvas, int page, const char * text, int text_len, bool invert)
+{
+	if (page < 0 || page >= SSD1306_PORTRAIT_PAGES) return;
+	int _text_len = text_len;
+	if (_text_len > canvas->width / 8) _text_len = canvas->width / 8;
+
+	for (int i = 0; i < _text_len; i++) {
+		ssd1306_blit_glyph(&canvas->segs[page][i * 8], ssd1306_glyph((uint8_t)text[i], false), invert);
+	}
+	portrait_mark(canvas, page, 0, _text_len * 8);
+}
+
+// Column bytes as for ssd1306_display_image, in the logical layout
+void ssd1306_portrait_image(SSD1306_Portrait_t * canvas, int page, int seg, const uint8_t * images, int width)
+{
+	if (page < 0 || page >= SSD1306_PORTRAIT_PAGES) return;
+	if (seg < 0 || seg >= canvas->width) return;
+	if (seg + width > canvas->width) width = canvas->width - seg;
+	memcpy(&canvas->segs[page][seg], images, width);
+	portrait_mark(canvas, page, seg, width);
+}
+
+void _ssd1306_portrait_pixel(SSD1306_Portrait_t * canvas, int xpos, int ypos, bool invert)
+{
+	if (xpos < 0 || xpos >= canvas->width) return;
+	if (ypos < 0 || ypos >= SSD1306_PORTRAIT_HEIGHT) return;
+	int _page = ypos / 8;
+	uint8_t wk1 = 1 << (ypos % 8);
+	if (invert) {
+		canvas->segs[_page][xpos] &= ~wk1;
+	} else {
+		canvas->segs[_page][xpos] |= wk1;
+	}
+	portrait_mark(canvas, _page, xpos, 1);
+}
+
+// Logical tile (page, block b) to the frame buffer. After the transpose, t[k]
+// holds logical row 8*page+k with bit c = column 8b+c; that row is one panel
+// column and the tile's columns run across one panel page.
+//   CW:  panel column 8*page+k, page (width/8-1-b), column c at bit 7-c
+//   CCW: panel column 127-8*page-k, page b, column c at bit c
+// Flipped panels store every byte bit-reversed, which swaps the two cases.
+static void portrait_tile(SSD1306_Portrait_t * canvas, int page, int b)
+{
+	SSD1306_t * dev = canvas->dev;
+	uint8_t t[8];
+	ssd1306_transpose8(&canvas->segs[page][b * 8], t);
+
+	bool reverse = (canvas->rotation == PORTRAIT_CW) != dev->_flip;
+	if (reverse) {
+		uint32_t w[2];
+		memcpy(w, t, 8);
+		w[0] = ssd1306_reverse8x4(w[0]);
+		w[1] = ssd1306_reverse8x4(w[1]);
+		memcpy(t, w, 8);
+	}
+
+	if (canvas->rotation == PORTRAIT_CW) {
+		int _page = canvas->width / 8 - 1 - b;
+		memcpy(&dev->_page[_page]._segs[page * 8], t, 8);
+		ssd1306_mark_dirty(dev, _page, page * 8, 8);
+	} else {
+		int _seg = SSD1306_PORTRAIT_HEIGHT - 8 - page * 8;
+		uint8_t * segs = &dev->_page[b]._segs[_seg];
+		for (int k = 0; k < 8; k++) segs[7 - k] = t[k];
+		ssd1306_mark_dirty(dev, b, _seg, 8);
+	}
+}
+
+// Rotate the changed tiles into the frame buffer and show them
+void ssd1306_portrait_show(SSD1306_Portrait_t * canvas)
+{
+	for (int page = 0; page < SSD1306_PORTRAIT_PAGES; page++) {
+		uint8_t dirty = canvas->dirty[page];
+		for (int b = 0; dirty; b++, dirty >>= 1) {
+			if (dirty & 1) portrait_tile(canvas, page, b);
+		}
+		canvas->dirty[page] = 0;
+	}
+	ssd1306_present(canvas->dev);
+}
@@ -1,9 +1,12 @@
 #include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 
 #include "ssd1306.h"
@@ -39,6 +42,40 @@ void spi_clock_speed(int speed) {
 	clock_speed_hz = speed;
 }
 
+// DC level travels in the transaction's user field: bit 0 = level, bit 1 =
+// valid, DC pin above. Transactions without it (user NULL) leave DC alone.
+#define SPI_USER_DC(dc, level) ((void *)(intptr_t)(((dc) << 2) | 2 | (level)))
+
+static void IRAM_ATTR spi_pre_transfer_callback(spi_transaction_t * t)
+{
+	intptr_t user = (intptr_t)t->user;
+	if (user & 2) gpio_set_level(user >> 2, user & 1);
+}
+
+static void spi_add_panel(SSD1306_t * dev, int16_t cs, int16_t dc)
+{
+	spi_device_interface_config_t devcfg;
+	memset( &devcfg, 0, sizeof( spi_device_interface_config_t ) );
+	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
+	devcfg.clock_speed_hz = clock_speed_hz;
+	devcfg.spics_io_num = cs;
+	devcfg.queue_size = SSD1306_SPI_QUEUE;
+	devcfg.pre_cb = spi_pre_transfer_callback;
+
+	spi_device_handle_t spi_device_handle;
+	esp_err_t ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
+	ESP_LOGI(TAG, "spi_bus_add_device=%d",ret);
+	assert(ret==ESP_OK);
+
+	dev->_spi = calloc(1, sizeof(SSD1306_Spi_t));
+	assert(dev->_spi != NULL);
+
+	dev->_dc = dc;
+	dev->_address = SPI_ADDRESS;
+	dev->_flip = false;
+	dev->_spi_device_handle = spi_device_handle;
+}
+
 void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, int16_t dc, int16_t reset)
 {
 	esp_err_t ret;
@@ -74,28 +111,12 @@ void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, in
 	ESP_LOGI(TAG, "spi_bus_initialize=%d",ret);
 	assert(ret==ESP_OK);
 
-	spi_device_interface_config_t devcfg;
-	memset( &devcfg, 0, sizeof( spi_device_interface_config_t ) );
-	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
-	devcfg.clock_speed_hz = clock_speed_hz;
-	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
-
-	spi_device_handle_t spi_device_handle;
-	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
-	ESP_LOGI(TAG, "spi_bus_add_device=%d",ret);
-	assert(ret==ESP_OK);
-
-	dev->_dc = dc;
-	dev->_address = SPI_ADDRESS;
-	dev->_flip = false;
-	dev->_spi_device_handle = spi_device_handle;
+	spi_add_panel(dev, cs, dc);
 }
 
 void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 {
 	ESP_LOGW(TAG, "Will not install spi master driver");
-	esp_err_t ret;
 
 	gpio_reset_pin( cs );
 	gpio_set_direction( cs, GPIO_MODE_OUTPUT );
@@ -125,30 +146,16 @@ void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 	};
 
 	ESP_LOGI(TAG, "SPI HOST_ID=%d", HOST_ID);
-	ret = spi_bus_initialize( HOST_ID, &spi_bus_config, SPI_DMA_CH_AUTO );
+	esp_err_t ret = spi_bus_initialize( HOST_ID, &spi_bus_config, SPI_DMA_CH_AUTO );
 	ESP_LOGI(TAG, "spi_bus_initialize=%d",ret);
 	assert(ret==ESP_OK);
 #endif
 
-	spi_device_interface_config_t devcfg;
-	memset( &devcfg, 0, sizeof( spi_device_interface_config_t ) );
-	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
-	devcfg.clock_speed_hz = clock_speed_hz;
-	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
-
-	spi_device_handle_t spi_device_handle;
-	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
-	ESP_LOGI(TAG, "spi_bus_add_device=%d",ret);
-	assert(ret==ESP_OK);
-
-	dev->_dc = dc;
-	dev->_address = SPI_ADDRESS;
-	dev->_flip = false;
-	dev->_spi_device_handle = spi_device_handle;
+	spi_add_panel(dev, cs, dc);
 }
 
 
+// Blocking single transfer; DC is not touched (set it beforehand)
 bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength )
 {
 	spi_transaction_t SPITransaction;
@@ -157,29 +164,93 @@ bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* D
 		memset( &SPITransaction, 0, sizeof( spi_transaction_t ) );
 		SPITransaction.length = DataLength * 8;
 		SPITransaction.tx_buffer = Data;
-		spi_device_transmit( SPIHandle, &SPITransaction );
+		esp_err_t ret = spi_device_transmit( SPIHandle, &SPITransaction );
+		if (ret != ESP_OK) {
+			ESP_LOGE(TAG, "spi_device_transmit failed: %s", esp_err_to_name(ret));
+			return false;
+		}
 	}
 
 	return true;
 }
 
+// Collect the oldest queued transaction. Its slot is free again either way.
+static esp_err_t spi_collect(SSD1306_t * dev)
+{
+	spi_transaction_t * done;
+	esp_err_t ret = spi_device_get_trans_result(dev->_spi_device_handle, &done, portMAX_DELAY);
+	dev->_spi->_pending--;
+	if (ret != ESP_OK) {
+		ESP_LOGE(TAG, "spi_device_get_trans_result failed: %s", esp_err_to_name(ret));
+	}
+	return ret;
+}
+
+// Wait until every queued segment has been sent; their buffers may then change
+static esp_err_t spi_wait(SSD1306_t * dev)
+{
+	esp_err_t ret = ESP_OK;
+	while (dev->_spi->_pending > 0) {
+		esp_err_t res = spi_collect(dev);
+		if (ret == ESP_OK) ret = res;
+	}
+	return ret;
+}
+
+// Queue one command or data segment from the pool. Up to 4 bytes are copied
+// into the descriptor; longer buffers must stay untouched until spi_wait().
+// A segment that cannot be queued leaves its slot for the next one.
+static esp_err_t spi_queue(SSD1306_t * dev, const uint8_t * bytes, size_t len, int level)
+{
+	if (len == 0) return ESP_OK;
+	SSD1306_Spi_t * spi = dev->_spi;
+	esp_err_t ret = ESP_OK;
+	if (spi->_pending == SSD1306_SPI_QUEUE) {
+		// Results come back in order, so this frees the slot at _next
+		ret = spi_collect(dev);
+	}
+
+	spi_transaction_t * t = &spi->_trans[spi->_next];
+	memset(t, 0, sizeof(spi_transaction_t));
+	t->length = len * 8;
+	t->user = SPI_USER_DC(dev->_dc, level);
+	if (len <= sizeof(t->tx_data)) {
+		memcpy(t->tx_data, bytes, len);
+		t->flags = SPI_TRANS_USE_TXDATA;
+	} else {
+		t->tx_buffer = bytes;
+	}
+	esp_err_t res = spi_device_queue_trans(dev->_spi_device_handle, t, portMAX_DELAY);
+	if (res != ESP_OK) {
+		ESP_LOGE(TAG, "spi_device_queue_trans failed: %s", esp_err_to_name(res));
+		return res;
+	}
+	spi->_next = (spi->_next + 1) % SSD1306_SPI_QUEUE;
+	spi->_pending++;
+	return ret;
+}
+
+// Queue one segment, wait until everything queued is sent, and report any error
+static bool spi_send(SSD1306_t * dev, const uint8_t * bytes, size_t len, int level)
+{
+	esp_err_t ret = spi_queue(dev, bytes, len, level);
+	esp_err_t res = spi_wait(dev);
+	return ret == ESP_OK && res == ESP_OK;
+}
+
 bool spi_master_write_commands(SSD1306_t * dev, const uint8_t * Commands, size_t DataLength )
 {
-	gpio_set_level( dev->_dc, SPI_COMMAND_MODE );
-	return spi_master_write_byte( dev->_spi_device_handle, Commands, DataLength );
+	return spi_send(dev, Commands, DataLength, SPI_COMMAND_MODE);
 }
 
 bool spi_master_write_command(SSD1306_t * dev, uint8_t Command )
 {
-	static uint8_t CommandByte = 0;
-	CommandByte = Command;
-	return spi_master_write_commands( dev, &CommandByte, 1 );
+	return spi_master_write_commands( dev, &Command, 1 );
 }
 
 bool spi_master_write_data(SSD1306_t * dev, const uint8_t* Data, size_t DataLength )
 {
-	gpio_set_level( dev->_dc, SPI_DATA_MODE );
-	return spi_master_write_byte( dev->_spi_device_handle, Data, DataLength );
+	return spi_send(dev, Data, DataLength, SPI_DATA_MODE);
 }
 
 
@@ -190,65 +261,93 @@ void spi_init(SSD1306_t * dev, int width, int height)
 	dev->_pages = 8;
 	if (dev->_height == 32) dev->_pages = 4;
 
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_OFF);			// AE
-	spi_master_write_command(dev, OLED_CMD_SET_MUX_RATIO);			// A8
-	if (dev->_height == 64) spi_master_write_command(dev, 0x3F);
-	if (dev->_height == 32) spi_master_write_command(dev, 0x1F);
-	spi_master_write_command(dev, OLED_CMD_SET_DISPLAY_OFFSET);		// D3
-	spi_master_write_command(dev, 0x00);
-	spi_master_write_command(dev, OLED_CONTROL_BYTE_DATA_STREAM);	// 40
+	// Whole sequence in one command transaction
+	uint8_t commands[32];
+	int n = 0;
+	commands[n++] = OLED_CMD_DISPLAY_OFF;				// AE
+	commands[n++] = OLED_CMD_SET_MUX_RATIO;				// A8
+	commands[n++] = dev->_height - 1;					// 3F or 1F
+	commands[n++] = OLED_CMD_SET_DISPLAY_OFFSET;		// D3
+	commands[n++] = 0x00;
+	commands[n++] = OLED_CMD_SET_DISPLAY_START_LINE;	// 40
 	if (dev->_flip) {
-		spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP_0);	// A0
+		commands[n++] = OLED_CMD_SET_SEGMENT_REMAP_0;	// A0
 	} else {
-		spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP_1);	// A1
+		commands[n++] = OLED_CMD_SET_SEGMENT_REMAP_1;	// A1
 	}
-	//spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP);		// A1
-	spi_master_write_command(dev, OLED_CMD_SET_COM_SCAN_MODE);		// C8
-	spi_master_write_command(dev, OLED_CMD_SET_DISPLAY_CLK_DIV);	// D5
-	spi_master_write_command(dev, 0x80);
-	spi_master_write_command(dev, OLED_CMD_SET_COM_PIN_MAP);		// DA
-	if (dev->_height == 64) spi_master_write_command(dev, 0x12);
-	if (dev->_height == 32) spi_master_write_command(dev, 0x02);
-	spi_master_write_command(dev, OLED_CMD_SET_CONTRAST);			// 81
-	spi_master_write_command(dev, 0xFF);
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_RAM);			// A4
-	spi_master_write_command(dev, OLED_CMD_SET_VCOMH_DESELCT);		// DB
-	spi_master_write_command(dev, 0x40);
-	spi_master_write_command(dev, OLED_CMD_SET_MEMORY_ADDR_MODE);	// 20
-	//spi_master_write_command(dev, OLED_CMD_SET_HORI_ADDR_MODE);	// 00
-	spi_master_write_command(dev, OLED_CMD_SET_PAGE_ADDR_MODE);		// 02
-	// Set Lower Column Start Address for Page Addressing Mode
-	spi_master_write_command(dev, 0x00);
-	// Set Higher Column Start Address for Page Addressing Mode
-	spi_master_write_command(dev, 0x10);
-	spi_master_write_command(dev, OLED_CMD_SET_CHARGE_PUMP);		// 8D
-	spi_master_write_command(dev, 0x14);
-	spi_master_write_command(dev, OLED_CMD_DEACTIVE_SCROLL);		// 2E
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_NORMAL);			// A6
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_ON);				// AF
+	commands[n++] = OLED_CMD_SET_COM_SCAN_MODE;			// C8
+	commands[n++] = OLED_CMD_SET_DISPLAY_CLK_DIV;		// D5
+	commands[n++] = 0x80;
+	commands[n++] = OLED_CMD_SET_COM_PIN_MAP;			// DA
+	commands[n++] = (dev->_height == 64) ? 0x12 : 0x02;
+	commands[n++] = OLED_CMD_SET_CONTRAST;				// 81
+	commands[n++] = 0xFF;
+	commands[n++] = OLED_CMD_DISPLAY_RAM;				// A4
+	commands[n++] = OLED_CMD_SET_VCOMH_DESELCT;			// DB
+	commands[n++] = 0x40;
+	commands[n++] = OLED_CMD_SET_MEMORY_ADDR_MODE;		// 20
+	commands[n++] = OLED_CMD_SET_PAGE_ADDR_MODE;		// 02
+	commands[n++] = 0x00; // Lower column start address for page addressing mode
+	commands[n++] = 0x10; // Higher column start address for page addressing mode
+	commands[n++] = OLED_CMD_SET_CHARGE_PUMP;			// 8D
+	commands[n++] = 0x14;
+	commands[n++] = OLED_CMD_DEACTIVE_SCROLL;			// 2E
+	commands[n++] = OLED_CMD_DISPLAY_NORMAL;			// A6
+	commands[n++] = OLED_CMD_DISPLAY_ON;				// AF
+	spi_master_write_commands(dev, commands, n);
 }
 
 
-void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+bool spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
 {
-	if (page >= dev->_pages) return;
-	if (seg >= dev->_width) return;
-
-	int _seg = seg + CONFIG_OFFSETX;
-	uint8_t columLow = _seg & 0x0F;
-	uint8_t columHigh = (_seg >> 4) & 0x0F;
+	if (page >= dev->_pages) return true;
+	if (seg >= dev->_width) return true;
 
 	int _page = page;
 	if (dev->_flip) {
 		_page = (dev->_pages - page) - 1;
 	}
+	return spi_display_ram(dev, _page + dev->_ramBase, seg, images, width);
+}
 
-	// Set Lower Column Start Address for Page Addressing Mode, Higher Column Start Address for Page Addressing Mode and Page Start Address for Page Addressing Mode
-	uint8_t commands[3] = { 0x00 + columLow, 0x10 + columHigh, 0xB0 | _page };
-	spi_master_write_commands(dev, commands, 3);
+// Write to a GDDRAM page as the controller numbers it (0-7, whatever the panel
+// height), without the flip mapping of spi_display_image. False if any
+// segment failed.
+bool spi_display_ram(SSD1306_t * dev, int ram_page, int seg, const uint8_t * images, int width)
+{
+	if (ram_page < 0 || ram_page >= SSD1306_GDDRAM_PAGES) return true;
+	if (seg >= dev->_width) return true;
 
-	spi_master_write_data(dev, images, width);
+	int _seg = seg + CONFIG_OFFSETX;
+	uint8_t columLow = _seg & 0x0F;
+	uint8_t columHigh = (_seg >> 4) & 0x0F;
 
+	// Set Lower Column Start Address for Page Addressing Mode, Higher Column Start Address for Page Addressing Mode and Page Start Address for Page Addressing Mode
+	uint8_t commands[3] = { 0x00 + columLow, 0x10 + columHigh, 0xB0 | ram_page };
+	// No data without its address
+	if (spi_queue(dev, commands, 3, SPI_COMMAND_MODE) != ESP_OK) {
+		spi_wait(dev);
+		return false;
+	}
+	return spi_send(dev, images, width, SPI_DATA_MODE);
+}
+
+// All pages queued back-to-back (address + data per page), one wait at the end.
+// Stops queuing at the first failure; false if the frame did not all go out.
+bool spi_display_frame(SSD1306_t * dev, const uint8_t * const pages[])
+{
+	esp_err_t ret = ESP_OK;
+	for (int page = 0; page < dev->_pages && ret == ESP_OK; page++) {
+		int _page = page;
+		if (dev->_flip) {
+			_page = (dev->_pages - page) - 1;
+		}
+		uint8_t commands[3] = { 0x00 + (CONFIG_OFFSETX & 0x0F), 0x10 + ((CONFIG_OFFSETX >> 4) & 0x0F), 0xB0 | (_page + dev->_ramBase) };
+		ret = spi_queue(dev, commands, 3, SPI_COMMAND_MODE);
+		if (ret == ESP_OK) ret = spi_queue(dev, pages[page], dev->_width, SPI_DATA_MODE);
+	}
+	esp_err_t res = spi_wait(dev);
+	return ret == ESP_OK && res == ESP_OK;
 }
 
 void spi_contrast(SSD1306_t * dev, int contrast) {
@@ -260,6 +359,12 @@ void spi_contrast(SSD1306_t * dev, int contrast) {
 	spi_master_write_command(dev, _contrast);
 }
 
+// GDDRAM line (0-63) shown on the top row: a single command byte
+void spi_start_line(SSD1306_t * dev, int line)
+{
+	spi_master_write_command(dev, OLED_CMD_SET_DISPLAY_START_LINE | (line & 0x3F));	// 40-7F
+}
+
 void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 {
 
@@ -325,3 +430,18 @@ void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 		spi_master_write_command(dev, OLED_CMD_DEACTIVE_SCROLL);	// 2E
 	}
 }
+
+void spi_content_scroll(SSD1306_t * dev, int start, int end, bool left)
+{
+	uint8_t commands[8] = {
+		OLED_CMD_DEACTIVE_SCROLL, // 2E
+		left ? OLED_CMD_CONTENT_SCROLL_LEFT : OLED_CMD_CONTENT_SCROLL_RIGHT, // 2D/2C
+		0x00, // Dummy byte
+		start, // Define start page address
+		0x01, // Dummy byte
+		end, // Define end page address
+		CONFIG_OFFSETX, // Start column
+		CONFIG_OFFSETX + dev->_width - 1 // End column
+	};
+	spi_master_write_commands(dev, commands, 8);
+}
@@ -0,0 +1,227 @@
+#include <string.h>
+#include <math.h>
+
+#include "ssd1306.h"
+#include "ssd1306_glyphs.h"
+#include "ssd1306_widgets.h"
+
+static void widget_init(SSD1306_Widget_t * w, ssd1306_widget_type_t type)
+{
+	memset(w, 0, sizeof(SSD1306_Widget_t));
+	w->type = type;
+	w->scale = 1.0f;
+}
+
+void ssd1306_widget_label(SSD1306_Widget_t * w, int page, int col, const char * text)
+{
+	widget_init(w, WIDGET_LABEL);
+	w->page = page;
+	w->col = col;
+	w->chars = strlen(text);
+	w->text = text;
+}
+
+// Shows text (prefix, may be NULL), *source * scale with the given number of
+// decimals, then suffix, left aligned in a field of chars characters.
+// Set w->deadband / w->placeholder after this call if needed.
+void ssd1306_widget_number(SSD1306_Widget_t * w, int page, int col, int chars, const float * source, float scale, int decimals, const char * suffix)
+{
+	widget_init(w, WIDGET_NUMBER);
+	w->page = page;
+	w->col = col;
+	w->chars = chars;
+	w->source = source;
+	w->scale = scale;
+	w->decimals = decimals;
+	w->suffix = suffix;
+}
+
+void ssd1306_widget_bar(SSD1306_Widget_t * w, int x, int y, int width, int height, const float * source, float lo, float hi)
+{
+	widget_init(w, WIDGET_BAR);
+	w->x = x;
+	w->y = y;
+	w->width = width;
+	w->height = height;
+	w->source = source;
+	w->lo = lo;
+	w->hi = hi;
+}
+
+// Bitmaps are row-major, MSB first, as for ssd1306_bitmaps (any width)
+void ssd1306_widget_icon(SSD1306_Widget_t * w, int x, int y, int width, int height, const float * source, const uint8_t * bitmap_on, const uint8_t * bitmap_off)
+{
+	widget_init(w, WIDGET_ICON);
+	w->x = x;
+	w->y = y;
+	w->width = width;
+	w->height = height;
+	w->source = source;
+	w->bitmap_on = bitmap_on;
+	w->bitmap_off = bitmap_off;
+}
+
+// Forget what is on screen; the next update draws everything
+void ssd1306_widget_invalidate(SSD1306_Widget_t * w)
+{
+	w->drawn = false;
+}
+
+// value rounded to decimals places, without printf/float formatting
+int ssd1306_format_fixed(char * buf, int size, float value, int decimals)
+{
+	static const int32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000 };
+	if (decimals < 0) decimals = 0;
+	if (decimals > 5) decimals = 5;
+
+	char tmp[24];
+	int n = 0;
+	int64_t fixed = llroundf(fabsf(value) * pow10[decimals]);
+	bool negative = (value < 0.0f) && fixed != 0;
+
+	// Digits in reverse
+	for (int i = 0; i < decimals; i++) {
+		tmp[n++] = '0' + fixed % 10;
+		fixed /= 10;
+	}
+	if (decimals > 0) tmp[n++] = '.';
+	do {
+		tmp[n++] = '0' + fixed % 10;
+		fixed /= 10;
+	} while (fixed > 0 && n < (int)sizeof(tmp) - 1);
+	if (negative) tmp[n++] = '-';
+
+	int len = 0;
+	while (n > 0 && len < size - 1) {
+		buf[len++] = tmp[--n];
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+static int append(char * buf, int len, int size, const char * s)
+{
+	while (s && *s && len < size) buf[len++] = *s++;
+	return len;
+}
+
+// Draw the cells of text that differ from what is shown
+static bool widget_text(SSD1306_t * dev, SSD1306_Widget_t * w, const char * text)
+{
+	if (w->page < 0 || w->page >= dev->_pages) return false;
+	int chars = w->chars;
+	if (chars > SSD1306_WIDGET_MAX_CHARS) chars = SSD1306_WIDGET_MAX_CHARS;
+	if (w->col + chars > dev->_width / 8) chars = dev->_width / 8 - w->col;
+
+	bool changed = false;
+	uint8_t * segs = dev->_page[w->page]._segs;
+	bool ended = false;
+	for (int i = 0; i < chars; i++) {
+		if (text[i] == '\0') ended = true;
+		char ch = ended ? ' ' : text[i];
+		if (w->drawn && w->shown[i] == ch) continue;
+
+		int seg = (w->col + i) * 8;
+		ssd1306_blit_glyph(&segs[seg], ssd1306_glyph((uint8_t)ch, dev->_flip), w->invert);
+		ssd1306_mark_dirty(dev, w->page, seg, 8);
+		w->shown[i] = ch;
+		changed = true;
+	}
+	w->drawn = true;
+	return changed;
+}
+
+static bool widget_number(SSD1306_t * dev, SSD1306_Widget_t * w)
+{
+	float value = w->source ? *w->source * w->scale : NAN;
+
+	// Inside the deadband: keep showing the previous value
+	if (w->drawn && !isnan(value) && !isnan(w->last_value)
+		&& fabsf(value - w->last_value) < w->deadband) {
+		return false;
+	}
+	w->last_value = value;
+
+	char text[SSD1306_WIDGET_MAX_CHARS + 1];
+	int len = append(text, 0, SSD1306_WIDGET_MAX_CHARS, w->text);
+	if (isnan(value)) {
+		len = append(text, len, SSD1306_WIDGET_MAX_CHARS, w->placeholder ? w->placeholder : "--");
+	} else {
+		char number[16];
+		ssd1306_format_fixed(number, sizeof(number), value, w->decimals);
+		len = append(text, len, SSD1306_WIDGET_MAX_CHARS, number);
+		len = append(text, len, SSD1306_WIDGET_MAX_CHARS, w->suffix);
+	}
+	text[len] = '\0';
+	return widget_text(dev, w, text);
+}
+
+// Frame drawn once; afterwards only the columns between the old and new fill level change
+static bool widget_bar(SSD1306_t * dev, SSD1306_Widget_t * w)
+{
+	int inner = w->width - 2;
+	if (inner <= 0 || w->height < 3) return false;
+
+	float value = w->source ? *w->source : w->lo;
+	float frac = (w->hi > w->lo) ? (value - w->lo) / (w->hi - w->lo) : 0.0f;
+	if (isnan(frac) || frac < 0.0f) frac = 0.0f;
+	if (frac > 1.0f) frac = 1.0f;
+	int fill = (int)lroundf(frac * inner);
+
+	if (!w->drawn) {
+		_ssd1306_fill_rect(dev, w->x, w->y, w->width, w->height, true);
+		_ssd1306_rect(dev, w->x, w->y, w->width, w->height, false);
+		w->bar_fill = 0;
+		w->drawn = true;
+	} else if (fill == w->bar_fill) {
+		return false;
+	}
+
+	int x0 = w->x + 1;
+	if (fill > w->bar_fill) {
+		_ssd1306_fill_rect(dev, x0 + w->bar_fill, w->y + 1, fill - w->bar_fill, w->height - 2, w->invert);
+	} else {
+		_ssd1306_fill_rect(dev, x0 + fill, w->y + 1, w->bar_fill - fill, w->height - 2, !w->invert);
+	}
+	w->bar_fill = fill;
+	return true;
+}
+
+static bool widget_icon(SSD1306_t * dev, SSD1306_Widget_t * w)
+{
+	int state = (w->source && *w->source != 0.0f) ? 1 : 0;
+	if (w->drawn && state == w->icon_state) return false;
+
+	const uint8_t * bitmap = state ? w->bitmap_on : w->bitmap_off;
+	if (bitmap) {
+		ssd1306_blit(dev, w->x, w->y, bitmap, w->width, w->height, w->invert, BLIT_COPY);
+	} else {
+		_ssd1306_fill_rect(dev, w->x, w->y, w->width, w->height, !w->invert);
+	}
+	w->icon_state = state;
+	w->drawn = true;
+	return true;
+}
+
+// Render what changed into the frame buffer (not shown until flush/present).
+// Returns true if anything was drawn.
+bool ssd1306_widget_update(SSD1306_t * dev, SSD1306_Widget_t * w)
+{
+	switch (w->type) {
+	case WIDGET_LABEL:  return widget_text(dev, w, w->text);
+	case WIDGET_NUMBER: return widget_number(dev, w);
+	case WIDGET_BAR:    return widget_bar(dev, w);
+	case WIDGET_ICON:   return widget_icon(dev, w);
+	}
+	return false;
+}
+
+// Returns the number of widgets that changed
+int ssd1306_widgets_update(SSD1306_t * dev, SSD1306_Widget_t * widgets, int count)
+{
+	int changed = 0;
+	for (int i = 0; i < count; i++) {
+		if (ssd1306_widget_update(dev, &widgets[i])) changed++;
+	}
+	return changed;
+}
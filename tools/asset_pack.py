@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""Build the SSD1306 asset pack (include/ssd1306_assets.h) from a manifest.
+
+    asset_pack.py assets/pack.json -o assets.bin [--list]
+
+The pack goes to the "assets" partition, separately from the firmware:
+
+    parttool.py --port /dev/ttyACM0 write_partition --partition-name assets --input assets.bin
+
+Manifest (paths relative to the manifest):
+
+    {"fonts": [{"name": "digits16", "source": "../include/font8x8_basic.h",
+                "scale": 2, "chars": " +-.0123456789", "proportional": true,
+                "tabular_digits": true}],
+     "atlases": [{"name": "icons16", "width": 16, "height": 16,
+                  "icons": {"bell": ["......##......", ...]}}]}
+
+Fonts are taken from an 8x8 column font header such as font8x8_basic.h,
+optionally scaled up; proportional fonts have blank columns trimmed. Icons
+are rows of '#' (lit) and '.' (dark), indexed in manifest order.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x50414C4F
+VERSION = 1
+NAME_LEN = 12
+ASSET_FONT = 1
+ASSET_ATLAS = 2
+FLIPPED = 0x01
+DEFAULT_MAX_SIZE = 0x40000  # partitions.csv
+
+
+def reverse8(byte):
+    return int("{:08b}".format(byte)[::-1], 2)
+
+
+def load_font8x8(path):
+    """The 128 glyphs of a font8x8_basic_tr-style header: 8 column bytes each."""
+    with open(path) as f:
+        text = f.read()
+    rows = re.findall(r"\{\s*((?:0x[0-9A-Fa-f]{2}\s*,\s*){7}0x[0-9A-Fa-f]{2})\s*\}", text)
+    if len(rows) < 128:
+        raise ValueError("%s: expected 128 glyphs, found %d" % (path, len(rows)))
+    return [[int(v, 16) for v in row.split(",")] for row in rows[:128]]
+
+
+def columns_to_grid(columns, rows):
+    """Pixel grid [y][x] from column bytes (bit k = row k)."""
+    return [[(col >> y) & 1 for col in columns] for y in range(rows)]
+
+
+def grid_to_pages(grid):
+    """Column bytes page by page (the _segs layout); height padded to pages."""
+    height = len(grid)
+    width = len(grid[0]) if grid else 0
+    pages = (height + 7) // 8
+    out = bytearray()
+    for page in range(pages):
+        for x in range(width):
+            byte = 0
+            for k in range(8):
+                y = page * 8 + k
+                if y < height and grid[y][x]:
+                    byte |= 1 << k
+            out.append(byte)
+    return bytes(out), pages
+
+
+def scale_grid(grid, scale):
+    return [[px for px in row for _ in range(scale)] for row in grid for _ in range(scale)]
+
+
+def trim_columns(grid):
+    """Drop blank columns on both sides; None if the glyph is blank."""
+    width = len(grid[0])
+    lit = [x for x in range(width) if any(row[x] for row in grid)]
+    if not lit:
+        return None
+    return [row[lit[0]:lit[-1] + 1] for row in grid]
+
+
+def centre_columns(grid, width):
+    pad = width - len(grid[0])
+    left = pad // 2
+    return [[0] * left + row + [0] * (pad - left) for row in grid]
+
+
+def build_font(spec, base):
+    scale = spec.get("scale", 1)
+    chars = spec.get("chars", "".join(chr(c) for c in range(32, 127)))
+    proportional = spec.get("proportional", False)
+    glyphs8 = load_font8x8(os.path.join(base, spec["source"]))
+
+    grids = {}
+    for ch in chars:
+        grid = scale_grid(columns_to_grid(glyphs8[ord(ch) & 0x7F], 8), scale)
+        if proportional:
+            trimmed = trim_columns(grid)
+            # Blank glyphs (space) keep a fixed advance
+            grid = trimmed if trimmed else [row[:spec.get("space", 3) * scale] for row in grid]
+        grids[ch] = grid
+    if proportional and spec.get("tabular_digits", False):
+        digits = [ch for ch in grids if ch.isdigit()]
+        width = max(len(grids[ch][0]) for ch in digits)
+        for ch in digits:
+            grids[ch] = centre_columns(grids[ch], width)
+
+    codes = sorted(ord(ch) for ch in chars)
+    first, last = codes[0], codes[-1]
+    if last > 0x7F:
+        raise ValueError("font %s: only characters below 0x80 are supported" % spec["name"])
+    table = bytearray()
+    columns = bytearray()
+    pages = None
+    for code in range(first, last + 1):
+        ch = chr(code)
+        if ch not in grids:
+            table += struct.pack("<HBB", 0, 0, 0)
+            continue
+        data, pages = grid_to_pages(grids[ch])
+        width = len(grids[ch][0])
+        if len(columns) > 0xFFFF:
+            raise ValueError("font %s: more than 64 KiB of columns" % spec["name"])
+        table += struct.pack("<HBB", len(columns), width, 0)
+        columns += data
+
+    missing = ord("?") if "?" in chars else ord(" ") if " " in chars else 0
+    flags = FLIPPED if spec.get("flipped", True) else 0
+    spacing = spec.get("spacing", scale if proportional else 0)
+    header = struct.pack("<BBBBBBxxI", pages, first, last - first + 1, flags, spacing, missing, len(columns))
+    body = header + table + columns
+    if flags & FLIPPED:
+        body += bytes(reverse8(b) for b in columns)
+    return ASSET_FONT, body, "%d chars, %d px high" % (len(chars), pages * 8)
+
+
+def build_atlas(spec, base):
+    width = spec["width"]
+    height = spec["height"]
+    data = bytearray()
+    names = []
+    pages = (height + 7) // 8
+    for name, rows in spec["icons"].items():
+        if len(rows) > height or any(len(row) > width for row in rows):
+            raise ValueError("icon %s is larger than %dx%d" % (name, width, height))
+        grid = [[1 if c == "#" else 0 for c in row.ljust(width, ".")] for row in rows]
+        grid += [[0] * width for _ in range(height - len(grid))]
+        icon, pages = grid_to_pages(grid)
+        data += icon
+        names.append(name)
+    flags = FLIPPED if spec.get("flipped", True) else 0
+    header = struct.pack("<BBBBHH", width, pages, flags, 0, len(names), 0)
+    body = header + data
+    if flags & FLIPPED:
+        body += bytes(reverse8(b) for b in data)
+    index = ", ".join("%d %s" % (i, n) for i, n in enumerate(names))
+    return ASSET_ATLAS, body, "%dx%d: %s" % (width, pages * 8, index)
+
+
+def build_pack(manifest_path):
+    with open(manifest_path) as f:
+        manifest = json.load(f)
+    base = os.path.dirname(os.path.abspath(manifest_path))
+
+    assets = []
+    for spec in manifest.get("fonts", []):
+        assets.append((spec["name"],) + build_font(spec, base))
+    for spec in manifest.get("atlases", []):
+        assets.append((spec["name"],) + build_atlas(spec, base))
+
+    names = [a[0] for a in assets]
+    for name in names:
+        if len(name.encode()) > NAME_LEN or names.count(name) > 1:
+            raise ValueError("asset name %r is too long or not unique" % name)
+
+    offset = 16 + 24 * len(assets)
+    directory = bytearray()
+    blobs = bytearray()
+    for name, kind, body, _ in assets:
+        pad = (-(offset + len(blobs))) % 4
+        blobs += bytes(pad)
+        directory += struct.pack("<12sBxxxII", name.encode(), kind, offset + len(blobs), len(body))
+        blobs += body
+    payload = bytes(directory + blobs)
+    header = struct.pack("<IHHII", MAGIC, VERSION, len(assets), 16 + len(payload), zlib.crc32(payload))
+    return header + payload, assets
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("manifest")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--max-size", type=lambda v: int(v, 0), default=DEFAULT_MAX_SIZE,
+                        help="partition size (default 0x%X)" % DEFAULT_MAX_SIZE)
+    parser.add_argument("--list", action="store_true", help="print the assets")
+    args = parser.parse_args()
+
+    try:
+        pack, assets = build_pack(args.manifest)
+    except (ValueError, KeyError, OSError) as e:
+        print("asset_pack: %s" % e, file=sys.stderr)
+        return 1
+    if len(pack) > args.max_size:
+        print("asset_pack: %d bytes do not fit the %d byte partition" % (len(pack), args.max_size), file=sys.stderr)
+        return 1
+    with open(args.output, "wb") as f:
+        f.write(pack)
+    if args.list:
+        for name, kind, body, info in assets:
+            print("%-12s %-5s %6d bytes  %s" % (name, "font" if kind == ASSET_FONT else "atlas", len(body), info))
+    print("%s: %d assets, %d bytes" % (args.output, len(assets), len(pack)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
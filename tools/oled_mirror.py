@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Viewer for the SSD1306 mirror stream (src/ssd1306_mirror.c).
+
+Reads the serial console (or a capture file / stdin), picks out the
+"OLED:" lines, rebuilds the frame buffer from keyframes and XOR deltas,
+and draws it in the terminal. Other console output is passed through
+with --log.
+
+    oled_mirror.py --port /dev/ttyUSB0 [--baud 115200]
+    oled_mirror.py capture.txt --pbm screen.pbm
+    oled_mirror.py capture.txt --expect host/golden/text.pbm
+
+--port needs pyserial. --expect exits non-zero unless the last frame
+matches the given P4 image (the host render test uses it).
+"""
+
+import argparse
+import base64
+import sys
+
+PREFIX = "OLED:"
+COLUMNS = 128
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as mirror_crc16()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def rle_decode(payload, size):
+    out = bytearray(size)
+    i = 0
+    o = 0
+    while i < len(payload):
+        t = payload[i]
+        i += 1
+        if t < 0x80:
+            n = t + 1
+            out[o:o + n] = payload[i:i + n]
+            i += n
+            o += n
+        elif t < 0xC0:
+            o += (t & 0x3F) + 1
+        else:
+            o += ((t & 0x3F) | payload[i] << 6) + 1
+            i += 1
+        if o > size:
+            raise ValueError("payload overruns the frame")
+    return out
+
+
+class Mirror:
+    def __init__(self):
+        self.frame = None
+        self.pages = 0
+        self.flip = False
+        self.seq = None
+        self.packets = 0
+        self.bytes = 0
+        self.errors = 0
+        self.skipped = 0
+
+    def feed(self, line):
+        """Apply one OLED: line. Returns True when the frame changed."""
+        self.bytes += len(line) + 1
+        try:
+            packet = base64.b64decode(line[len(PREFIX):], validate=True)
+            if len(packet) < 7 or crc16(packet[:-2]) != packet[-2] | packet[-1] << 8:
+                raise ValueError("bad CRC")
+            kind = chr(packet[0])
+            seq = packet[1] | packet[2] << 8
+            pages = packet[3]
+            flags = packet[4]
+            data = rle_decode(packet[5:-2], pages * COLUMNS)
+        except ValueError:
+            self.errors += 1
+            self.seq = None  # Lost sync: wait for a keyframe
+            return False
+
+        if kind == "K":
+            self.frame = data
+        elif kind == "D" and self.frame is not None and self.seq is not None \
+                and seq == (self.seq + 1) & 0xFFFF and pages == self.pages:
+            self.frame = bytearray(a ^ b for a, b in zip(self.frame, data))
+        else:
+            self.skipped += 1
+            self.seq = None
+            return False
+        self.seq = seq
+        self.pages = pages
+        self.flip = bool(flags & 0x01)
+        self.packets += 1
+        return True
+
+    def pixel(self, x, y):
+        byte = self.frame[(y // 8) * COLUMNS + x]
+        bit = 7 - y % 8 if self.flip else y % 8
+        return (byte >> bit) & 1
+
+    def rows(self):
+        return self.pages * 8
+
+    def render_text(self):
+        """Two pixel rows per character cell."""
+        blocks = {(0, 0): " ", (1, 0): "▀", (0, 1): "▄", (1, 1): "█"}
+        lines = []
+        for y in range(0, self.rows(), 2):
+            lines.append("".join(blocks[(self.pixel(x, y), self.pixel(x, y + 1))]
+                                 for x in range(COLUMNS)))
+        return "\n".join(lines)
+
+    def pbm(self):
+        """P4 image, lit pixels white like ssd1306_emu_write_pbm."""
+        out = bytearray(b"P4\n%d %d\n" % (COLUMNS, self.rows()))
+        for y in range(self.rows()):
+            for xb in range(0, COLUMNS, 8):
+                byte = 0
+                for x in range(xb, xb + 8):
+                    if not self.pixel(x, y):
+                        byte |= 0x80 >> (x - xb)
+                out.append(byte)
+        return bytes(out)
+
+
+def read_lines(args):
+    if args.port:
+        import serial  # pyserial
+        port = serial.Serial(args.port, args.baud, timeout=1)
+        while True:
+            raw = port.readline()
+            if raw:
+                yield raw.decode("ascii", errors="replace").rstrip("\r\n")
+    else:
+        source = open(args.capture, "r", errors="replace") if args.capture else sys.stdin
+        for raw in source:
+            yield raw.rstrip("\r\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="capture file (default: stdin)")
+    parser.add_argument("--port", help="serial port to read instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--pbm", help="write the last frame to this P4 file")
+    parser.add_argument("--expect", help="compare the last frame with this P4 file")
+    parser.add_argument("--log", action="store_true", help="echo non-mirror console lines")
+    parser.add_argument("--quiet", action="store_true", help="do not draw frames")
+    args = parser.parse_args()
+
+    mirror = Mirror()
+    live = sys.stdout.isatty() and not args.quiet
+    try:
+        for line in read_lines(args):
+            if not line.startswith(PREFIX):
+                if args.log:
+                    print(line)
+                continue
+            if mirror.feed(line) and live:
+                sys.stdout.write("\x1b[H\x1b[2J" + mirror.render_text() + "\n")
+                sys.stdout.write("seq %d  packets %d  %.1f bytes/packet  errors %d  skipped %d\n" % (
+                    mirror.seq, mirror.packets, mirror.bytes / mirror.packets, mirror.errors, mirror.skipped))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+    if mirror.frame is None:
+        print("no frame received", file=sys.stderr)
+        return 1
+    if not live and not args.quiet:
+        print(mirror.render_text())
+    print("%d packets, %d bytes, %d errors, %d skipped" % (
+        mirror.packets, mirror.bytes, mirror.errors, mirror.skipped), file=sys.stderr)
+    if args.pbm:
+        with open(args.pbm, "wb") as f:
+            f.write(mirror.pbm())
+    if args.expect:
+        with open(args.expect, "rb") as f:
+            if f.read() != mirror.pbm():
+                print("last frame differs from %s" % args.expect, file=sys.stderr)
+                return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())